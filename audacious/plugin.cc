@@ -188,6 +188,9 @@ bool VgmstreamPlugin::play(const char *filename, VFSFile &file) {
         return false;
     }
 
+    // save the decoder state every second for faster seeking back, if the codec allows it
+    set_vgmstream_checkpoints(vgmstream, vgmstream->sample_rate);
+
     short buffer[MIN_BUFFER_SIZE * vgmstream->channels];
     int max_buffer_samples = sizeof(buffer) / sizeof(buffer[0]) / vgmstream->channels;
 
@@ -250,34 +253,11 @@ void VgmstreamPlugin::seek(int seek_value, int &current_sample_pos) {
 
     // compute from ms to samples
     int seek_needed_samples = (long long)seek_value * vgmstream->sample_rate / 1000L;
-    short buffer[MIN_BUFFER_SIZE * vgmstream->channels];
-    int max_buffer_samples = sizeof(buffer) / sizeof(buffer[0]) / vgmstream->channels;
-
-    int samples_to_do = 0;
-    if (seek_needed_samples < current_sample_pos) {
-        // go back in time, reopen file
-        debugMessage("reopen file to seek backward");
-        reset_vgmstream(vgmstream);
-        current_sample_pos = 0;
-        samples_to_do = seek_needed_samples;
-    } else if (current_sample_pos < seek_needed_samples) {
-        // go forward in time
-        samples_to_do = seek_needed_samples - current_sample_pos;
-    }
-
-    // do the actual seeking
-    if (samples_to_do >= 0) {
-        debugMessage("render forward");
 
-        // render till seeked sample
-        while (samples_to_do > 0) {
-            int seek_samples = std::min(max_buffer_samples, samples_to_do);
-            current_sample_pos += seek_samples;
-            samples_to_do -= seek_samples;
-            render_vgmstream(buffer, seek_samples, vgmstream);
-        }
-        debugMessage("after render vgmstream");
-    }
+    // vgmstream finds the closest point it can get to and decodes from there
+    seek_vgmstream(vgmstream, seek_needed_samples);
+    current_sample_pos = seek_needed_samples;
+    debugMessage("after seek vgmstream");
 }
 
 void debugMessage(const char *str) {
@@ -7,15 +7,18 @@
 #include "plugin.h"
 #include "vfs.h"
 
+// unbuffered, every read goes to the VFS (open_vfs puts a buffer on top)
 typedef struct _VFSSTREAMFILE {
   STREAMFILE sf;
   VFSFile *vfsFile;
   off_t offset;
   char name[260];
   char realname[260];
+  STREAMFILE_STATS stats;
 } VFSSTREAMFILE;
 
 static STREAMFILE *open_vfs_by_VFSFILE(VFSFile *file, const char *path);
+static STREAMFILE *open_vfs_raw(const char *path);
 
 static size_t read_vfs(VFSSTREAMFILE *streamfile, uint8_t *dest, off_t offset,
                        size_t length) {
@@ -24,18 +27,24 @@ static size_t read_vfs(VFSSTREAMFILE *streamfile, uint8_t *dest, off_t offset,
   if (streamfile->offset != offset) {
     streamfile->vfsFile->fseek(offset, VFS_SEEK_SET);
     streamfile->offset = offset;
+    streamfile->stats.seeks++;
   }
 
   sz = streamfile->vfsFile->fread(dest, 1, length);
   // increment our current offset
   streamfile->offset += sz;
 
+  streamfile->stats.reads++;
+  streamfile->stats.misses++;
+  streamfile->stats.bytes_fetched += sz;
+  streamfile->stats.bytes_consumed += sz;
+
   return sz;
 }
 
 static void close_vfs(VFSSTREAMFILE *streamfile) {
   debugMessage("close_vfs");
-  free(streamfile->vfsFile);
+  delete streamfile->vfsFile;
   free(streamfile);
 }
 
@@ -59,13 +68,23 @@ static void get_realname_vfs(VFSSTREAMFILE *streamfile, char *buffer,
   buffer[length - 1] = '\0';
 }
 
+static void get_stats_vfs(VFSSTREAMFILE *streamfile, STREAMFILE_STATS *stats) {
+  stats->reads += streamfile->stats.reads;
+  stats->misses += streamfile->stats.misses;
+  stats->seeks += streamfile->stats.seeks;
+  stats->bytes_fetched += streamfile->stats.bytes_fetched;
+  stats->bytes_consumed += streamfile->stats.bytes_consumed;
+  stats->handles++;
+}
+
 static STREAMFILE *open_vfs_impl(VFSSTREAMFILE *streamfile,
                                  const char *const filename,
                                  size_t buffersize) {
   if (!filename)
     return NULL;
 
-  return open_vfs(filename);
+  // the buffer that called us wraps it
+  return open_vfs_raw(filename);
 }
 
 STREAMFILE *open_vfs_by_VFSFILE(VFSFile *file, const char *path) {
@@ -83,6 +102,7 @@ STREAMFILE *open_vfs_by_VFSFILE(VFSFile *file, const char *path) {
   streamfile->sf.get_realname = get_realname_vfs;
   streamfile->sf.open = open_vfs_impl;
   streamfile->sf.close = close_vfs;
+  streamfile->sf.get_stats = get_stats_vfs;
 
   streamfile->vfsFile = file;
   streamfile->offset = 0;
@@ -98,10 +118,31 @@ STREAMFILE *open_vfs_by_VFSFILE(VFSFile *file, const char *path) {
   return &streamfile->sf;
 }
 
-STREAMFILE *open_vfs(const char *path) {
+static STREAMFILE *open_vfs_raw(const char *path) {
+  STREAMFILE *streamfile;
   VFSFile *vfsFile = new VFSFile(path, "rb");
   if (!vfsFile)
     return NULL;
 
-  return open_vfs_by_VFSFILE(vfsFile, path);
+  streamfile = open_vfs_by_VFSFILE(vfsFile, path);
+  if (!streamfile)
+    delete vfsFile;
+  return streamfile;
+}
+
+STREAMFILE *open_vfs(const char *path) {
+  STREAMFILE *streamfile, *bufferfile;
+
+  streamfile = open_vfs_raw(path);
+  if (!streamfile)
+    return NULL;
+
+  // VFS reads can be slow (seeks/syscalls, or network), so decoders' small
+  // reads are done over a buffer
+  bufferfile = open_buffer_streamfile(streamfile, 0);
+  if (!bufferfile) {
+    close_streamfile(streamfile);
+    return NULL;
+  }
+  return bufferfile;
 }
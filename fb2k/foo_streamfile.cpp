@@ -35,6 +35,8 @@ typedef struct _FOO_STREAMFILE {
     uint8_t * buffer;
     size_t buffersize;
     size_t filesize;
+    STREAMFILE_STATS stats;
+    off_t fetch_end;
 }  FOO_STREAMFILE;
 
 static STREAMFILE * open_foo_streamfile_buffer_by_file(service_ptr_t<file> m_file,const char * const filename, size_t buffersize, abort_callback * p_abort);
@@ -89,12 +91,12 @@ static size_t read_the_rest_foo(uint8_t * dest, off_t offset, size_t length, FOO
             //   return length_read;
         } catch (...) {
             streamfile->offset = streamfile->filesize;
-#ifdef PROFILE_STREAMFILE
-            streamfile->error_count++;
-#endif
+            streamfile->stats.errors++;
             return 0; /* fail miserably (fseek shouldn't fail and reach this) */
         }
         streamfile->offset = offset;
+        if (offset != streamfile->fetch_end)
+            streamfile->stats.seeks++;
 
         /* decide how much must be read this time */
         if (length > streamfile->buffersize)
@@ -106,16 +108,14 @@ static size_t read_the_rest_foo(uint8_t * dest, off_t offset, size_t length, FOO
         try {
             length_read = streamfile->m_file->read(streamfile->buffer,streamfile->buffersize,*streamfile->p_abort);
         } catch(...) {
-#ifdef PROFILE_STREAMFILE
-            streamfile->error_count++;
-#endif
+            streamfile->stats.errors++;
             return 0; /* fail miserably */
         }
         streamfile->validsize = length_read;
 
-#ifdef PROFILE_STREAMFILE
-        streamfile->bytes_read += length_read;
-#endif
+        streamfile->stats.misses++;
+        streamfile->stats.bytes_fetched += length_read;
+        streamfile->fetch_end = offset + length_read;
 
         /* if we can't get enough to satisfy the request (EOF) we give up */
         if (length_read < length_to_read) {
@@ -157,16 +157,22 @@ static size_t read_foo(FOO_STREAMFILE *streamfile, uint8_t * dest, off_t offset,
 #endif
     }
 
+    streamfile->stats.reads++;
+
     /* just copy if entire request is within the buffer */
     if (offset >= streamfile->offset && offset + length <= streamfile->offset + streamfile->validsize) {
         off_t offset_into_buffer = offset - streamfile->offset;
         memcpy(dest,streamfile->buffer + offset_into_buffer,length);
+        streamfile->stats.hits++;
+        streamfile->stats.bytes_consumed += length;
         return length;
     }
 
     /* request outside buffer: new fread */
     {
-        return read_the_rest_foo(dest,offset,length,streamfile);
+        size_t length_read = read_the_rest_foo(dest,offset,length,streamfile);
+        streamfile->stats.bytes_consumed += length_read;
+        return length_read;
     }
 }
 
@@ -206,6 +212,17 @@ static off_t get_offset_foo(FOO_STREAMFILE *streamFile) {
     return streamFile->offset;
 }
 
+static void get_stats_foo(FOO_STREAMFILE * streamfile, STREAMFILE_STATS * stats) {
+    stats->reads += streamfile->stats.reads;
+    stats->hits += streamfile->stats.hits;
+    stats->misses += streamfile->stats.misses;
+    stats->seeks += streamfile->stats.seeks;
+    stats->bytes_fetched += streamfile->stats.bytes_fetched;
+    stats->bytes_consumed += streamfile->stats.bytes_consumed;
+    stats->handles++;
+    stats->errors += streamfile->stats.errors;
+}
+
 static void close_foo(FOO_STREAMFILE * streamfile) {
     streamfile->m_file.release();
     free(streamfile->name);
@@ -245,10 +262,7 @@ static STREAMFILE * open_foo_streamfile_buffer_by_file(service_ptr_t<file> m_fil
     streamfile->sf.get_realname = (void (__cdecl *)(_STREAMFILE *,char *,size_t)) get_name_foo;
     streamfile->sf.open = (_STREAMFILE *(__cdecl *)(_STREAMFILE *,const char *const ,size_t)) open_foo;
     streamfile->sf.close = (void (__cdecl *)(_STREAMFILE *)) close_foo;
-#ifdef PROFILE_STREAMFILE
-    streamfile->sf.get_bytes_read = (void*)get_bytes_read_stdio;
-    streamfile->sf.get_error_count = (void*)get_error_count_stdio;
-#endif
+    streamfile->sf.get_stats = (void (__cdecl *)(_STREAMFILE *,STREAMFILE_STATS *)) get_stats_foo;
 
     streamfile->m_file = m_file;
 
@@ -0,0 +1,246 @@
+/*
+ * cache.c - on-disk cache of detected formats
+ *
+ * Each file (and subsong) gets a small entry file in the cache dir, named after a hash of its path.
+ * Entries are written to a temp file then renamed over the old one, so readers in other processes
+ * always see a whole entry, and are checked against the file's size and modification time when read.
+ *
+ * The cached format is tried before the others, so the entry is also checked against the modification time of
+ * the file's directory: a higher priority format may accept the file once companion files are added or removed.
+ */
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_DEPRECATE
+#endif
+#include <sys/stat.h>
+#include <time.h>
+#if defined(_WIN32) || defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+#include "vgmstream.h"
+#include "util.h"
+
+#define CACHE_ENTRY_ID          0x434D4756  /* "VGMC" as LE */
+#define CACHE_ENTRY_VERSION     2
+#define CACHE_ENTRY_HEADER_SIZE 0x88
+
+static char cache_dir[PATH_LIMIT] = {0}; /* empty = disabled */
+
+
+void vgmstream_set_cache_dir(const char * dir) {
+    if (!dir || strlen(dir) >= PATH_LIMIT) {
+        cache_dir[0] = '\0';
+        return;
+    }
+    strcpy(cache_dir, dir);
+}
+
+/* FNV-1a */
+static uint64_t get_cache_hash64(const uint8_t * buf, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    size_t i;
+    for (i = 0; i < size; i++) {
+        hash ^= buf[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint32_t get_cache_checksum(const uint8_t * buf, size_t size) {
+    uint64_t hash = get_cache_hash64(buf, size);
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static int get_cache_entry_name(char * entryname, const char * filename, int stream_index) {
+    uint64_t hash = get_cache_hash64((const uint8_t*)filename, strlen(filename));
+    return snprintf(entryname, PATH_LIMIT, "%s/%08x%08x-%i.vgmc", cache_dir, (uint32_t)(hash >> 32), (uint32_t)hash, stream_index) < PATH_LIMIT;
+}
+
+/* size and mtime identify the version of the file that was detected, and the dir's mtime its companion files */
+static int get_cache_file_id(const char * filename, uint64_t * file_size, int64_t * file_time, int64_t * dir_time) {
+    struct stat file_stat, dir_stat;
+    char path[PATH_LIMIT];
+    const char * name;
+
+    if (stat(filename, &file_stat) != 0)
+        return 0;
+    if ((file_stat.st_mode & S_IFMT) != S_IFREG)
+        return 0;
+
+    name = strrchr(filename, DIR_SEPARATOR);
+#if defined(_WIN32) || defined(WIN32)
+    if (strrchr(filename, '/') > name)
+        name = strrchr(filename, '/');
+#endif
+    if (name) {
+        /* without the separator, as MSVC's stat fails on dirs ending with one (roots like "/" or "C:\" keep it) */
+        size_t path_size = name - filename;
+        if (path_size == 0 || (path_size == 2 && filename[1] == ':'))
+            path_size++;
+        if (path_size + 1 > sizeof(path))
+            return 0;
+        memcpy(path, filename, path_size);
+        path[path_size] = '\0';
+    }
+    else {
+        strcpy(path, ".");
+    }
+    if (stat(path, &dir_stat) != 0) {
+        VGM_LOG("CACHE: can't stat dir %s of %s\n", path, filename);
+        return 0;
+    }
+
+    *file_size = (uint64_t)file_stat.st_size;
+    *file_time = (int64_t)file_stat.st_mtime;
+    *dir_time = (int64_t)dir_stat.st_mtime;
+    return 1;
+}
+
+
+int vgmstream_get_cache_info(const char * filename, int stream_index, VGMSTREAM_CACHE_INFO * info) {
+    char entryname[PATH_LIMIT];
+    uint8_t header[CACHE_ENTRY_HEADER_SIZE];
+    uint8_t * buf = NULL;
+    FILE * entry = NULL;
+    size_t filename_size, entry_size;
+    uint64_t file_size;
+    int64_t file_time, dir_time;
+
+    if (!cache_dir[0])
+        return 0;
+    if (!get_cache_file_id(filename, &file_size, &file_time, &dir_time))
+        return 0;
+
+    if (!get_cache_entry_name(entryname, filename, stream_index)) goto fail;
+    entry = fopen(entryname, "rb");
+    if (!entry) goto fail;
+
+    if (fread(header, 1, CACHE_ENTRY_HEADER_SIZE, entry) != CACHE_ENTRY_HEADER_SIZE) goto fail;
+    if ((uint32_t)get_32bitLE(header+0x00) != CACHE_ENTRY_ID) goto fail;
+    if (get_32bitLE(header+0x04) != CACHE_ENTRY_VERSION) goto fail;
+
+    /* read the path too, to check the whole entry and rule out hash collisions */
+    filename_size = strlen(filename);
+    if ((uint32_t)get_32bitLE(header+0x7c) != filename_size) goto fail;
+    entry_size = CACHE_ENTRY_HEADER_SIZE + filename_size;
+    buf = malloc(entry_size);
+    if (!buf) goto fail;
+    memcpy(buf, header, CACHE_ENTRY_HEADER_SIZE);
+    if (fread(buf + CACHE_ENTRY_HEADER_SIZE, 1, filename_size, entry) != filename_size) goto fail;
+    fclose(entry);
+    entry = NULL;
+
+    if ((uint32_t)get_32bitLE(buf+0x08) != get_cache_checksum(buf + 0x0c, entry_size - 0x0c)) goto fail;
+    if (memcmp(buf + CACHE_ENTRY_HEADER_SIZE, filename, filename_size) != 0) goto fail;
+
+    /* file changed since it was cached */
+    if ((uint64_t)get_64bitLE(buf+0x0c) != file_size) goto fail;
+    if (get_64bitLE(buf+0x14) != file_time) goto fail;
+    if (get_32bitLE(buf+0x1c) != stream_index) goto fail;
+    if (get_64bitLE(buf+0x80) != dir_time) goto fail;
+
+    memset(info, 0, sizeof(VGMSTREAM_CACHE_INFO));
+    info->stream_index = stream_index;
+    info->num_streams = get_32bitLE(buf+0x20);
+    info->channels = get_32bitLE(buf+0x24);
+    info->sample_rate = get_32bitLE(buf+0x28);
+    info->num_samples = get_32bitLE(buf+0x2c);
+    info->loop_flag = get_32bitLE(buf+0x30);
+    info->loop_start_sample = get_32bitLE(buf+0x34);
+    info->loop_end_sample = get_32bitLE(buf+0x38);
+    memcpy(info->meta, buf+0x3c, sizeof(info->meta));
+    info->meta[sizeof(info->meta)-1] = '\0';
+
+    free(buf);
+    return 1;
+
+fail:
+    if (entry) fclose(entry);
+    free(buf);
+    return 0;
+}
+
+void put_vgmstream_cache_info(const char * filename, const VGMSTREAM_CACHE_INFO * info) {
+    char entryname[PATH_LIMIT], tempname[PATH_LIMIT];
+    uint8_t * buf = NULL;
+    FILE * entry = NULL;
+    size_t filename_size, entry_size;
+    uint64_t file_size;
+    int64_t file_time, dir_time;
+    unsigned long pid;
+
+    tempname[0] = '\0';
+    if (!cache_dir[0])
+        return;
+    if (!get_cache_file_id(filename, &file_size, &file_time, &dir_time))
+        return;
+
+    /* a change later in the same second wouldn't change the dir's mtime, so wait until it's older */
+    if ((int64_t)time(NULL) - dir_time <= 1)
+        return;
+
+    filename_size = strlen(filename);
+    entry_size = CACHE_ENTRY_HEADER_SIZE + filename_size;
+    buf = calloc(entry_size, 1);
+    if (!buf) goto fail;
+
+    put_32bitLE(buf+0x00, CACHE_ENTRY_ID);
+    put_32bitLE(buf+0x04, CACHE_ENTRY_VERSION);
+    put_32bitLE(buf+0x0c, (int32_t)file_size);
+    put_32bitLE(buf+0x10, (int32_t)(file_size >> 32));
+    put_32bitLE(buf+0x14, (int32_t)file_time);
+    put_32bitLE(buf+0x18, (int32_t)(file_time >> 32));
+    put_32bitLE(buf+0x1c, info->stream_index);
+    put_32bitLE(buf+0x20, info->num_streams);
+    put_32bitLE(buf+0x24, info->channels);
+    put_32bitLE(buf+0x28, info->sample_rate);
+    put_32bitLE(buf+0x2c, info->num_samples);
+    put_32bitLE(buf+0x30, info->loop_flag);
+    put_32bitLE(buf+0x34, info->loop_start_sample);
+    put_32bitLE(buf+0x38, info->loop_end_sample);
+    memcpy(buf+0x3c, info->meta, sizeof(info->meta));
+    buf[0x3c + sizeof(info->meta) - 1] = '\0';
+    put_32bitLE(buf+0x7c, (int32_t)filename_size);
+    put_32bitLE(buf+0x80, (int32_t)dir_time);
+    put_32bitLE(buf+0x84, (int32_t)(dir_time >> 32));
+    memcpy(buf + CACHE_ENTRY_HEADER_SIZE, filename, filename_size);
+    put_32bitLE(buf+0x08, get_cache_checksum(buf + 0x0c, entry_size - 0x0c));
+
+    /* temp name must be unique between processes and threads (info is the caller's local, so it's different per thread) */
+#if defined(_WIN32) || defined(WIN32)
+    pid = (unsigned long)GetCurrentProcessId();
+#else
+    pid = (unsigned long)getpid();
+#endif
+    if (!get_cache_entry_name(entryname, filename, info->stream_index)) goto fail;
+    if (snprintf(tempname, PATH_LIMIT, "%s.%lu.%p.tmp", entryname, pid, (void*)info) >= PATH_LIMIT) {
+        tempname[0] = '\0';
+        goto fail;
+    }
+
+    entry = fopen(tempname, "wb");
+    if (!entry) goto fail;
+    if (fwrite(buf, 1, entry_size, entry) != entry_size) goto fail;
+    if (fclose(entry) != 0) {
+        entry = NULL;
+        goto fail;
+    }
+    entry = NULL;
+
+#if defined(_WIN32) || defined(WIN32)
+    /* fails if someone is reading the old entry, not a big deal */
+    if (!MoveFileExA(tempname, entryname, MOVEFILE_REPLACE_EXISTING)) goto fail;
+#else
+    if (rename(tempname, entryname) != 0) goto fail;
+#endif
+
+    free(buf);
+    return;
+
+fail:
+    if (entry) fclose(entry);
+    if (tempname[0]) remove(tempname);
+    free(buf);
+}
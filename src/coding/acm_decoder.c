@@ -24,6 +24,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if !defined(_WIN32) && !defined(WIN32)
+#include <pthread.h>
+#endif
 
 #include "coding.h"
 #include "../vgmstream.h"
@@ -152,6 +155,11 @@ static void generate_tables(void)
 	tables_generated = 1;
 }
 
+#if !defined(_WIN32) && !defined(WIN32)
+/* streams may be opened from several threads while detecting formats */
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+#endif
+
 /* IOW: (r * acm->subblock_len) + c */
 #define set_pos(acm, r, c, idx) do { \
 		unsigned _pos = ((r) << acm->info.acm_level) + (c); \
@@ -724,7 +732,11 @@ int acm_open_decoder(ACMStream **res, STREAMFILE *facilitator_file,
 
 	memset(acm->wrapbuf, 0, acm->wrapbuf_len * sizeof(int));
 
+#if !defined(_WIN32) && !defined(WIN32)
+	pthread_once(&tables_once, generate_tables);
+#else
 	generate_tables();
+#endif
 
 	*res = acm;
 	return ACM_OK;
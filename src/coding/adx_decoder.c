@@ -8,7 +8,9 @@ void decode_adx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
 
     int framesin = first_sample/frame_samples;
 
-    int32_t scale = read_16bitBE(stream->offset+framesin*frame_bytes,stream->streamfile) + 1;
+    uint8_t frame_buf[0x100]; /* frame size is a byte in the header */
+    const uint8_t * frame = borrow_streamfile(frame_buf, stream->offset+framesin*frame_bytes, frame_bytes, stream->streamfile);
+    int32_t scale = get_16bitBE(frame) + 1;
     int32_t hist1 = stream->adpcm_history1_32;
     int32_t hist2 = stream->adpcm_history2_32;
     int coef1 = stream->adpcm_coef[0];
@@ -17,7 +19,7 @@ void decode_adx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
     first_sample = first_sample%frame_samples;
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int sample_byte = read_8bit(stream->offset+framesin*frame_bytes +2+i/2,stream->streamfile);
+        int sample_byte = (int8_t)frame[2+i/2];
 
         outbuf[sample_count] = clamp16(
                 (i&1?
@@ -42,7 +44,9 @@ void decode_adx_exp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
     int framesin = first_sample/frame_samples;
 
-    int32_t scale = read_16bitBE(stream->offset+framesin*frame_bytes,stream->streamfile);
+    uint8_t frame_buf[0x100]; /* frame size is a byte in the header */
+    const uint8_t * frame = borrow_streamfile(frame_buf, stream->offset+framesin*frame_bytes, frame_bytes, stream->streamfile);
+    int32_t scale = get_16bitBE(frame);
     int32_t hist1, hist2;
     int coef1, coef2;
     scale = 1 << (12 - scale);
@@ -54,7 +58,7 @@ void decode_adx_exp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     first_sample = first_sample%frame_samples;
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int sample_byte = read_8bit(stream->offset+framesin*frame_bytes +2+i/2,stream->streamfile);
+        int sample_byte = (int8_t)frame[2+i/2];
 
         outbuf[sample_count] = clamp16(
                 (i&1?
@@ -79,8 +83,10 @@ void decode_adx_fixed(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspa
 
     int framesin = first_sample/frame_samples;
 
-    int32_t scale = (read_16bitBE(stream->offset + framesin*frame_bytes, stream->streamfile) & 0x1FFF) + 1;
-    int32_t predictor = read_8bit(stream->offset + framesin*frame_bytes, stream->streamfile) >> 5;
+    uint8_t frame_buf[0x100]; /* frame size is a byte in the header */
+    const uint8_t * frame = borrow_streamfile(frame_buf, stream->offset+framesin*frame_bytes, frame_bytes, stream->streamfile);
+    int32_t scale = (get_16bitBE(frame) & 0x1FFF) + 1;
+    int32_t predictor = (int8_t)frame[0] >> 5;
     int32_t hist1 = stream->adpcm_history1_32;
     int32_t hist2 = stream->adpcm_history2_32;
     int coef1 = stream->adpcm_coef[predictor * 2];
@@ -89,7 +95,7 @@ void decode_adx_fixed(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspa
     first_sample = first_sample%frame_samples;
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int sample_byte = read_8bit(stream->offset+framesin*frame_bytes +2+i/2,stream->streamfile);
+        int sample_byte = (int8_t)frame[2+i/2];
 
         outbuf[sample_count] = clamp16(
                 (i&1?
@@ -119,7 +125,9 @@ void decode_adx_enc(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
     int framesin = first_sample/frame_samples;
 
-    int32_t scale = ((read_16bitBE(stream->offset+framesin*frame_bytes,stream->streamfile) ^ stream->adx_xor)&0x1fff) + 1;
+    uint8_t frame_buf[0x100]; /* frame size is a byte in the header */
+    const uint8_t * frame = borrow_streamfile(frame_buf, stream->offset+framesin*frame_bytes, frame_bytes, stream->streamfile);
+    int32_t scale = ((get_16bitBE(frame) ^ stream->adx_xor)&0x1fff) + 1;
     int32_t hist1 = stream->adpcm_history1_32;
     int32_t hist2 = stream->adpcm_history2_32;
     int coef1 = stream->adpcm_coef[0];
@@ -128,7 +136,7 @@ void decode_adx_enc(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     first_sample = first_sample%frame_samples;
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int sample_byte = read_8bit(stream->offset+framesin*frame_bytes +2+i/2,stream->streamfile);
+        int sample_byte = (int8_t)frame[2+i/2];
 
         outbuf[sample_count] = clamp16(
                 (i&1?
@@ -49,9 +49,12 @@ void seek_at3plus(VGMSTREAM *vgmstream, int32_t num_sample) {
     int blocks_to_skip = num_sample / 2048;
     int samples_to_discard = num_sample % 2048;
     maiatrac3plus_codec_data *data = (maiatrac3plus_codec_data *)(vgmstream->codec_data);
-    vgmstream->loop_ch[0].offset =
-        vgmstream->loop_ch[0].channel_start_offset +
-        vgmstream->interleave_block_size * blocks_to_skip;
+    off_t offset = vgmstream->ch[0].channel_start_offset + vgmstream->interleave_block_size * blocks_to_skip;
+
+    /* when looping the loop_ch are copied over after this */
+    vgmstream->ch[0].offset = offset;
+    if (vgmstream->loop_ch)
+        vgmstream->loop_ch[0].offset = offset;
     data->samples_discard = samples_to_discard;
 }
 
@@ -15,15 +15,33 @@
 /* INTERNAL UTILS                               */
 /* ******************************************** */
 
+/* window of bytes for bit reads, as parsers read many small fields close together */
+typedef struct {
+    STREAMFILE *streamFile;
+    uint8_t buf[0x1000];
+    off_t offset;
+    size_t size;
+} bit_buffer;
+
 /**
  * read num_bits (up to 25) from a bit offset.
  * 25 since we read a 32 bit int, and need to adjust up to 7 bits from the byte-rounded fseek (32-7=25)
  */
-static uint32_t read_bitsBE_b(off_t bit_offset, int num_bits, STREAMFILE *streamFile) {
+static uint32_t read_bitsBE_b(off_t bit_offset, int num_bits, bit_buffer *bb) {
     uint32_t num, mask;
+    off_t offset = bit_offset / 8; /* fseek rounded to 8 */
     if (num_bits > 25) return -1; //???
 
-    num = read_32bitBE(bit_offset / 8, streamFile); /* fseek rounded to 8 */
+    /* refill the window if the 32b int isn't fully in it */
+    if (offset < bb->offset || offset + 0x04 > bb->offset + (off_t)bb->size) {
+        bb->offset = offset;
+        bb->size = read_streamfile(bb->buf, offset, sizeof(bb->buf), bb->streamFile);
+    }
+
+    if (bb->size < 0x04) /* same as read_32bitBE at EOF */
+        num = 0xFFFFFFFF;
+    else
+        num = get_32bitBE(bb->buf + (offset - bb->offset));
     num = num << (bit_offset % 8); /* offset adjust (up to 7) */
     num = num >> (32 - num_bits);
     mask = 0xffffffff >> (32 - num_bits);
@@ -443,6 +461,9 @@ static void ms_audio_get_samples(ms_sample_data * msd, STREAMFILE *streamFile, i
     uint32_t packet_size = bytes_per_packet;
     off_t offset = msd->data_offset;
     uint32_t stream_offset_b = msd->data_offset * 8;
+    bit_buffer bb = {0};
+
+    bb.streamFile = streamFile;
 
     offset += start_packet * packet_size;
     size = offset + msd->data_size;
@@ -455,21 +476,21 @@ static void ms_audio_get_samples(ms_sample_data * msd, STREAMFILE *streamFile, i
 
         /* packet header */
         if (msd->xma_version == 1) { /* XMA1 */
-            //packet_sequence = read_bitsBE_b(offset_b+0,  4,  streamFile); /* numbered from 0 to N */
-            //unknown         = read_bitsBE_b(offset_b+4,  2,  streamFile); /* packet_metadata? (always 2) */
-            first_frame_b     = read_bitsBE_b(offset_b+6,  bits_frame_size, streamFile); /* offset in bits inside the packet */
-            packet_skip_count = read_bitsBE_b(offset_b+21, 11, streamFile); /* packets to skip for next packet of this stream */
+            //packet_sequence = read_bitsBE_b(offset_b+0,  4,  &bb); /* numbered from 0 to N */
+            //unknown         = read_bitsBE_b(offset_b+4,  2,  &bb); /* packet_metadata? (always 2) */
+            first_frame_b     = read_bitsBE_b(offset_b+6,  bits_frame_size, &bb); /* offset in bits inside the packet */
+            packet_skip_count = read_bitsBE_b(offset_b+21, 11, &bb); /* packets to skip for next packet of this stream */
             header_size_b     = 32;
         } else if (msd->xma_version == 2) { /* XMA2 */
-            //frame_count     = read_bitsBE_b(offset_b+0,  6,  streamFile); /* frames that begin in this packet */
-            first_frame_b     = read_bitsBE_b(offset_b+6,  bits_frame_size, streamFile); /* offset in bits inside this packet */
-            //packet_metadata = read_bitsBE_b(offset_b+21, 3,  streamFile); /* packet_metadata (always 1) */
-            packet_skip_count = read_bitsBE_b(offset_b+24, 8,  streamFile); /* packets to skip for next packet of this stream */
+            //frame_count     = read_bitsBE_b(offset_b+0,  6,  &bb); /* frames that begin in this packet */
+            first_frame_b     = read_bitsBE_b(offset_b+6,  bits_frame_size, &bb); /* offset in bits inside this packet */
+            //packet_metadata = read_bitsBE_b(offset_b+21, 3,  &bb); /* packet_metadata (always 1) */
+            packet_skip_count = read_bitsBE_b(offset_b+24, 8,  &bb); /* packets to skip for next packet of this stream */
             header_size_b     = 32;
         } else { /* WMAPRO(v3) */
-            //packet_sequence = read_bitsBE_b(offset_b+0,  4,  streamFile); /* numbered from 0 to N */
-            //unknown         = read_bitsBE_b(offset_b+4,  2,  streamFile); /* packet_metadata? (always 2) */
-            first_frame_b     = read_bitsBE_b(offset_b+6,  bits_frame_size, streamFile);  /* offset in bits inside the packet */
+            //packet_sequence = read_bitsBE_b(offset_b+0,  4,  &bb); /* numbered from 0 to N */
+            //unknown         = read_bitsBE_b(offset_b+4,  2,  &bb); /* packet_metadata? (always 2) */
+            first_frame_b     = read_bitsBE_b(offset_b+6,  bits_frame_size, &bb);  /* offset in bits inside the packet */
             packet_skip_count = 0; /* xwma has no need to skip packets since it uses real multichannel audio */
             header_size_b     = 4+2+bits_frame_size; /* variable-sized header */
         }
@@ -511,7 +532,7 @@ static void ms_audio_get_samples(ms_sample_data * msd, STREAMFILE *streamFile, i
                 loop_end_frame = frames;
 
             /* frame header */
-            frame_size_b = read_bitsBE_b(frame_offset_b, bits_frame_size, streamFile);
+            frame_size_b = read_bitsBE_b(frame_offset_b, bits_frame_size, &bb);
             frame_offset_b += bits_frame_size;
             //;VGM_LOG("MS_SAMPLES: frame_offset=0x%lx (0b%lx), frame_size=0x%x (0b%x)\n", (off_t)frame_offset_b/8,(off_t)frame_offset_b, frame_size_b/8, frame_size_b);
 
@@ -531,10 +552,10 @@ static void ms_audio_get_samples(ms_sample_data * msd, STREAMFILE *streamFile, i
 
                 /* ignore "postproc transform" */
                 if (channels_per_packet > 1) {
-                    flag = read_bitsBE_b(frame_offset_b, 1, streamFile);
+                    flag = read_bitsBE_b(frame_offset_b, 1, &bb);
                     frame_offset_b += 1;
                     if (flag) {
-                        flag = read_bitsBE_b(frame_offset_b, 1, streamFile);
+                        flag = read_bitsBE_b(frame_offset_b, 1, &bb);
                         frame_offset_b += 1;
                         if (flag) {
                             frame_offset_b += 1 + 4 * channels_per_packet*channels_per_packet; /* 4-something per double channel? */
@@ -543,14 +564,14 @@ static void ms_audio_get_samples(ms_sample_data * msd, STREAMFILE *streamFile, i
                 }
 
                 /* get start/end skips to get the proper number of samples */
-                flag = read_bitsBE_b(frame_offset_b, 1, streamFile);
+                flag = read_bitsBE_b(frame_offset_b, 1, &bb);
                 frame_offset_b += 1;
                 if (flag) {
                     /* get start skip */
-                    flag = read_bitsBE_b(frame_offset_b, 1, streamFile);
+                    flag = read_bitsBE_b(frame_offset_b, 1, &bb);
                     frame_offset_b += 1;
                     if (flag) {
-                        int new_skip = read_bitsBE_b(frame_offset_b, 10, streamFile);
+                        int new_skip = read_bitsBE_b(frame_offset_b, 10, &bb);
                         VGM_LOG("MS_SAMPLES: start_skip %i at 0x%lx (bit 0x%lx)\n", new_skip, (off_t)frame_offset_b/8, (off_t)frame_offset_b);
                         VGM_ASSERT(start_skip, "MS_SAMPLES: more than one start_skip (%i)\n", new_skip); //ignore, happens due to incorrect tilehdr_size
                         frame_offset_b += 10;
@@ -563,10 +584,10 @@ static void ms_audio_get_samples(ms_sample_data * msd, STREAMFILE *streamFile, i
                     }
 
                     /* get end skip */
-                    flag = read_bitsBE_b(frame_offset_b, 1, streamFile);
+                    flag = read_bitsBE_b(frame_offset_b, 1, &bb);
                     frame_offset_b += 1;
                     if (flag) {
-                        int new_skip = read_bitsBE_b(frame_offset_b, 10, streamFile);
+                        int new_skip = read_bitsBE_b(frame_offset_b, 10, &bb);
                         VGM_LOG("MS_SAMPLES: end_skip %i at 0x%lx (bit 0x%lx)\n", new_skip, (off_t)frame_offset_b/8, (off_t)frame_offset_b);
                         VGM_ASSERT(end_skip, "MS_SAMPLES: more than one end_skip (%i)\n", new_skip);//ignore, happens due to incorrect tilehdr_size
                         frame_offset_b += 10;
@@ -585,7 +606,7 @@ static void ms_audio_get_samples(ms_sample_data * msd, STREAMFILE *streamFile, i
 
             /* last bit in frame = more frames flag, end packet to avoid reading garbage in some cases
              * (last frame spilling to other packets also has this flag, though it's ignored here) */
-            if (packet_offset_b < packet_size_b && !read_bitsBE_b(offset_b + packet_offset_b - 1, 1, streamFile)) {
+            if (packet_offset_b < packet_size_b && !read_bitsBE_b(offset_b + packet_offset_b - 1, 1, &bb)) {
                 break;
             }
         }
@@ -2,20 +2,35 @@
 #include "ffmpeg_decoder_utils.h"
 
 #ifdef VGM_USE_FFMPEG
+#if !defined(_WIN32) && !defined(WIN32)
+#include <pthread.h>
+#endif
 
 /* internal sizes, can be any value */
 #define FFMPEG_DEFAULT_BUFFER_SIZE 2048
 #define FFMPEG_DEFAULT_IO_BUFFER_SIZE 128 * 1024
 
 
-static volatile int g_ffmpeg_initialized = 0;
-
-
 /* ******************************************** */
 /* INTERNAL UTILS                               */
 /* ******************************************** */
 
 /* Global FFmpeg init */
+#if !defined(_WIN32) && !defined(WIN32)
+static pthread_once_t g_ffmpeg_init_once = PTHREAD_ONCE_INIT;
+
+static void g_init_ffmpeg_once(void) {
+    av_log_set_flags(AV_LOG_SKIP_REPEATED);
+    av_log_set_level(AV_LOG_ERROR);
+    av_register_all();
+}
+
+static void g_init_ffmpeg() {
+    pthread_once(&g_ffmpeg_init_once, g_init_ffmpeg_once);
+}
+#else
+static volatile int g_ffmpeg_initialized = 0;
+
 static void g_init_ffmpeg() {
     if (g_ffmpeg_initialized == 1) {
         while (g_ffmpeg_initialized < 2); /* active wait for lack of a better way */
@@ -28,6 +43,7 @@ static void g_init_ffmpeg() {
         g_ffmpeg_initialized = 2;
     }
 }
+#endif
 
 /* converts codec's samples (can be in any format, ex. Ogg's float32) to PCM16 */
 static void convert_audio(sample *outbuf, const uint8_t *inbuf, int sampleCount, int bitsPerSample, int floatingPoint) {
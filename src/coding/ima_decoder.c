@@ -41,11 +41,38 @@ static const int IMA_IndexTable[16] =
 };
 
 
+/* Small window over the channel's data, so nibbles come from borrowed memory instead of a
+ * read_8bit per sample. Bytes past EOF read as 0xFF, same as read_8bit. */
+typedef struct {
+    STREAMFILE * streamfile;
+    off_t offset;
+    size_t size;
+    const uint8_t * data;
+    uint8_t buf[0x100];
+} ima_window;
+
+static void ima_window_init(ima_window * w, STREAMFILE * streamfile) {
+    w->streamfile = streamfile;
+    w->offset = 0;
+    w->size = 0;
+    w->data = NULL;
+}
+
+static inline uint8_t ima_window_byte(ima_window * w, off_t offset) {
+    if (offset < w->offset || offset >= w->offset + (off_t)w->size) {
+        w->offset = offset;
+        w->size = sizeof(w->buf);
+        w->data = borrow_streamfile(w->buf, w->offset, w->size, w->streamfile);
+    }
+    return w->data[offset - w->offset];
+}
+
+
 /* 3DS IMA (Mario Golf, Mario Tennis; maybe other Camelot games) */
-static void n3ds_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
+static void n3ds_ima_expand_nibble(ima_window * w, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
     int sample_nibble, sample_decoded, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
+    sample_nibble = (ima_window_byte(w, byte_offset) >> nibble_shift)&0xf;
     sample_decoded = *hist1;
 
     sample_decoded = sample_decoded << 3;
@@ -64,10 +91,10 @@ static void n3ds_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset,
 }
 
 /* Standard IMA (most common) */
-static void ms_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
+static void ms_ima_expand_nibble(ima_window * w, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
     int sample_nibble, sample_decoded, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
+    sample_nibble = (ima_window_byte(w, byte_offset) >> nibble_shift)&0xf;
     sample_decoded = *hist1;
     step = ADPCMTable[*step_index];
     delta = step >> 3;
@@ -86,10 +113,10 @@ static void ms_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, i
 }
 
 /* Apple's IMA variation. Exactly the same except it uses 16b history (probably more sensitive to overflow/sign extend) */
-static void ms_ima_expand_nibble_16(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int16_t * hist1, int32_t * step_index) {
+static void ms_ima_expand_nibble_16(ima_window * w, off_t byte_offset, int nibble_shift, int16_t * hist1, int32_t * step_index) {
     int sample_nibble, sample_decoded, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
+    sample_nibble = (ima_window_byte(w, byte_offset) >> nibble_shift)&0xf;
     sample_decoded = *hist1;
     step = ADPCMTable[*step_index];
     delta = step >> 3;
@@ -108,10 +135,10 @@ static void ms_ima_expand_nibble_16(VGMSTREAMCHANNEL * stream, off_t byte_offset
 }
 
 /* update step_index before doing current sample */
-static void snds_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
+static void snds_ima_expand_nibble(ima_window * w, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
     int sample_nibble, sample_decoded, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
+    sample_nibble = (ima_window_byte(w, byte_offset) >> nibble_shift)&0xf;
 
     *step_index += IMA_IndexTable[sample_nibble];
     if (*step_index < 0) *step_index=0;
@@ -127,10 +154,10 @@ static void snds_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset,
 }
 
 /* algorithm by aluigi, unsure if it's a known IMA variation */
-static void otns_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
+static void otns_ima_expand_nibble(ima_window * w, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
     int sample_nibble, sample_decoded, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
+    sample_nibble = (ima_window_byte(w, byte_offset) >> nibble_shift)&0xf;
     sample_decoded = *hist1;
     step = ADPCMTable[*step_index];
     delta = 0;
@@ -150,10 +177,10 @@ static void otns_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset,
 }
 
 /* algorithm by Zench (https://bitbucket.org/Zenchreal/decubisnd) */
-static void ubi_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
+static void ubi_ima_expand_nibble(ima_window * w, off_t byte_offset, int nibble_shift, int32_t * hist1, int32_t * step_index) {
     int sample_nibble, sample_decoded, step, delta;
 
-    sample_nibble = (read_8bit(byte_offset,stream->streamfile) >> nibble_shift)&0xf;
+    sample_nibble = (ima_window_byte(w, byte_offset) >> nibble_shift)&0xf;
 
     step = ADPCMTable[*step_index];
     *step_index += IMA_IndexTable[sample_nibble];
@@ -171,6 +198,7 @@ static void ubi_ima_expand_nibble(VGMSTREAMCHANNEL * stream, off_t byte_offset,
 /* *** */
 
 void decode_nds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_16;//todo unneeded 16?
@@ -188,11 +216,12 @@ void decode_nds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
         //todo clip step_index?
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4 + i/2;
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -201,6 +230,7 @@ void decode_nds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 }
 
 void decode_dat4_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_16;//todo unneeded 16?
@@ -218,11 +248,12 @@ void decode_dat4_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspac
         //todo clip step_index?
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4 + i/2;
         int nibble_shift = (i&1?0:4); //high nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -231,6 +262,7 @@ void decode_dat4_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspac
 }
 
 void decode_ms_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do,int channel) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -250,11 +282,12 @@ void decode_ms_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * out
         if (step_index > 88) step_index=88;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4*channel + 4*vgmstream->channels + i/8*4*vgmstream->channels + (i%8)/2;
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -266,6 +299,7 @@ void decode_ms_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * out
 }
 
 void decode_rad_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do,int channel) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -285,11 +319,12 @@ void decode_rad_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * ou
         if (step_index > 88) step_index=88;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4*vgmstream->channels + channel + i/2*vgmstream->channels;
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -301,6 +336,7 @@ void decode_rad_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * ou
 }
 
 void decode_rad_ima_mono(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -320,11 +356,12 @@ void decode_rad_ima_mono(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
         if (step_index > 88) step_index=88;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4 + i/2;
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -334,6 +371,7 @@ void decode_rad_ima_mono(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
 
 /* For multichannel the internal layout is (I think) mixed stereo channels (ex. 6ch: 2ch + 2ch + 2ch) */
 void decode_xbox_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do,int channel) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -358,6 +396,7 @@ void decode_xbox_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * o
         if (step_index > 88) step_index=88;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         int nibble_shift;
 
@@ -366,7 +405,7 @@ void decode_xbox_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * o
             stream->offset + 4*(channel%2) + 4*2 + i/8*4*2 + (i%8)/2;
         nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -385,6 +424,7 @@ void decode_xbox_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * o
 
 /* mono XBOX ADPCM for interleave */
 void decode_xbox_ima_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
+    ima_window w;
     int i, sample_count = 0, num_frame;
     int32_t hist1 = stream->adpcm_history1_32;
     int step_index = stream->adpcm_step_index;
@@ -410,13 +450,14 @@ void decode_xbox_ima_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
         samples_to_do -= 1;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample; i < first_sample + samples_to_do; i++) { /* first_sample + samples_to_do should be block_samples at most */
         off_t byte_offset = (stream->offset + 0x24*num_frame + 0x4) + (i-1)/2;
         int nibble_shift = ((i-1)&1?4:0); //low nibble first
 
         //last nibble/sample in block is ignored (next header sample contains it)
         if (i < block_samples) {
-            ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+            ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
             outbuf[sample_count] = (short)(hist1);
             sample_count += channelspacing;
         }
@@ -430,6 +471,7 @@ void decode_xbox_ima_int(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
  * Configurable: stereo or mono/interleave nibbles, and high or low nibble first.
  * For vgmstream, low nibble is called "IMA ADPCM" and high nibble is "DVI IMA ADPCM" (same thing though). */
 void decode_standard_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel, int is_stereo, int is_high_first) {
+    ima_window w;
     int i, sample_count = 0;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -442,6 +484,7 @@ void decode_standard_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
     if (step_index > 88) step_index=88;
 
     /* decode nibbles */
+    ima_window_init(&w, stream->streamfile);
     for (i = first_sample; i < first_sample + samples_to_do; i++, sample_count += channelspacing) {
         off_t byte_offset = is_stereo ?
                 stream->offset + i :    /* stereo: one nibble per channel */
@@ -450,7 +493,7 @@ void decode_standard_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
                 is_stereo ? (!(channel&1) ? 4:0) : (!(i&1) ? 4:0) : /* even = high, odd = low */
                 is_stereo ? (!(channel&1) ? 0:4) : (!(i&1) ? 0:4);  /* even = low, odd = high */
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -459,6 +502,7 @@ void decode_standard_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
 }
 
 void decode_3ds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -468,11 +512,12 @@ void decode_3ds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
     //no header
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + i/2;
         int nibble_shift = (i&1?4:0); //low nibble order
 
-        n3ds_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        n3ds_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -481,6 +526,7 @@ void decode_3ds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 }
 
 void decode_apple_ima4(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    ima_window w;
     int i, sample_count, num_frame;
     int16_t hist1 = stream->adpcm_history1_16;//todo unneeded 16?
     int step_index = stream->adpcm_step_index;
@@ -500,11 +546,12 @@ void decode_apple_ima4(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelsp
         if (step_index > 88) step_index=88;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = (stream->offset + 0x22*num_frame + 0x2) + i/2;
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble_16(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble_16(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -513,6 +560,7 @@ void decode_apple_ima4(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelsp
 }
 
 void decode_snds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -522,11 +570,12 @@ void decode_snds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspac
 
     //no header
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + i;//one nibble per channel
         int nibble_shift = (channel==0?0:4); //high nibble first, based on channel
 
-        snds_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        snds_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -535,6 +584,7 @@ void decode_snds_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspac
 }
 
 void decode_otns_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -544,13 +594,14 @@ void decode_otns_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample *
 
     //no header
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + (vgmstream->channels==1 ? i/2 : i); //one nibble per channel if stereo
         int nibble_shift = (vgmstream->channels==1) ? //todo simplify
                     (i&1?0:4) : //high nibble first(?)
                     (channel==0?4:0); //low=ch0, high=ch1 (this is correct compared to vids)
 
-        otns_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        otns_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -559,6 +610,7 @@ void decode_otns_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample *
 }
 
 void decode_fsb_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do,int channel) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -579,11 +631,12 @@ void decode_fsb_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample * o
         if (step_index > 88) step_index=88;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4*vgmstream->channels + 2*channel + i/4*2*vgmstream->channels + (i%4)/2;//2-byte per channel
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -596,6 +649,7 @@ void decode_fsb_ima(VGMSTREAM * vgmstream, VGMSTREAMCHANNEL * stream, sample * o
 
 
 void decode_wwise_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
+    ima_window w;
     int i, sample_count = 0;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -622,13 +676,14 @@ void decode_wwise_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample *
         samples_to_do -= 1;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample; i < first_sample + samples_to_do; i++) { /* first_sample + samples_to_do should be block_samples at most */
         off_t byte_offset = stream->offset + (vgmstream->interleave_block_size / vgmstream->channels)*channel + 4 + (i-1)/2;
         int nibble_shift = ((i-1)&1?4:0); //low nibble first
 
         //last nibble/sample in block is ignored (next header sample contains it)
         if (i < block_samples) {
-            ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+            ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
             outbuf[sample_count] = (short)(hist1);
             sample_count+=channelspacing;
             //todo atenuation: apparently from hcs's analysis Wwise IMA decodes nibbles slightly different, reducing dbs
@@ -644,6 +699,7 @@ void decode_wwise_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample *
 
 /* Reflection's MS-IMA (some layout info from XA2WAV) */
 void decode_ref_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do,int channel) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -665,11 +721,12 @@ void decode_ref_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * ou
     }
 
     //layout: all nibbles from one channel, then all nibbles from other
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4*vgmstream->channels + block_channel_size*channel + i/2;
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -681,6 +738,7 @@ void decode_ref_ima(VGMSTREAM * vgmstream,VGMSTREAMCHANNEL * stream, sample * ou
 }
 
 void decode_awc_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do) {
+    ima_window w;
     int i, sample_count;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -700,11 +758,12 @@ void decode_awc_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
         if (step_index > 88) step_index=88;
     }
 
+    ima_window_init(&w, stream->streamfile);
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
         off_t byte_offset = stream->offset + 4 + i/2;
         int nibble_shift = (i&1?4:0); //low nibble first
 
-        ms_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ms_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1);
     }
 
@@ -718,6 +777,7 @@ void decode_awc_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
 /* DVI stereo/mono with some mini header and sample output */
 void decode_ubi_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing, int32_t first_sample, int32_t samples_to_do, int channel) {
+    ima_window w;
     int i, sample_count = 0;
 
     int32_t hist1 = stream->adpcm_history1_32;
@@ -759,6 +819,7 @@ void decode_ubi_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
     first_sample -= 10; //todo fix hack (needed to adjust nibble offset below)
 
+    ima_window_init(&w, stream->streamfile);
     for (i = first_sample; i < first_sample + samples_to_do; i++, sample_count += channelspacing) {
         off_t byte_offset = channelspacing == 1 ?
                 stream->offset + i/2 :  /* mono mode */
@@ -767,7 +828,7 @@ void decode_ubi_ima(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
                 (!(i%2) ? 4:0) :        /* mono mode (high first) */
                 (channel==0 ? 4:0);     /* stereo mode (high=L,low=R) */
 
-        ubi_ima_expand_nibble(stream, byte_offset,nibble_shift, &hist1, &step_index);
+        ubi_ima_expand_nibble(&w, byte_offset,nibble_shift, &hist1, &step_index);
         outbuf[sample_count] = (short)(hist1); /* all samples are written */
     }
 
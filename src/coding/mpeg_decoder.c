@@ -4,6 +4,9 @@
 
 #ifdef VGM_USE_MPEG
 #include <mpg123.h>
+#if !defined(_WIN32) && !defined(WIN32)
+#include <pthread.h>
+#endif
 #include "mpeg_decoder.h"
 
 
@@ -14,11 +17,13 @@
  */
 
 #define MPEG_DATA_BUFFER_SIZE 0x1000 /* at least one MPEG frame (max ~0x5A1) */
+#define MPEG_SEEK_PREROLL_FRAMES 4  /* restart a few frames early to refill the bit reservoir and overlap */
 
 static mpg123_handle * init_mpg123_handle();
 static void decode_mpeg_standard(VGMSTREAMCHANNEL *stream, mpeg_codec_data * data, sample * outbuf, int32_t samples_to_do, int channels);
 static void decode_mpeg_custom(VGMSTREAM * vgmstream, mpeg_codec_data * data, sample * outbuf, int32_t samples_to_do, int channels);
 static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data * data, int num_stream);
+static void add_index_entry(mpeg_codec_data * data, mpeg_custom_stream * ms, VGMSTREAMCHANNEL * stream);
 
 
 /* Inits regular MPEG */
@@ -175,10 +180,33 @@ fail:
 }
 
 
+#if !defined(_WIN32) && !defined(WIN32)
+static pthread_once_t mpg123_init_once = PTHREAD_ONCE_INIT;
+static int mpg123_init_rc = MPG123_NOT_INITIALIZED;
+
+static void init_mpg123_library_once(void) {
+    mpg123_init_rc = mpg123_init();
+}
+#endif
+
+/* Inits the mpg123 library once. mpg123_init isn't thread-safe, so this must be called before starting threads
+ * that may open MPEG (without threads it's done when the first handle is made). */
+int mpeg_init_library(void) {
+#if !defined(_WIN32) && !defined(WIN32)
+    pthread_once(&mpg123_init_once, init_mpg123_library_once);
+    return mpg123_init_rc == MPG123_OK;
+#else
+    return 1;
+#endif
+}
+
 static mpg123_handle * init_mpg123_handle() {
     mpg123_handle *m = NULL;
     int rc;
 
+    if (!mpeg_init_library())
+        goto fail;
+
     /* inits a new mpg123 handle */
     m = mpg123_new(NULL,&rc);
     if (rc == MPG123_NOT_INITIALIZED) {
@@ -388,6 +416,8 @@ static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data
     /* read more raw data (could fill the sample buffer too in some cases, namely EALayer3) */
     if (!data->buffer_full) {
         //;VGM_LOG("MPEG: reading more raw data\n");
+        add_index_entry(data, ms, stream);
+
         switch(data->type) {
             case MPEG_EAL31:
             case MPEG_EAL32P:
@@ -401,6 +431,7 @@ static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data
             goto decode_fail; /* mpg123 could resync but custom MPEGs wouldn't need that */
         }
         //;VGM_LOG("MPEG: read results: bytes_in_buffer=0x%x, new offset=%lx\n", data->bytes_in_buffer, stream->offset);
+        ms->pcm_sample += ms->samples_filled; /* EALayer3 PCM blocks */
 
         /* parse frame may not touch the buffer (only move offset, or fill the sample buffer) */
         if (data->bytes_in_buffer) {
@@ -419,6 +450,7 @@ static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data
                 (unsigned char*)ms->output_buffer + bytes_filled, ms->output_buffer_size - bytes_filled,
                 &bytes_done);
         data->buffer_used = 1;
+        ms->frames_pending++;
     }
     else {
         //;VGM_LOG("MPEG: get samples from old data\n");
@@ -428,6 +460,9 @@ static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data
                 &bytes_done);
     }
     samples_filled = (bytes_done / sizeof(sample) / data->channels_per_frame);
+    if (samples_filled && ms->frames_pending > 0) /* the output buffer fits one frame */
+        ms->frames_pending--;
+    ms->pcm_sample += samples_filled;
 
     /* discard for weird features (EALayer3 and PCM blocks, AWC and repeated frames) */
     if (ms->decode_to_discard) {
@@ -440,11 +475,22 @@ static void decode_mpeg_custom_stream(VGMSTREAMCHANNEL *stream, mpeg_codec_data
         bytes_done -= bytes_to_discard;
         ms->decode_to_discard -= decode_to_discard;
         ms->samples_used += decode_to_discard;
+        ms->pcm_sample -= decode_to_discard;
     }
 
     /* if no decoding was done bytes_done will be zero */
     ms->samples_filled += samples_filled;
 
+    /* discard after seeking, per stream as each may have restarted at a different sample */
+    if (ms->seek_to_discard) {
+        size_t seek_to_discard = ms->samples_filled - ms->samples_used;
+        if (seek_to_discard > ms->seek_to_discard)
+            seek_to_discard = ms->seek_to_discard;
+
+        ms->seek_to_discard -= seek_to_discard;
+        ms->samples_used += seek_to_discard;
+    }
+
     /* not enough raw data, set flag to request more next time
      * (but only with empty mpg123 buffer, EA blocks wait for all samples decoded before advancing blocks) */
     if (!bytes_done && rc == MPG123_NEED_MORE) {
@@ -463,6 +509,35 @@ decode_fail:
 }
 
 
+/* Saves the current frame as a restart point, if the decoder returned all frames fed so far (mpg123 may hold
+ * the first frame until it gets the next one). P3D data isn't fed in whole frames. */
+static void add_index_entry(mpeg_codec_data * data, mpeg_custom_stream * ms, VGMSTREAMCHANNEL * stream) {
+    mpeg_custom_index_entry * entry;
+
+    if (ms->frames_pending > 0 || data->type == MPEG_P3D)
+        return;
+    if (ms->index_count > 0 && ms->pcm_sample <= ms->index[ms->index_count-1].sample)
+        return;
+
+    if (ms->index_count == ms->index_max) {
+        int index_max = ms->index_max ? ms->index_max * 2 : 0x400;
+        mpeg_custom_index_entry * index = realloc(ms->index, index_max * sizeof(mpeg_custom_index_entry));
+        if (!index) return; /* no more seeking help, not fatal */
+
+        ms->index = index;
+        ms->index_max = index_max;
+    }
+
+    entry = &ms->index[ms->index_count];
+    entry->offset = stream->offset;
+    entry->sample = ms->pcm_sample;
+    entry->current_size_count = ms->current_size_count;
+    entry->current_size_target = ms->current_size_target;
+    entry->decode_to_discard = ms->decode_to_discard;
+    ms->index_count++;
+}
+
+
 /*********/
 /* UTILS */
 /*********/
@@ -479,6 +554,7 @@ void free_mpeg(mpeg_codec_data *data) {
         for (i=0; i < data->streams_size; i++) {
             mpg123_delete(data->streams[i]->m);
             free(data->streams[i]->output_buffer);
+            free(data->streams[i]->index);
             free(data->streams[i]);
         }
         free(data->streams);
@@ -511,7 +587,12 @@ void reset_mpeg(VGMSTREAM *vgmstream) {
             mpg123_feedseek(data->streams[i]->m,0,SEEK_SET,&input_offset);
             data->streams[i]->samples_filled = 0;
             data->streams[i]->samples_used = 0;
+            data->streams[i]->current_size_count = 0;
+            data->streams[i]->current_size_target = 0;
             data->streams[i]->decode_to_discard = 0;
+            data->streams[i]->pcm_sample = 0;
+            data->streams[i]->seek_to_discard = 0;
+            data->streams[i]->frames_pending = 0;
         }
 
         data->samples_to_discard = data->skip_samples; /* initial delay */
@@ -525,17 +606,73 @@ void seek_mpeg(VGMSTREAM *vgmstream, int32_t num_sample) {
     /* seek multistream */
     if (!data->custom) {
         mpg123_feedseek(data->m, num_sample,SEEK_SET,&input_offset);
+
+        /* when looping the loop_ch are copied over after this */
+        vgmstream->ch[0].offset = vgmstream->ch[0].channel_start_offset + input_offset;
         if (vgmstream->loop_ch)
             vgmstream->loop_ch[0].offset = vgmstream->loop_ch[0].channel_start_offset + input_offset;
     }
+    else if (vgmstream->layout_type == layout_none || vgmstream->layout_type == layout_mpeg_custom) {
+        int i;
+        int32_t stream_sample = num_sample + data->skip_samples;
+
+        /* Frames are indexed per stream as they are decoded, so restart each from the closest one (minus a few
+         * as Layer III frames use data from previous ones) and discard until the expected sample */
+        for (i=0; i < data->streams_size; i++) {
+            mpeg_custom_stream *ms = data->streams[i];
+            off_t offset = vgmstream->ch[i].channel_start_offset;
+            int lo = 0, hi = ms->index_count - 1, entry = -1;
+
+            while (lo <= hi) {
+                int mid = (lo + hi) / 2;
+                if (ms->index[mid].sample <= stream_sample) {
+                    entry = mid;
+                    lo = mid + 1;
+                }
+                else {
+                    hi = mid - 1;
+                }
+            }
+            entry -= MPEG_SEEK_PREROLL_FRAMES;
+
+            mpg123_open_feed(ms->m);
+            ms->samples_filled = 0;
+            ms->samples_used = 0;
+            ms->frames_pending = 0;
+            if (entry >= 0) {
+                offset = ms->index[entry].offset;
+                ms->current_size_count = ms->index[entry].current_size_count;
+                ms->current_size_target = ms->index[entry].current_size_target;
+                ms->decode_to_discard = ms->index[entry].decode_to_discard;
+                ms->pcm_sample = ms->index[entry].sample;
+            }
+            else {
+                ms->current_size_count = 0;
+                ms->current_size_target = 0;
+                ms->decode_to_discard = 0;
+                ms->pcm_sample = 0;
+            }
+            ms->seek_to_discard = stream_sample - ms->pcm_sample;
+
+            /* when looping the loop_ch are copied over after this */
+            vgmstream->ch[i].offset = offset;
+            if (vgmstream->loop_ch)
+                vgmstream->loop_ch[i].offset = offset;
+        }
+
+        data->samples_to_discard = 0;
+    }
     else {
         int i;
-        /* re-start from 0 */
+        /* blocked layouts also move the offsets, so re-start from 0 */
         for (i=0; i < data->streams_size; i++) {
             mpg123_feedseek(data->streams[i]->m,0,SEEK_SET,&input_offset);
             data->streams[i]->samples_filled = 0;
             data->streams[i]->samples_used = 0;
             data->streams[i]->decode_to_discard = 0;
+            data->streams[i]->pcm_sample = 0;
+            data->streams[i]->seek_to_discard = 0;
+            data->streams[i]->frames_pending = 0;
 
             if (vgmstream->loop_ch)
                 vgmstream->loop_ch[i].offset = vgmstream->loop_ch[i].channel_start_offset;
@@ -567,6 +704,7 @@ void flush_mpeg(mpeg_codec_data * data) {
             data->streams[i]->samples_filled = 0;
             data->streams[i]->samples_used = 0;
             data->streams[i]->decode_to_discard = 0;
+            data->streams[i]->frames_pending = 0;
         }
 
         data->samples_to_discard = data->skip_samples; /* initial delay */
@@ -7,7 +7,9 @@ void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
 
     int framesin = first_sample/14;
 
-    int8_t header = read_8bit(framesin*8+stream->offset,stream->streamfile);
+    uint8_t frame_buf[0x08];
+    const uint8_t * frame = borrow_streamfile(frame_buf, framesin*8+stream->offset, 0x08, stream->streamfile);
+    int8_t header = frame[0];
     int32_t scale = 1 << (header & 0xf);
     int coef_index = (header >> 4) & 0xf;
     int32_t hist1 = stream->adpcm_history1_16;
@@ -18,7 +20,7 @@ void decode_ngc_dsp(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspaci
     first_sample = first_sample%14;
 
     for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        int sample_byte = read_8bit(framesin*8+stream->offset+1+i/2,stream->streamfile);
+        int sample_byte = (int8_t)frame[1+i/2];
 
         outbuf[sample_count] = clamp16((
                  (((i&1?
@@ -55,10 +55,12 @@ void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
 	uint8_t flag;
 
 	int framesin = first_sample/28;
+	uint8_t frame_buf[0x10];
+	const uint8_t * frame = borrow_streamfile(frame_buf, stream->offset+framesin*16, 0x10, stream->streamfile);
 
-	predict_nr = read_8bit(stream->offset+framesin*16,stream->streamfile) >> 4;
-	shift_factor = read_8bit(stream->offset+framesin*16,stream->streamfile) & 0xf;
-	flag = read_8bit(stream->offset+framesin*16+1,stream->streamfile); /* only lower nibble needed */
+	predict_nr = (int8_t)frame[0] >> 4;
+	shift_factor = frame[0] & 0xf;
+	flag = frame[1]; /* only lower nibble needed */
 
 	first_sample = first_sample % 28;
 	
@@ -68,7 +70,7 @@ void decode_psx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspacing,
 
 		if(flag<0x07) {
 		
-			short sample_byte = (short)read_8bit(stream->offset+(framesin*16)+2+i/2,stream->streamfile);
+			short sample_byte = (short)(int8_t)frame[2+i/2];
 
 			scale = ((i&1 ? /* odd/even byte */
 				     sample_byte >> 4 :
@@ -98,11 +100,13 @@ void decode_psx_bmdx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspac
 	uint8_t flag;
 
 	int framesin = first_sample/28;
-    int head = read_8bit(stream->offset+framesin*16,stream->streamfile) ^ stream->bmdx_xor;
+	uint8_t frame_buf[0x10];
+	const uint8_t * frame = borrow_streamfile(frame_buf, stream->offset+framesin*16, 0x10, stream->streamfile);
+    int head = (int8_t)frame[0] ^ stream->bmdx_xor;
 
 	predict_nr = ((head >> 4) & 0xf);
 	shift_factor = (head & 0xf);
-	flag = read_8bit(stream->offset+framesin*16+1,stream->streamfile);
+	flag = frame[1];
 
 	first_sample = first_sample % 28;
 	
@@ -112,7 +116,7 @@ void decode_psx_bmdx(VGMSTREAMCHANNEL * stream, sample * outbuf, int channelspac
 
 		if(flag<0x07) {
 		
-			short sample_byte = (short)read_8bit(stream->offset+(framesin*16)+2+i/2,stream->streamfile);
+			short sample_byte = (short)(int8_t)frame[2+i/2];
             if (i/2 == 0)
                 sample_byte = (short)(int8_t)(sample_byte+stream->bmdx_add);
 
@@ -143,13 +147,15 @@ void decode_psx_badflags(VGMSTREAMCHANNEL * stream, sample * outbuf, int channel
 	int32_t sample_count;
 
 	int framesin = first_sample/28;
+	uint8_t frame_buf[0x10];
+	const uint8_t * frame = borrow_streamfile(frame_buf, stream->offset+framesin*16, 0x10, stream->streamfile);
 
-	predict_nr = read_8bit(stream->offset+framesin*16,stream->streamfile) >> 4;
-	shift_factor = read_8bit(stream->offset+framesin*16,stream->streamfile) & 0xf;
+	predict_nr = (int8_t)frame[0] >> 4;
+	shift_factor = frame[0] & 0xf;
 	first_sample = first_sample % 28;
 	
 	for (i=first_sample,sample_count=0; i<first_sample+samples_to_do; i++,sample_count+=channelspacing) {
-        short sample_byte = (short)read_8bit(stream->offset+(framesin*16)+2+i/2,stream->streamfile);
+        short sample_byte = (short)(int8_t)frame[2+i/2];
 
         scale = ((i&1 ?
                     sample_byte >> 4 :
@@ -8,6 +8,7 @@
 #define VORBIS_DEFAULT_BUFFER_SIZE 0x8000 /* should be at least the size of the setup header, ~0x2000 */
 
 static void pcm_convert_float_to_16(vorbis_custom_codec_data * data, sample * outbuf, int samples_to_do, float ** pcm);
+static void add_index_entry(vorbis_custom_codec_data * data, VGMSTREAMCHANNEL * stream);
 
 /**
  * Inits a vorbis stream of some custom variety.
@@ -117,6 +118,7 @@ void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t sample
             /* mark consumed samples from the buffer
              * (non-consumed samples are returned in next vorbis_synthesis_pcmout calls) */
             vorbis_synthesis_read(&data->vd, samples_to_get);
+            data->pcm_sample += samples_to_get;
         }
         else { /* read more data */
             int ok, rc;
@@ -125,6 +127,9 @@ void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t sample
             data->op.granulepos += samples_to_do; /* can be changed next if desired */
             data->op.packetno++;
 
+            /* all samples were read, so the next ones come from this packet */
+            add_index_entry(data, stream);
+
             /* read/transform data into the ogg_packet buffer and advance offsets */
             switch(data->type) {
                 case VORBIS_FSB:    ok = vorbis_custom_parse_packet_fsb(stream, data); break;
@@ -135,6 +140,7 @@ void decode_vorbis_custom(VGMSTREAM * vgmstream, sample * outbuf, int32_t sample
             }
             if(!ok) {
                 VGM_LOG("Vorbis: cannot parse packet @ around %lx\n",stream->offset);
+                data->prev_packet_valid = 0;
                 goto decode_fail;
             }
 
@@ -187,6 +193,33 @@ static void pcm_convert_float_to_16(vorbis_custom_codec_data * data, sample * ou
     }
 }
 
+/* Saves where to restart to get the samples of the packet about to be parsed: in the previous packet, as the first
+ * packet decoded after a restart only sets up the overlap. Packets are added in order as they are first decoded. */
+static void add_index_entry(vorbis_custom_codec_data * data, VGMSTREAMCHANNEL * stream) {
+
+    if (data->prev_packet_valid &&
+            (data->index_count == 0 || data->pcm_sample > data->index[data->index_count-1].sample)) {
+        if (data->index_count == data->index_max) {
+            int index_max = data->index_max ? data->index_max * 2 : 0x400;
+            vorbis_custom_index_entry * index = realloc(data->index, index_max * sizeof(vorbis_custom_index_entry));
+            if (!index) goto save_packet; /* no more seeking help, not fatal */
+
+            data->index = index;
+            data->index_max = index_max;
+        }
+
+        data->index[data->index_count] = data->prev_packet;
+        data->index[data->index_count].sample = data->pcm_sample;
+        data->index_count++;
+    }
+
+save_packet:
+    data->prev_packet.offset = stream->offset;
+    data->prev_packet.current_packet = data->current_packet;
+    data->prev_packet.prev_blockflag = data->prev_blockflag;
+    data->prev_packet_valid = 1;
+}
+
 /* ********************************************** */
 
 void free_vorbis_custom(vorbis_custom_codec_data * data) {
@@ -199,27 +232,61 @@ void free_vorbis_custom(vorbis_custom_codec_data * data) {
     vorbis_dsp_clear(&data->vd);
 
     free(data->buffer);
+    free(data->index);
     free(data);
 }
 
 void reset_vorbis_custom(VGMSTREAM *vgmstream) {
     vorbis_custom_codec_data *data = vgmstream->codec_data;
 
-    /* Seeking is provided by the Ogg layer, so with custom vorbis we'd need seek tables instead.
-     * To avoid having to parse different formats we'll just discard until the expected sample */
     vorbis_synthesis_restart(&data->vd);
     data->samples_to_discard = 0;
+    data->samples_full = 0;
+    data->current_packet = 0;
+    data->prev_blockflag = 0;
+    data->pcm_sample = 0;
+    data->prev_packet_valid = 0;
 }
 
 void seek_vorbis_custom(VGMSTREAM *vgmstream, int32_t num_sample) {
     vorbis_custom_codec_data *data = vgmstream->codec_data;
+    off_t offset = vgmstream->ch[0].channel_start_offset;
+    int lo = 0, hi = data->index_count - 1, entry = -1;
 
     /* Seeking is provided by the Ogg layer, so with custom vorbis we'd need seek tables instead.
-     * To avoid having to parse different formats we'll just discard until the expected sample */
+     * Packets are indexed as they are decoded, so restart from the closest one and discard until the expected
+     * sample (from the start if it wasn't decoded yet) */
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (data->index[mid].sample <= num_sample) {
+            entry = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
     vorbis_synthesis_restart(&data->vd);
-    data->samples_to_discard = num_sample;
+    data->samples_full = 0;
+    data->prev_packet_valid = 0;
+    if (entry >= 0) {
+        offset = data->index[entry].offset;
+        data->current_packet = data->index[entry].current_packet;
+        data->prev_blockflag = data->index[entry].prev_blockflag;
+        data->pcm_sample = data->index[entry].sample;
+    }
+    else {
+        data->current_packet = 0;
+        data->prev_blockflag = 0;
+        data->pcm_sample = 0;
+    }
+    data->samples_to_discard = num_sample - data->pcm_sample;
+
+    /* when looping the loop_ch are copied over after this */
+    vgmstream->ch[0].offset = offset;
     if (vgmstream->loop_ch)
-        vgmstream->loop_ch[0].offset = vgmstream->loop_ch[0].channel_start_offset;
+        vgmstream->loop_ch[0].offset = offset;
 }
 
 #endif
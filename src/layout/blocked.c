@@ -1,6 +1,9 @@
 #include "layout.h"
 #include "../vgmstream.h"
 
+static int32_t get_block_samples(VGMSTREAM * vgmstream, int frame_size, int samples_per_frame);
+static void add_block_index(VGMSTREAM * vgmstream);
+
 void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
     int samples_written=0;
 
@@ -9,13 +12,7 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
     int samples_this_block;
 
     /* get samples in the current block */
-    if (vgmstream->current_block_samples) {
-        samples_this_block = vgmstream->current_block_samples;
-    } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
-        samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-    } else {
-        samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-    }
+    samples_this_block = get_block_samples(vgmstream, frame_size, samples_per_frame);
 
     /* decode all samples */
     while (samples_written < sample_count) {
@@ -23,13 +20,7 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
 
         if (vgmstream->loop_flag && vgmstream_do_loop(vgmstream)) {
             /* on loop those values are changed */
-            if (vgmstream->current_block_samples) {
-                samples_this_block = vgmstream->current_block_samples;
-            } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
-                samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-            } else {
-                samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-            }
+            samples_this_block = get_block_samples(vgmstream, frame_size, samples_per_frame);
             continue;
         }
 
@@ -64,122 +55,245 @@ void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM *
         /* move to next block when all samples are consumed */
         if (vgmstream->samples_into_block==samples_this_block
                 /*&& vgmstream->current_sample < vgmstream->num_samples*/) { /* don't go past last block */
-            switch (vgmstream->layout_type) {
-                case layout_ast_blocked:
-                    ast_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_mxch_blocked:
-                    mxch_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_halpst_blocked:
-                    if (vgmstream->next_block_offset>=0)
-                        halpst_block_update(vgmstream->next_block_offset,vgmstream);
-                    else
-                        vgmstream->current_block_offset = -1;
-                    break;
-                case layout_xa_blocked:
-                    xa_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ea_blocked:
-                    ea_schl_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_blocked_ea_1snh:
-                    block_update_ea_1snh(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_caf_blocked:
-                    caf_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_wsi_blocked:
-                    wsi_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_str_snds_blocked:
-                    str_snds_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ws_aud_blocked:
-                    ws_aud_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_matx_blocked:
-                    matx_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_de2_blocked:
-                    de2_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_emff_ps2_blocked:
-                    emff_ps2_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_emff_ngc_blocked:
-                    emff_ngc_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_gsb_blocked:
-                    gsb_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_vs_blocked:
-                    vs_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_xvas_blocked:
-                    xvas_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_thp_blocked:
-                    thp_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_filp_blocked:
-                    filp_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ivaud_blocked:
-                    ivaud_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_psx_mgav_blocked:
-                    psx_mgav_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ps2_adm_blocked:
-                    ps2_adm_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_dsp_bdsp_blocked:
-                    dsp_bdsp_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_tra_blocked:
-                    tra_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ps2_iab_blocked:
-                    ps2_iab_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ps2_strlr_blocked:
-                    ps2_strlr_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_rws_blocked:
-                    rws_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_hwas_blocked:
-                    hwas_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_ea_sns_blocked:
-                    ea_sns_block_update(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_blocked_awc:
-                    block_update_awc(vgmstream->next_block_offset,vgmstream);
-                    break;
-                case layout_blocked_vgs:
-                    block_update_vgs(vgmstream->next_block_offset,vgmstream);
-                    break;
-                default:
-                    break;
-            }
+            block_update(vgmstream->next_block_offset, vgmstream);
+            if (vgmstream->block_index)
+                add_block_index(vgmstream);
 
             /* for VBR these may change */
             frame_size = get_vgmstream_frame_size(vgmstream); /* for VBR these may change */
             samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
 
             /* get samples in the current block */
-            if (vgmstream->current_block_samples) {
-                samples_this_block = vgmstream->current_block_samples;
-            } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
-                samples_this_block = vgmstream->current_block_size * 2 * samples_per_frame;
-            } else {
-                samples_this_block = vgmstream->current_block_size / frame_size * samples_per_frame;
-            }
+            samples_this_block = get_block_samples(vgmstream, frame_size, samples_per_frame);
 
             vgmstream->samples_into_block = 0;
         }
 
     }
 }
+
+/* set up for the block at the given offset, per layout */
+void block_update(off_t block_offset, VGMSTREAM * vgmstream) {
+    switch (vgmstream->layout_type) {
+        case layout_ast_blocked:
+            ast_block_update(block_offset,vgmstream);
+            break;
+        case layout_mxch_blocked:
+            mxch_block_update(block_offset,vgmstream);
+            break;
+        case layout_halpst_blocked:
+            if (block_offset>=0)
+                halpst_block_update(block_offset,vgmstream);
+            else
+                vgmstream->current_block_offset = -1;
+            break;
+        case layout_xa_blocked:
+            xa_block_update(block_offset,vgmstream);
+            break;
+        case layout_ea_blocked:
+            ea_schl_block_update(block_offset,vgmstream);
+            break;
+        case layout_blocked_ea_1snh:
+            block_update_ea_1snh(block_offset,vgmstream);
+            break;
+        case layout_caf_blocked:
+            caf_block_update(block_offset,vgmstream);
+            break;
+        case layout_wsi_blocked:
+            wsi_block_update(block_offset,vgmstream);
+            break;
+        case layout_str_snds_blocked:
+            str_snds_block_update(block_offset,vgmstream);
+            break;
+        case layout_ws_aud_blocked:
+            ws_aud_block_update(block_offset,vgmstream);
+            break;
+        case layout_matx_blocked:
+            matx_block_update(block_offset,vgmstream);
+            break;
+        case layout_de2_blocked:
+            de2_block_update(block_offset,vgmstream);
+            break;
+        case layout_emff_ps2_blocked:
+            emff_ps2_block_update(block_offset,vgmstream);
+            break;
+        case layout_emff_ngc_blocked:
+            emff_ngc_block_update(block_offset,vgmstream);
+            break;
+        case layout_gsb_blocked:
+            gsb_block_update(block_offset,vgmstream);
+            break;
+        case layout_vs_blocked:
+            vs_block_update(block_offset,vgmstream);
+            break;
+        case layout_xvas_blocked:
+            xvas_block_update(block_offset,vgmstream);
+            break;
+        case layout_thp_blocked:
+            thp_block_update(block_offset,vgmstream);
+            break;
+        case layout_filp_blocked:
+            filp_block_update(block_offset,vgmstream);
+            break;
+        case layout_ivaud_blocked:
+            ivaud_block_update(block_offset,vgmstream);
+            break;
+        case layout_psx_mgav_blocked:
+            psx_mgav_block_update(block_offset,vgmstream);
+            break;
+        case layout_ps2_adm_blocked:
+            ps2_adm_block_update(block_offset,vgmstream);
+            break;
+        case layout_dsp_bdsp_blocked:
+            dsp_bdsp_block_update(block_offset,vgmstream);
+            break;
+        case layout_tra_blocked:
+            tra_block_update(block_offset,vgmstream);
+            break;
+        case layout_ps2_iab_blocked:
+            ps2_iab_block_update(block_offset,vgmstream);
+            break;
+        case layout_ps2_strlr_blocked:
+            ps2_strlr_block_update(block_offset,vgmstream);
+            break;
+        case layout_rws_blocked:
+            rws_block_update(block_offset,vgmstream);
+            break;
+        case layout_hwas_blocked:
+            hwas_block_update(block_offset,vgmstream);
+            break;
+        case layout_ea_sns_blocked:
+            ea_sns_block_update(block_offset,vgmstream);
+            break;
+        case layout_blocked_awc:
+            block_update_awc(block_offset,vgmstream);
+            break;
+        case layout_blocked_vgs:
+            block_update_vgs(block_offset,vgmstream);
+            break;
+        default:
+            break;
+    }
+}
+
+static int32_t get_block_samples(VGMSTREAM * vgmstream, int frame_size, int samples_per_frame) {
+    if (vgmstream->current_block_samples) {
+        return vgmstream->current_block_samples;
+    } else if (frame_size == 0) { /* assume 4 bit */ //TODO: get_vgmstream_frame_size() really should return bits... */
+        return vgmstream->current_block_size * 2 * samples_per_frame;
+    } else {
+        return vgmstream->current_block_size / frame_size * samples_per_frame;
+    }
+}
+
+
+/* Block index: the layout can only move to the next block, but the block starts seen while playing (or found by
+ * walking block headers) are saved so seeks can jump to them, for codecs that can restart at any block. */
+
+/* saves the current block start, if it's past the known ones */
+static void add_block_index(VGMSTREAM * vgmstream) {
+    vgmstream_block_index *index = vgmstream->block_index;
+    vgmstream_block_index_entry *entry;
+
+    if (vgmstream->current_block_offset < 0)
+        return;
+    if (index->count > 0 && vgmstream->current_sample <= index->entries[index->count-1].sample)
+        return;
+
+    if (index->count == index->max) {
+        int max = index->max ? index->max * 2 : 0x100;
+        vgmstream_block_index_entry *entries = realloc(index->entries, max * sizeof(vgmstream_block_index_entry));
+        if (!entries) return; /* no more seeking help, not fatal */
+
+        index->entries = entries;
+        index->max = max;
+    }
+
+    entry = &index->entries[index->count];
+    entry->offset = vgmstream->current_block_offset;
+    entry->next_offset = vgmstream->next_block_offset;
+    entry->sample = vgmstream->current_sample;
+    index->count++;
+}
+
+/* reads block headers past the known blocks until the one with seek_sample, on a copy as updates change the channels */
+static void walk_block_index(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    vgmstream_block_index *index = vgmstream->block_index;
+    VGMSTREAM walk;
+    VGMSTREAMCHANNEL *walk_ch = NULL;
+
+    if (index->count > 0 && index->entries[index->count-1].sample > seek_sample)
+        return;
+
+    walk_ch = malloc(sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+    if (!walk_ch) return;
+
+    if (index->count > 0) {
+        vgmstream_block_index_entry *entry = &index->entries[index->count-1];
+
+        memcpy(&walk, vgmstream, sizeof(VGMSTREAM));
+        memcpy(walk_ch, vgmstream->ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+        walk.ch = walk_ch;
+        block_update(entry->offset, &walk);
+        walk.next_block_offset = entry->next_offset;
+        walk.current_sample = entry->sample;
+    }
+    else {
+        memcpy(&walk, vgmstream->start_vgmstream, sizeof(VGMSTREAM));
+        memcpy(walk_ch, vgmstream->start_ch, sizeof(VGMSTREAMCHANNEL) * vgmstream->channels);
+        walk.ch = walk_ch;
+    }
+
+    while (walk.current_block_offset >= 0) {
+        int32_t samples_this_block = get_block_samples(&walk, get_vgmstream_frame_size(&walk), get_vgmstream_samples_per_frame(&walk));
+        off_t block_offset = walk.current_block_offset;
+
+        if (samples_this_block <= 0)
+            break;
+        if (walk.current_sample + samples_this_block > seek_sample || walk.current_sample + samples_this_block >= walk.num_samples)
+            break;
+
+        walk.current_sample += samples_this_block;
+        block_update(walk.next_block_offset, &walk);
+        if (walk.current_block_offset <= block_offset) /* just in case */
+            break;
+        add_block_index(&walk);
+    }
+
+    free(walk_ch);
+}
+
+/* Returns the index entry of the block with seek_sample, or -1 if it's the first block. */
+int find_block_index(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    vgmstream_block_index *index = vgmstream->block_index;
+    int lo = 0, hi, entry = -1;
+
+    if (!index)
+        return -1;
+
+    walk_block_index(vgmstream, seek_sample);
+
+    hi = index->count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (index->entries[mid].sample <= seek_sample) {
+            entry = mid;
+            lo = mid + 1;
+        }
+        else {
+            hi = mid - 1;
+        }
+    }
+
+    return entry;
+}
+
+/* moves a reset stream to the start of a block returned by find_block_index */
+void seek_block_index(VGMSTREAM * vgmstream, int entry) {
+    vgmstream_block_index *index = vgmstream->block_index;
+
+    block_update(index->entries[entry].offset, vgmstream);
+    vgmstream->next_block_offset = index->entries[entry].next_offset;
+    vgmstream->current_sample = index->entries[entry].sample;
+    vgmstream->samples_into_block = 0;
+}
@@ -10,6 +10,9 @@ void ast_block_update(off_t block_ofset, VGMSTREAM * vgmstream);
 void mxch_block_update(off_t block_ofset, VGMSTREAM * vgmstream);
 
 void render_vgmstream_blocked(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream);
+void block_update(off_t block_offset, VGMSTREAM * vgmstream);
+int find_block_index(VGMSTREAM * vgmstream, int32_t seek_sample);
+void seek_block_index(VGMSTREAM * vgmstream, int entry);
 
 void halpst_block_update(off_t block_ofset, VGMSTREAM * vgmstream);
 
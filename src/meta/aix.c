@@ -377,7 +377,7 @@ static STREAMFILE *open_aix_impl(AIXSTREAMFILE *streamfile,const char * const fi
   if (strcmp(filename,"ARBITRARY.ADX"))
       return  NULL;
 
-  newfile = malloc(sizeof(AIXSTREAMFILE));
+  newfile = calloc(1,sizeof(AIXSTREAMFILE));
   if (!newfile)
       return NULL;
   memcpy(newfile,streamfile,sizeof(AIXSTREAMFILE));
@@ -386,7 +386,8 @@ static STREAMFILE *open_aix_impl(AIXSTREAMFILE *streamfile,const char * const fi
 
 static STREAMFILE *open_aix_with_STREAMFILE(STREAMFILE *file,off_t start_offset,int stream_id)
 {
-  AIXSTREAMFILE *streamfile = malloc(sizeof(AIXSTREAMFILE));
+  STREAMFILE *bufferFile;
+  AIXSTREAMFILE *streamfile = calloc(1,sizeof(AIXSTREAMFILE));
 
   if (!streamfile)
     return NULL;
@@ -400,10 +401,8 @@ static STREAMFILE *open_aix_with_STREAMFILE(STREAMFILE *file,off_t start_offset,
   streamfile->sf.get_realname = (void*)get_name_aix;
   streamfile->sf.open = (void*)open_aix_impl;
   streamfile->sf.close = (void*)close_aix;
-#ifdef PROFILE_STREAMFILE
-  streamfile->sf.get_bytes_read = NULL;
-  streamfile->sf.get_error_count = NULL;
-#endif
+  streamfile->sf.borrow = NULL;
+  streamfile->sf.get_stats = NULL;
 
   streamfile->real_file = file;
   streamfile->current_physical_offset = 
@@ -411,7 +410,12 @@ static STREAMFILE *open_aix_with_STREAMFILE(STREAMFILE *file,off_t start_offset,
   streamfile->current_logical_offset = 0;
   streamfile->current_block_size = 0;
   streamfile->stream_id = stream_id;
-  
-  return &streamfile->sf;
+  streamfile->sf.stream_index = 0;
+
+  /* buffered, as each small read from the decoder may need to walk the blocks */
+  bufferFile = open_buffer_streamfile(&streamfile->sf,0);
+  if (!bufferFile)
+    free(streamfile);
+  return bufferFile;
 }
 
@@ -71,9 +71,15 @@ typedef struct {
     int codec_version;
 } ea_header;
 
+typedef struct {
+    off_t start_offset;
+    ea_header ea;
+} ea_samples_config;
+
 static int parse_variable_header(STREAMFILE* streamFile, ea_header* ea, off_t begin_offset, int max_length);
 static uint32_t read_patch(STREAMFILE* streamFile, off_t* offset);
 static int get_ea_stream_total_samples(STREAMFILE* streamFile, off_t start_offset, const ea_header* ea);
+static void update_ea_stream_samples(VGMSTREAM * vgmstream, STREAMFILE* streamFile, const void * config);
 static off_t get_ea_stream_mpeg_start_offset(STREAMFILE* streamFile, off_t start_offset, const ea_header* ea);
 static VGMSTREAM * init_vgmstream_ea_variable_header(STREAMFILE *streamFile, ea_header *ea, off_t start_offset, int is_bnk, int total_streams);
 
@@ -354,11 +360,13 @@ static VGMSTREAM * init_vgmstream_ea_variable_header(STREAMFILE *streamFile, ea_
     if (!vgmstream_open_stream(vgmstream,streamFile,start_offset))
         goto fail;
 
-    /* fix num_samples for streams with multiple SCHl */
+    /* fix num_samples for streams with multiple SCHl (may be deferred, the first header's num_samples until then) */
     if (!is_bnk) {
-        int total_samples = get_ea_stream_total_samples(streamFile, start_offset, ea);
-        if (total_samples > vgmstream->num_samples)
-           vgmstream->num_samples = total_samples;
+        ea_samples_config cfg;
+
+        cfg.start_offset = start_offset;
+        cfg.ea = *ea;
+        set_vgmstream_lazy_samples(vgmstream, streamFile, update_ea_stream_samples, &cfg, sizeof(cfg));
     }
 
 
@@ -820,6 +828,13 @@ static int get_ea_stream_total_samples(STREAMFILE* streamFile, off_t start_offse
     return num_samples;
 }
 
+static void update_ea_stream_samples(VGMSTREAM * vgmstream, STREAMFILE* streamFile, const void * config) {
+    const ea_samples_config * cfg = config;
+    int total_samples = get_ea_stream_total_samples(streamFile, cfg->start_offset, &cfg->ea);
+    if (total_samples > vgmstream->num_samples)
+       vgmstream->num_samples = total_samples;
+}
+
 /* find data start offset inside the first SCDl; not very elegant but oh well */
 static off_t get_ea_stream_mpeg_start_offset(STREAMFILE* streamFile, off_t start_offset, const ea_header* ea) {
     size_t file_size = get_streamfile_size(streamFile);
@@ -28,80 +28,6 @@ static size_t read_func(void *ptr, size_t size, size_t nmemb, void * datasource)
     return items_read;
 }
 
-static size_t read_func_um3(void *ptr, size_t size, size_t nmemb, void * datasource)
-{
-    ogg_vorbis_streamfile * const ov_streamfile = datasource;
-    size_t items_read;
-
-    size_t bytes_read;
-   
-    bytes_read = read_streamfile(ptr, ov_streamfile->offset + ov_streamfile->other_header_bytes, size * nmemb,
-            ov_streamfile->streamfile);
-
-    items_read = bytes_read / size;
-
-    /* first 0x800 bytes of um3 are xor'd with 0xff */
-    if (ov_streamfile->offset < 0x800) {
-        int num_crypt = 0x800-ov_streamfile->offset;
-        int i;
-
-        if (num_crypt > bytes_read) num_crypt=bytes_read;
-        for (i=0;i<num_crypt;i++)
-            ((uint8_t*)ptr)[i] ^= 0xff;
-    }
-
-    ov_streamfile->offset += items_read * size;
-
-    return items_read;
-}
-
-static size_t read_func_kovs(void *ptr, size_t size, size_t nmemb, void * datasource)
-{
-    ogg_vorbis_streamfile * const ov_streamfile = datasource;
-    size_t items_read;
-
-    size_t bytes_read;
-   
-    bytes_read = read_streamfile(ptr, ov_streamfile->offset+ov_streamfile->other_header_bytes, size * nmemb,
-            ov_streamfile->streamfile);
-
-    items_read = bytes_read / size;
-
-    /* first 0x100 bytes of KOVS are xor'd with offset */
-    if (ov_streamfile->offset < 0x100) {
-        int i;
-
-        for (i=ov_streamfile->offset;i<0x100;i++)
-            ((uint8_t*)ptr)[i-ov_streamfile->offset] ^= i;
-    }
-
-    ov_streamfile->offset += items_read * size;
-
-    return items_read;
-}
-
-static size_t read_func_scd(void *ptr, size_t size, size_t nmemb, void * datasource)
-{
-    ogg_vorbis_streamfile * const ov_streamfile = datasource;
-    size_t items_read;
-
-    size_t bytes_read;
-   
-    bytes_read = read_streamfile(ptr, ov_streamfile->offset + ov_streamfile->other_header_bytes, size * nmemb,
-            ov_streamfile->streamfile);
-
-    items_read = bytes_read / size;
-
-    /* may be encrypted */
-    if (ov_streamfile->decryption_enabled) {
-        ov_streamfile->decryption_callback(ptr, size, nmemb, ov_streamfile, bytes_read);
-    }
-
-    ov_streamfile->offset += items_read * size;
-
-    return items_read;
-}
-
 static size_t read_func_psych(void *ptr, size_t size, size_t nmemb, void * datasource)
 {
     ogg_vorbis_streamfile * const ov_streamfile = datasource;
@@ -169,6 +95,8 @@ VGMSTREAM * init_vgmstream_ogg_vorbis(STREAMFILE *streamFile) {
     char filename[PATH_LIMIT];
 
     ov_callbacks callbacks;
+    VGMSTREAM * vgmstream = NULL;
+    STREAMFILE * streamFileOgg = NULL;
 
     off_t other_header_bytes = 0;
     int um3_ogg = 0;
@@ -219,11 +147,34 @@ VGMSTREAM * init_vgmstream_ogg_vorbis(STREAMFILE *streamFile) {
         psych_ogg = 1;
     }
 
-    if (um3_ogg) {
-        callbacks.read_func = read_func_um3;
-    } else if (kovs_ogg) {
-        callbacks.read_func = read_func_kovs;
-    } else if (psych_ogg) {
+    /* decrypt the XOR'd part so libvorbis reads plain data */
+    if (um3_ogg || kovs_ogg) {
+        uint8_t key[0x100];
+        size_t key_size;
+        STREAMFILE * file;
+
+        if (um3_ogg) { /* first 0x800 bytes of um3 are xor'd with 0xff */
+            key[0] = 0xff;
+            key_size = 0x01;
+        }
+        else { /* first 0x100 bytes of KOVS are xor'd with offset */
+            int i;
+            for (i = 0; i < 0x100; i++) {
+                key[i] = i;
+            }
+            key_size = 0x100;
+        }
+
+        file = streamFile->open(streamFile,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
+        if (!file) goto fail;
+        streamFileOgg = open_xor_streamfile(file, key, key_size, other_header_bytes, um3_ogg ? 0x800 : 0x100);
+        if (!streamFileOgg) {
+            close_streamfile(file);
+            goto fail;
+        }
+    }
+
+    if (psych_ogg) {
         callbacks.read_func = read_func_psych;
     } else {
         callbacks.read_func = read_func;
@@ -244,7 +195,10 @@ VGMSTREAM * init_vgmstream_ogg_vorbis(STREAMFILE *streamFile) {
 
     inf.layout_type = layout_ogg_vorbis;
 
-    return init_vgmstream_ogg_vorbis_callbacks(streamFile, filename, &callbacks, other_header_bytes, &inf);
+    vgmstream = init_vgmstream_ogg_vorbis_callbacks(streamFileOgg ? streamFileOgg : streamFile, filename, &callbacks, other_header_bytes, &inf);
+
+    if (streamFileOgg) close_streamfile(streamFileOgg);
+    return vgmstream;
 
 fail:
     return NULL;
@@ -276,10 +230,6 @@ VGMSTREAM * init_vgmstream_ogg_vorbis_callbacks(STREAMFILE *streamFile, const ch
         default_callbacks.close_func = close_func;
         default_callbacks.tell_func = tell_func;
 
-        if (vgm_inf->decryption_enabled) {
-            default_callbacks.read_func = read_func_scd;
-        }
-
         callbacks_p = &default_callbacks;
     }
 
@@ -287,10 +237,6 @@ VGMSTREAM * init_vgmstream_ogg_vorbis_callbacks(STREAMFILE *streamFile, const ch
     temp_streamfile.offset = 0;
     temp_streamfile.size = get_streamfile_size(temp_streamfile.streamfile);
     temp_streamfile.other_header_bytes = other_header_bytes;
-    temp_streamfile.decryption_enabled = vgm_inf->decryption_enabled;
-    temp_streamfile.decryption_callback = vgm_inf->decryption_callback;
-    temp_streamfile.scd_xor = vgm_inf->scd_xor;
-    temp_streamfile.scd_xor_length = vgm_inf->scd_xor_length;
 
     /* can we open this as a proper ogg vorbis file? */
     memset(&temp_ovf, 0, sizeof(temp_ovf));
@@ -311,10 +257,6 @@ VGMSTREAM * init_vgmstream_ogg_vorbis_callbacks(STREAMFILE *streamFile, const ch
     data->ov_streamfile.offset = 0;
     data->ov_streamfile.size = get_streamfile_size(data->ov_streamfile.streamfile);
     data->ov_streamfile.other_header_bytes = other_header_bytes;
-    data->ov_streamfile.decryption_enabled = vgm_inf->decryption_enabled;
-    data->ov_streamfile.decryption_callback = vgm_inf->decryption_callback;
-    data->ov_streamfile.scd_xor = vgm_inf->scd_xor;
-    data->ov_streamfile.scd_xor_length = vgm_inf->scd_xor_length;
 
     /* open the ogg vorbis file for real */
     if (ov_open_callbacks(&data->ov_streamfile, &data->ogg_vorbis_file, NULL,
@@ -29,7 +29,8 @@ VGMSTREAM * init_vgmstream_ps2_jstm(STREAMFILE *streamFile) {
 
     /* fill in the statistics vitale */
     vgmstream->sample_rate = read_32bitLE(0x8,streamFile);
-    vgmstream->coding_type = coding_PCM16LE_XOR_int;
+    vgmstream->coding_type = coding_PCM16_int;
+    vgmstream->codec_endian = 0;
     vgmstream->num_samples = read_32bitLE(0xC,streamFile)/2/channel_count;
     vgmstream->layout_type = layout_none;
 
@@ -40,18 +41,23 @@ VGMSTREAM * init_vgmstream_ps2_jstm(STREAMFILE *streamFile) {
         vgmstream->loop_end_sample=vgmstream->num_samples;
     }
 
-    /* open the file for reading */
+    /* open the file for reading (samples are XOR'd with 0x5A5A) */
     {
+        static const uint8_t key[1] = { 0x5A };
         int i;
-        STREAMFILE * file;
+        STREAMFILE * file, * xorFile;
         file = streamFile->open(streamFile,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
         if (!file) goto fail;
+        xorFile = open_xor_streamfile(file,key,1,start_offset,get_streamfile_size(file)-start_offset);
+        if (!xorFile) {
+            close_streamfile(file);
+            goto fail;
+        }
 
         for (i=0; i < channel_count; i++) {
-            vgmstream->ch[i].streamfile = file;
+            vgmstream->ch[i].streamfile = xorFile;
             vgmstream->ch[i].channel_start_offset = 
                 vgmstream->ch[i].offset = start_offset + 2*i;
-            vgmstream->ch[i].key_xor = 0x5A5A;
         }
     }
 
@@ -39,6 +39,10 @@ VGMSTREAM * init_vgmstream_ps2_mib(STREAMFILE *streamFile) {
     
 	uint8_t mibBuffer[0x10];
 	uint8_t	testBuffer[0x10];
+	uint8_t	chunkBuffer[0x2000];
+	off_t	chunkOffset=0;
+	size_t	chunkSize=0;
+	size_t	frameSize;
 	uint8_t doChannelUpdate=1;
 	uint8_t bDoUpdateInterleave=1;
 
@@ -95,7 +99,19 @@ VGMSTREAM * init_vgmstream_ps2_mib(STREAMFILE *streamFile) {
 	mibBuffer[0]=0;
 
 	do {
-		readOffset+=(off_t)read_streamfile(testBuffer,readOffset,0x10,streamFile); 
+		/* frames are copied from a chunk, as a read call per frame adds up in big files */
+		if(readOffset<chunkOffset || readOffset+0x10>chunkOffset+(off_t)chunkSize) {
+			chunkOffset=readOffset;
+			chunkSize=read_streamfile(chunkBuffer,chunkOffset,sizeof(chunkBuffer),streamFile);
+		}
+		frameSize=0;
+		if(readOffset<chunkOffset+(off_t)chunkSize) {
+			frameSize=chunkOffset+chunkSize-readOffset;
+			if(frameSize>0x10)
+				frameSize=0x10;
+			memcpy(testBuffer,chunkBuffer+(readOffset-chunkOffset),frameSize);
+		}
+		readOffset+=(off_t)frameSize;
 		// be sure to point to an interleave value
 		if(readOffset<(int32_t)(fileLength*0.5)) {
 
@@ -156,7 +172,7 @@ VGMSTREAM * init_vgmstream_ps2_mib(STREAMFILE *streamFile) {
 			}
 		}
 
-	} while (streamFile->get_offset(streamFile)<((int32_t)fileLength));
+	} while (frameSize>0); /* ends after a read past EOF, like checking get_offset did */
 
 	if((testBuffer[0]==0x0c) && (testBuffer[1]==0))
 		forceNoLoop=1;
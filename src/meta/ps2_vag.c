@@ -3,17 +3,26 @@
 
 static int vag_find_loop_offsets(STREAMFILE *streamFile, off_t start_offset, off_t * loop_start, off_t * loop_end);
 
+typedef struct {
+    off_t start_offset;
+    size_t interleave;
+    int channel_count;
+    int frame_loops; /* loop offsets are per frame rather than interleaved */
+} vag_loop_config;
+
+static void vag_update_loops(VGMSTREAM * vgmstream, STREAMFILE *streamFile, const void * config);
+
 /* VAGp - SDK format, created by various Sony's tools (like AIFF2VAG) */
 VGMSTREAM * init_vgmstream_ps2_vag(STREAMFILE *streamFile) {
     VGMSTREAM * vgmstream = NULL;
-    off_t start_offset, loopStart = 0, loopEnd = 0;
+    off_t start_offset;
 
     uint8_t vagID;
     uint32_t version = 0;
 
     size_t filesize = 0, datasize = 0, interleave;
 
-    int loop_flag = 0, loop_samples_found = 0;
+    int loop_flag = 0, find_loops = 0, frame_loops = 0;
     int channel_count = 0;
     int is_swag = 0;
 
@@ -69,13 +78,13 @@ VGMSTREAM * init_vgmstream_ps2_vag(STREAMFILE *streamFile) {
             }
             else if ((version <= 0x00000004) && (datasize < filesize / 2)) { /* two VAGp in the same file */
                 if (is_swag)
-                    loop_flag = vag_find_loop_offsets(streamFile, 0x30, &loopStart, &loopEnd);
+                    find_loops = 1;
                 else
                     loop_flag = read_32bitBE(0x14,streamFile) != 0;
                 channel_count=2;
             }
             else if (version == 0x00020001) { /* HEVAG */
-                loop_flag = vag_find_loop_offsets(streamFile, 0x30, &loopStart, &loopEnd);
+                find_loops = 1;
 
                 /* channels are usually at 0x1e, but not in Ukiyo no Roushi which has some kind
                  *  of loop-like values instead (who designs this crap?) */
@@ -91,7 +100,7 @@ VGMSTREAM * init_vgmstream_ps2_vag(STREAMFILE *streamFile) {
                 }
             }
             else {
-                loop_flag = vag_find_loop_offsets(streamFile, 0x30, &loopStart, &loopEnd);
+                find_loops = 1;
                 channel_count = 1;
             }
             break;
@@ -153,9 +162,7 @@ VGMSTREAM * init_vgmstream_ps2_vag(STREAMFILE *streamFile) {
                     start_offset = 0x30;
                     interleave = datasize;
                     vgmstream->num_samples = datasize / 16 * 28;
-                    vgmstream->loop_start_sample = (loopStart-start_offset) / 16 * 28;
-                    vgmstream->loop_end_sample = (loopEnd-start_offset) / 16 * 28;
-                    loop_samples_found = 1;
+                    frame_loops = 1;
 
                 } else {
                     start_offset=0x80;
@@ -163,7 +170,6 @@ VGMSTREAM * init_vgmstream_ps2_vag(STREAMFILE *streamFile) {
                     if(loop_flag) {
                         vgmstream->loop_start_sample=read_32bitBE(0x14,streamFile);
                         vgmstream->loop_end_sample =read_32bitBE(0x18,streamFile);
-                        loop_samples_found = 1;
                         // Double VAG Header @ 0x0000 & 0x1000
                         if(read_32bitBE(0,streamFile)==read_32bitBE(0x1000,streamFile)) {
                             vgmstream->num_samples = datasize / 16 * 28;
@@ -216,15 +222,15 @@ VGMSTREAM * init_vgmstream_ps2_vag(STREAMFILE *streamFile) {
 
     vgmstream->interleave_block_size=interleave;
 
-    /* Don't add the header size to loop calc points */
-    if(loop_flag && !loop_samples_found) {
-        loopStart-=start_offset;
-        loopEnd-=start_offset;
+    /* loop flags are found by reading the whole stream, which may be deferred (no loops until then) */
+    if (find_loops) {
+        vag_loop_config cfg;
 
-        vgmstream->loop_start_sample = (int32_t)((loopStart/(interleave*channel_count))*interleave)/16*28;
-        vgmstream->loop_start_sample += (int32_t)(loopStart%(interleave*channel_count))/16*28;
-        vgmstream->loop_end_sample = (int32_t)((loopEnd/(interleave*channel_count))*interleave)/16*28;
-        vgmstream->loop_end_sample += (int32_t)(loopEnd%(interleave*channel_count))/16*28;
+        cfg.start_offset = start_offset;
+        cfg.interleave = interleave;
+        cfg.channel_count = channel_count;
+        cfg.frame_loops = frame_loops;
+        set_vgmstream_lazy_samples(vgmstream, streamFile, vag_update_loops, &cfg, sizeof(cfg));
     }
 
     /* always, but can be null or used as special string */
@@ -243,6 +249,33 @@ fail:
 }
 
 
+/* sets loops from the flags found in the stream */
+static void vag_update_loops(VGMSTREAM * vgmstream, STREAMFILE *streamFile, const void * config) {
+    const vag_loop_config * cfg = config;
+    off_t loopStart = 0, loopEnd = 0;
+    size_t interleave = cfg->interleave;
+    int channel_count = cfg->channel_count;
+
+    vgmstream->loop_flag = vag_find_loop_offsets(streamFile, 0x30, &loopStart, &loopEnd);
+    if (!vgmstream->loop_flag)
+        return;
+
+    /* Don't add the header size to loop calc points */
+    loopStart-=cfg->start_offset;
+    loopEnd-=cfg->start_offset;
+
+    if (cfg->frame_loops) {
+        vgmstream->loop_start_sample = loopStart / 16 * 28;
+        vgmstream->loop_end_sample = loopEnd / 16 * 28;
+    }
+    else {
+        vgmstream->loop_start_sample = (int32_t)((loopStart/(interleave*channel_count))*interleave)/16*28;
+        vgmstream->loop_start_sample += (int32_t)(loopStart%(interleave*channel_count))/16*28;
+        vgmstream->loop_end_sample = (int32_t)((loopEnd/(interleave*channel_count))*interleave)/16*28;
+        vgmstream->loop_end_sample += (int32_t)(loopEnd%(interleave*channel_count))/16*28;
+    }
+}
+
 /**
  * Finds loop points in VAG data using flag markers and updates loop_start and loop_end with the global offsets.
  *
@@ -258,6 +291,9 @@ static int vag_find_loop_offsets(STREAMFILE *streamFile, off_t start_offset, off
     uint8_t eofVAG2[16]={0x00,0x07,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00};
     uint8_t readbuf[16];
     uint8_t flag;
+    uint8_t chunk[0x2000]; /* flags are read from a chunk of frames, as a call per frame adds up in big files */
+    off_t chunkOffset = 0;
+    size_t chunkSize = 0;
 
     /* Search for loop in VAG */
     size_t fileLength = get_streamfile_size(streamFile);
@@ -267,7 +303,15 @@ static int vag_find_loop_offsets(STREAMFILE *streamFile, off_t start_offset, off
     do {
         readOffset+=0x10;
 
-        flag = read_8bit(readOffset+0x01,streamFile) & 0x0F; /* lower nibble (for HEVAG) */
+        if (readOffset < chunkOffset || readOffset + 0x02 > chunkOffset + (off_t)chunkSize) {
+            chunkOffset = readOffset;
+            chunkSize = read_streamfile(chunk,chunkOffset,sizeof(chunk),streamFile);
+        }
+
+        if (readOffset + 0x02 > chunkOffset + (off_t)chunkSize)
+            flag = 0x0F; /* past EOF, same as read_8bit's -1 */
+        else
+            flag = chunk[readOffset - chunkOffset + 0x01] & 0x0F; /* lower nibble (for HEVAG) */
 
         // Loop Start ...
         if (flag == 0x06 && !loopStart) {
@@ -303,7 +347,7 @@ static int vag_find_loop_offsets(STREAMFILE *streamFile, off_t start_offset, off
             }
         }
 
-    } while (streamFile->get_offset(streamFile)<(off_t)fileLength);
+    } while (readOffset + 0x01 < (off_t)fileLength);
 
 
     if (loopStart && loopEnd) {
@@ -3,25 +3,26 @@
 
 /* Square-Enix SCD (FF XIII, XIV) */
 
-/* special streamfile type to handle deinterleaving of complete files,
-  (based heavily on AIXSTREAMFILE */
-typedef struct _SCDINTSTREAMFILE
-{
-  STREAMFILE sf;
-  STREAMFILE *real_file;
-  const char * filename;
-  off_t start_physical_offset;
-  off_t current_logical_offset;
-  off_t interleave_block_size;
-  off_t stride_size;
-  size_t total_size;
-} SCDINTSTREAMFILE;
-
-static STREAMFILE *open_scdint_with_STREAMFILE(STREAMFILE *file, const char * filename, off_t start_offset, off_t interleave_block_size, off_t stride_size, size_t total_size);
-
 #ifdef VGM_USE_VORBIS
-static void scd_ogg_decrypt_v2_callback(void *ptr, size_t size, size_t nmemb, void *datasource, int bytes_read);
-static void scd_ogg_decrypt_v3_callback(void *ptr, size_t size, size_t nmemb, void *datasource, int bytes_read);
+/* V3 decryption table found in the .exe (algorithm and table by Ioncannon) */
+static const uint8_t scd_ogg_v3_lookuptable[256] = { /* FF XIV Heavensward */
+    0x3A, 0x32, 0x32, 0x32, 0x03, 0x7E, 0x12, 0xF7, 0xB2, 0xE2, 0xA2, 0x67, 0x32, 0x32, 0x22, 0x32, // 00-0F
+    0x32, 0x52, 0x16, 0x1B, 0x3C, 0xA1, 0x54, 0x7B, 0x1B, 0x97, 0xA6, 0x93, 0x1A, 0x4B, 0xAA, 0xA6, // 10-1F
+    0x7A, 0x7B, 0x1B, 0x97, 0xA6, 0xF7, 0x02, 0xBB, 0xAA, 0xA6, 0xBB, 0xF7, 0x2A, 0x51, 0xBE, 0x03, // 20-2F
+    0xF4, 0x2A, 0x51, 0xBE, 0x03, 0xF4, 0x2A, 0x51, 0xBE, 0x12, 0x06, 0x56, 0x27, 0x32, 0x32, 0x36, // 30-3F
+    0x32, 0xB2, 0x1A, 0x3B, 0xBC, 0x91, 0xD4, 0x7B, 0x58, 0xFC, 0x0B, 0x55, 0x2A, 0x15, 0xBC, 0x40, // 40-4F
+    0x92, 0x0B, 0x5B, 0x7C, 0x0A, 0x95, 0x12, 0x35, 0xB8, 0x63, 0xD2, 0x0B, 0x3B, 0xF0, 0xC7, 0x14, // 50-5F
+    0x51, 0x5C, 0x94, 0x86, 0x94, 0x59, 0x5C, 0xFC, 0x1B, 0x17, 0x3A, 0x3F, 0x6B, 0x37, 0x32, 0x32, // 60-6F
+    0x30, 0x32, 0x72, 0x7A, 0x13, 0xB7, 0x26, 0x60, 0x7A, 0x13, 0xB7, 0x26, 0x50, 0xBA, 0x13, 0xB4, // 70-7F
+    0x2A, 0x50, 0xBA, 0x13, 0xB5, 0x2E, 0x40, 0xFA, 0x13, 0x95, 0xAE, 0x40, 0x38, 0x18, 0x9A, 0x92, // 80-8F
+    0xB0, 0x38, 0x00, 0xFA, 0x12, 0xB1, 0x7E, 0x00, 0xDB, 0x96, 0xA1, 0x7C, 0x08, 0xDB, 0x9A, 0x91, // 90-9F
+    0xBC, 0x08, 0xD8, 0x1A, 0x86, 0xE2, 0x70, 0x39, 0x1F, 0x86, 0xE0, 0x78, 0x7E, 0x03, 0xE7, 0x64, // A0-AF
+    0x51, 0x9C, 0x8F, 0x34, 0x6F, 0x4E, 0x41, 0xFC, 0x0B, 0xD5, 0xAE, 0x41, 0xFC, 0x0B, 0xD5, 0xAE, // B0-BF
+    0x41, 0xFC, 0x3B, 0x70, 0x71, 0x64, 0x33, 0x32, 0x12, 0x32, 0x32, 0x36, 0x70, 0x34, 0x2B, 0x56, // C0-CF
+    0x22, 0x70, 0x3A, 0x13, 0xB7, 0x26, 0x60, 0xBA, 0x1B, 0x94, 0xAA, 0x40, 0x38, 0x00, 0xFA, 0xB2, // D0-DF
+    0xE2, 0xA2, 0x67, 0x32, 0x32, 0x12, 0x32, 0xB2, 0x32, 0x32, 0x32, 0x32, 0x75, 0xA3, 0x26, 0x7B, // E0-EF
+    0x83, 0x26, 0xF9, 0x83, 0x2E, 0xFF, 0xE3, 0x16, 0x7D, 0xC0, 0x1E, 0x63, 0x21, 0x07, 0xE3, 0x01, // F0-FF
+};
 #endif
 
 
@@ -131,6 +132,9 @@ VGMSTREAM * init_vgmstream_sqex_scd(STREAMFILE *streamFile) {
         VGMSTREAM * result = NULL;
         uint32_t seek_table_size, vorb_header_size;
         uint8_t xor_version, xor_byte;
+        uint8_t key[0x100];
+        size_t key_size, xor_size;
+        STREAMFILE *file, *streamFileXor;
         vgm_vorbis_info_t inf;
 
 
@@ -176,24 +180,37 @@ VGMSTREAM * init_vgmstream_sqex_scd(STREAMFILE *streamFile) {
                 return NULL; /* not actually encrypted, happens but should be handled above */
 
             if (xor_version == 2) {  /* header is XOR'ed using byte */
-                inf.decryption_enabled = 1;
-                inf.decryption_callback = scd_ogg_decrypt_v2_callback;
-                inf.scd_xor = xor_byte;
-                inf.scd_xor_length = vorb_header_size;
+                key[0] = xor_byte;
+                key_size = 0x01;
+                xor_size = vorb_header_size;
             }
             else if (xor_version == 3) { /* full file is XOR'ed using table */
-                inf.decryption_enabled = 1;
-                inf.decryption_callback = scd_ogg_decrypt_v3_callback;
-                inf.scd_xor = stream_size & 0xFF; /* xor_byte is not used? (also there is data at +0x03) */
-                inf.scd_xor_length = stream_size;
+                uint8_t byte1 = (stream_size & 0xFF) & 0x7F; /* xor_byte is not used? (also there is data at +0x03) */
+                uint8_t byte2 = (stream_size & 0xFF) & 0x3F;
+                int i;
+                for (i = 0; i < 0x100; i++) {
+                    key[i] = scd_ogg_v3_lookuptable[(byte2 + i) & 0xFF] ^ byte1;
+                }
+                key_size = 0x100;
+                xor_size = stream_size;
             }
             else {
                 VGM_LOG("SCD: unknown encryption 0x%x\n", xor_version);
                 return NULL;
             }
 
+            file = streamFile->open(streamFile,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
+            if (!file) return NULL;
+            streamFileXor = open_xor_streamfile(file, key, key_size, start_offset, xor_size);
+            if (!streamFileXor) {
+                close_streamfile(file);
+                return NULL;
+            }
+
             /* hope this works */
-            return init_vgmstream_ogg_vorbis_callbacks(streamFile, filename, NULL, start_offset, &inf);
+            result = init_vgmstream_ogg_vorbis_callbacks(streamFileXor, filename, NULL, start_offset, &inf);
+            close_streamfile(streamFileXor);
+            return result;
         }
     }
 #endif
@@ -314,8 +331,10 @@ VGMSTREAM * init_vgmstream_sqex_scd(STREAMFILE *streamFile) {
                 vgmstream->codec_data = data;
 
                 for (i=0;i<channel_count;i++) {
-                    STREAMFILE * intfile =
-                        open_scdint_with_STREAMFILE(file, "ARBITRARY.DSP", start_offset+interleave_size*i, interleave_size, stride_size, total_size);
+                    STREAMFILE * intfile;
+
+                    /* deinterleaved mono DSP; the window stops reads at its size, so it covers the header too */
+                    intfile = open_window_streamfile(file, "ARBITRARY.DSP", start_offset+interleave_size*i, 0x60 + total_size, interleave_size, stride_size);
                     if (!intfile)
                         goto fail;
 
@@ -409,189 +428,3 @@ fail:
     close_vgmstream(vgmstream);
     return NULL;
 }
-
-static STREAMFILE *open_scdint_impl(SCDINTSTREAMFILE *streamfile,const char * const filename,size_t buffersize) 
-{
-    SCDINTSTREAMFILE *newfile;
-
-    if (strcmp(filename, streamfile->filename))
-        return NULL;
-
-    newfile = malloc(sizeof(SCDINTSTREAMFILE));
-    if (!newfile)
-        return NULL;
-
-    memcpy(newfile,streamfile,sizeof(SCDINTSTREAMFILE));
-    return &newfile->sf;
-}
-
-static void close_scdint(SCDINTSTREAMFILE *streamfile)
-{
-    free(streamfile);
-    return;
-}
-
-static size_t get_size_scdint(SCDINTSTREAMFILE *streamfile)
-{
-    return streamfile->total_size;
-}
-
-static size_t get_offset_scdint(SCDINTSTREAMFILE *streamfile)
-{
-    return streamfile->current_logical_offset;
-}
-
-static void get_name_scdint(SCDINTSTREAMFILE *streamfile, char *buffer, size_t length)
-{
-    strncpy(buffer,streamfile->filename,length);
-    buffer[length-1]='\0';
-}
-
-static size_t read_scdint(SCDINTSTREAMFILE *streamfile, uint8_t *dest, off_t offset, size_t length)
-{
-    size_t sz = 0;
-
-    while (length > 0)
-    {
-        off_t to_read;
-        off_t length_available;
-        off_t block_num;
-        off_t intrablock_offset;
-        off_t physical_offset;
-
-
-        block_num = offset / streamfile->interleave_block_size;
-        intrablock_offset = offset % streamfile->interleave_block_size;
-        streamfile->current_logical_offset = offset;
-        physical_offset = streamfile->start_physical_offset + block_num * streamfile->stride_size + intrablock_offset;
-
-        length_available =
-                streamfile->interleave_block_size - intrablock_offset;
-
-        if (length < length_available)
-        {
-            to_read = length;
-        }
-        else
-        {
-            to_read = length_available;
-        }
-
-        if (to_read > 0)
-        {
-            size_t bytes_read;
-
-            bytes_read = read_streamfile(dest,
-                physical_offset,
-                to_read, streamfile->real_file);
-
-            sz += bytes_read;
-
-            streamfile->current_logical_offset = offset + bytes_read;
-
-            if (bytes_read != to_read)
-            {
-                /* an error which we will not attempt to handle here */
-                return sz;
-            }
-
-            dest += bytes_read;
-            offset += bytes_read;
-            length -= bytes_read;
-        }
-    }
-
-    return sz;
-}
-
-/* start_offset is for *this* interleaved stream */
-static STREAMFILE *open_scdint_with_STREAMFILE(STREAMFILE *file, const char * filename, off_t start_offset, off_t interleave_block_size, off_t stride_size, size_t total_size)
-{
-    SCDINTSTREAMFILE * scd = NULL;
-
-    /* _scdint funcs can't handle this case */
-    if (start_offset + total_size > file->get_size(file))
-        return NULL;
-    
-    scd = malloc(sizeof(SCDINTSTREAMFILE));
-    if (!scd)
-        return NULL;
-
-    scd->sf.read = (void*)read_scdint;
-    scd->sf.get_size = (void*)get_size_scdint;
-    scd->sf.get_offset = (void*)get_offset_scdint;
-    scd->sf.get_name = (void*)get_name_scdint;
-    scd->sf.get_realname = (void*)get_name_scdint;
-    scd->sf.open = (void*)open_scdint_impl;
-    scd->sf.close = (void*)close_scdint;
-
-    scd->real_file = file;
-    scd->filename = filename;
-    scd->start_physical_offset = start_offset;
-    scd->current_logical_offset = 0;
-    scd->interleave_block_size = interleave_block_size;
-    scd->stride_size = stride_size;
-    scd->total_size = total_size;
-
-    return &scd->sf;
-}
-
-#ifdef VGM_USE_VORBIS
-static void scd_ogg_decrypt_v2_callback(void *ptr, size_t size, size_t nmemb, void *datasource, int bytes_read) {
-    ogg_vorbis_streamfile * ov_streamfile = (ogg_vorbis_streamfile*)datasource;
-
-    /* header is XOR'd with a constant byte */
-    if (ov_streamfile->offset < ov_streamfile->scd_xor_length) {
-        int i, num_crypt;
-
-        num_crypt = ov_streamfile->scd_xor_length - ov_streamfile->offset;
-        if (num_crypt > bytes_read)
-            num_crypt = bytes_read;
-
-        for (i = 0; i < num_crypt; i++) {
-            ((uint8_t*)ptr)[i] ^= (uint8_t)ov_streamfile->scd_xor;
-        }
-    }
-}
-
-static void scd_ogg_decrypt_v3_callback(void *ptr, size_t size, size_t nmemb, void *datasource, int bytes_read) {
-    /* V3 decryption table found in the .exe */
-    static const uint8_t scd_ogg_v3_lookuptable[256] = { /* FF XIV Heavensward */
-        0x3A, 0x32, 0x32, 0x32, 0x03, 0x7E, 0x12, 0xF7, 0xB2, 0xE2, 0xA2, 0x67, 0x32, 0x32, 0x22, 0x32, // 00-0F
-        0x32, 0x52, 0x16, 0x1B, 0x3C, 0xA1, 0x54, 0x7B, 0x1B, 0x97, 0xA6, 0x93, 0x1A, 0x4B, 0xAA, 0xA6, // 10-1F
-        0x7A, 0x7B, 0x1B, 0x97, 0xA6, 0xF7, 0x02, 0xBB, 0xAA, 0xA6, 0xBB, 0xF7, 0x2A, 0x51, 0xBE, 0x03, // 20-2F
-        0xF4, 0x2A, 0x51, 0xBE, 0x03, 0xF4, 0x2A, 0x51, 0xBE, 0x12, 0x06, 0x56, 0x27, 0x32, 0x32, 0x36, // 30-3F
-        0x32, 0xB2, 0x1A, 0x3B, 0xBC, 0x91, 0xD4, 0x7B, 0x58, 0xFC, 0x0B, 0x55, 0x2A, 0x15, 0xBC, 0x40, // 40-4F
-        0x92, 0x0B, 0x5B, 0x7C, 0x0A, 0x95, 0x12, 0x35, 0xB8, 0x63, 0xD2, 0x0B, 0x3B, 0xF0, 0xC7, 0x14, // 50-5F
-        0x51, 0x5C, 0x94, 0x86, 0x94, 0x59, 0x5C, 0xFC, 0x1B, 0x17, 0x3A, 0x3F, 0x6B, 0x37, 0x32, 0x32, // 60-6F
-        0x30, 0x32, 0x72, 0x7A, 0x13, 0xB7, 0x26, 0x60, 0x7A, 0x13, 0xB7, 0x26, 0x50, 0xBA, 0x13, 0xB4, // 70-7F
-        0x2A, 0x50, 0xBA, 0x13, 0xB5, 0x2E, 0x40, 0xFA, 0x13, 0x95, 0xAE, 0x40, 0x38, 0x18, 0x9A, 0x92, // 80-8F
-        0xB0, 0x38, 0x00, 0xFA, 0x12, 0xB1, 0x7E, 0x00, 0xDB, 0x96, 0xA1, 0x7C, 0x08, 0xDB, 0x9A, 0x91, // 90-9F
-        0xBC, 0x08, 0xD8, 0x1A, 0x86, 0xE2, 0x70, 0x39, 0x1F, 0x86, 0xE0, 0x78, 0x7E, 0x03, 0xE7, 0x64, // A0-AF
-        0x51, 0x9C, 0x8F, 0x34, 0x6F, 0x4E, 0x41, 0xFC, 0x0B, 0xD5, 0xAE, 0x41, 0xFC, 0x0B, 0xD5, 0xAE, // B0-BF
-        0x41, 0xFC, 0x3B, 0x70, 0x71, 0x64, 0x33, 0x32, 0x12, 0x32, 0x32, 0x36, 0x70, 0x34, 0x2B, 0x56, // C0-CF
-        0x22, 0x70, 0x3A, 0x13, 0xB7, 0x26, 0x60, 0xBA, 0x1B, 0x94, 0xAA, 0x40, 0x38, 0x00, 0xFA, 0xB2, // D0-DF
-        0xE2, 0xA2, 0x67, 0x32, 0x32, 0x12, 0x32, 0xB2, 0x32, 0x32, 0x32, 0x32, 0x75, 0xA3, 0x26, 0x7B, // E0-EF
-        0x83, 0x26, 0xF9, 0x83, 0x2E, 0xFF, 0xE3, 0x16, 0x7D, 0xC0, 0x1E, 0x63, 0x21, 0x07, 0xE3, 0x01, // F0-FF
-    };
-    ogg_vorbis_streamfile *ov_streamfile = (ogg_vorbis_streamfile*)datasource;
-
-    /* file is XOR'd with a table (algorithm and table by Ioncannon) */
-    if (ov_streamfile->offset < ov_streamfile->scd_xor_length) {
-        int i, num_crypt;
-        uint8_t byte1, byte2, xorByte;
-
-        num_crypt = bytes_read;
-        byte1 = ov_streamfile->scd_xor & 0x7F;
-        byte2 = ov_streamfile->scd_xor & 0x3F;
-
-        for (i = 0; i < num_crypt; i++) {
-            xorByte = scd_ogg_v3_lookuptable[(byte2 + ov_streamfile->offset + i) & 0xFF];
-            xorByte &= 0xFF;
-            xorByte ^= ((uint8_t*)ptr)[i];
-            xorByte ^= byte1;
-            ((uint8_t*)ptr)[i] = (uint8_t)xorByte;
-        }
-    }
-}
-#endif
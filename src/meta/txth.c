@@ -1,3 +1,11 @@
+#include <sys/stat.h>
+#include <time.h>
+#if defined(_WIN32) || defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
 #include "meta.h"
 #include "../coding/coding.h"
 #include "../layout/layout.h"
@@ -66,8 +74,17 @@ typedef struct {
 
 } txth_header;
 
+/* "key = value" lines of a .txth, stored as "key\0val\0key\0val\0..." */
+typedef struct {
+    char * buf;
+    size_t buf_size;
+    int count;
+} txth_keyvals;
+
 static STREAMFILE * open_txth(STREAMFILE * streamFile);
 static int parse_txth(STREAMFILE * streamFile, STREAMFILE * streamText, txth_header * txth);
+static int get_txth_keyvals(STREAMFILE * streamText, txth_keyvals * kv);
+static int read_txth_keyvals(STREAMFILE * streamText, txth_keyvals * kv);
 static int parse_keyval(STREAMFILE * streamFile, STREAMFILE * streamText, txth_header * txth, const char * key, const char * val);
 static int parse_num(STREAMFILE * streamFile, const char * val, uint32_t * out_value);
 static int get_bytes_to_samples(txth_header * txth, uint32_t bytes);
@@ -398,13 +415,181 @@ fail:
     return 0;
 }
 
+/* Applies the "key = value" lines to the header, in order (values may depend on previous keys). */
+static int parse_txth(STREAMFILE * streamFile, STREAMFILE * streamText, txth_header * txth) {
+    txth_keyvals kv = {0};
+    const char * key;
+    int i;
+
+    txth->data_size = get_streamfile_size(streamFile); /* for later use */
+
+    if (!get_txth_keyvals(streamText, &kv))
+        goto fail;
+
+    key = kv.buf;
+    for (i = 0; i < kv.count; i++) {
+        const char * val = key + strlen(key) + 1;
+
+        if (!parse_keyval(streamFile, streamText, txth, key, val)) /* read key/val */
+            goto fail;
+
+        key = val + strlen(val) + 1;
+    }
+
+    if (!txth->loop_flag_set)
+        txth->loop_flag = txth->loop_end_sample && txth->loop_end_sample != 0xFFFFFFFF;
+
+    free(kv.buf);
+    return 1;
+fail:
+    free(kv.buf);
+    return 0;
+}
+
+
+/* Lines of recently used .txth, as many raw files in a dir usually share the same one.
+ * Entries are checked against the file's size and mtime, so edits are picked up. */
+typedef struct {
+    char * name;
+    size_t file_size;
+    time_t mtime;
+    txth_keyvals kv;
+    uint32_t last_use;
+} txth_cache_entry;
+
+static txth_cache_entry * txth_cache = NULL; /* max_files entries */
+static int txth_cache_max = 0;
+static uint32_t txth_cache_use = 0;
+#if defined(_WIN32) || defined(WIN32)
+static CRITICAL_SECTION txth_cache_lock;
+static int txth_cache_lock_init = 0;
+#define txth_cache_lock_enter() EnterCriticalSection(&txth_cache_lock)
+#define txth_cache_lock_leave() LeaveCriticalSection(&txth_cache_lock)
+#else
+static pthread_mutex_t txth_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define txth_cache_lock_enter() pthread_mutex_lock(&txth_cache_lock)
+#define txth_cache_lock_leave() pthread_mutex_unlock(&txth_cache_lock)
+#endif
+
+static void free_txth_cache_entry(txth_cache_entry * entry) {
+    free(entry->name);
+    free(entry->kv.buf);
+    memset(entry,0,sizeof(txth_cache_entry));
+}
+
+static int copy_txth_keyvals(txth_keyvals * dst, const txth_keyvals * src) {
+    dst->buf = malloc(src->buf_size + 1); /* no lines = size 0 */
+    if (!dst->buf) return 0;
+    memcpy(dst->buf, src->buf, src->buf_size);
+    dst->buf_size = src->buf_size;
+    dst->count = src->count;
+    return 1;
+}
+
+/* gets the lines of the .txth from the cache, or reads (and caches) them */
+static int get_txth_keyvals(STREAMFILE * streamText, txth_keyvals * kv) {
+    txth_cache_entry * entry = NULL;
+    struct stat file_stat;
+    char filename[PATH_LIMIT];
+    size_t file_size = get_streamfile_size(streamText);
+    int i, found = 0;
+
+    /* only files that can be checked for changes are cached */
+    if (!txth_cache_max)
+        return read_txth_keyvals(streamText, kv);
+    streamText->get_name(streamText,filename,sizeof(filename));
+    if (stat(filename, &file_stat) != 0 || (size_t)file_stat.st_size != file_size)
+        return read_txth_keyvals(streamText, kv);
+    /* mtime only has seconds, so an edit later in the second it was read (same size) wouldn't change it */
+    if (time(NULL) - file_stat.st_mtime <= 1)
+        return read_txth_keyvals(streamText, kv);
+
+    txth_cache_lock_enter();
+    for (i = 0; i < txth_cache_max; i++) {
+        entry = &txth_cache[i];
+        if (entry->name && strcmp(entry->name,filename) == 0
+                && entry->file_size == file_size && entry->mtime == file_stat.st_mtime) {
+            entry->last_use = ++txth_cache_use;
+            found = copy_txth_keyvals(kv, &entry->kv);
+            break;
+        }
+    }
+    txth_cache_lock_leave();
+    if (found)
+        return 1;
+
+    if (!read_txth_keyvals(streamText, kv))
+        return 0;
+
+    txth_cache_lock_enter();
+    if (txth_cache_max) { /* disabled meanwhile */
+        /* replace an old version of the file, or the least recently used one */
+        entry = &txth_cache[0];
+        for (i = 0; i < txth_cache_max; i++) {
+            if (txth_cache[i].name && strcmp(txth_cache[i].name,filename) == 0) {
+                entry = &txth_cache[i];
+                break;
+            }
+            if (txth_cache[i].last_use < entry->last_use)
+                entry = &txth_cache[i];
+        }
+        free_txth_cache_entry(entry);
+
+        entry->name = malloc(strlen(filename) + 1);
+        if (entry->name && copy_txth_keyvals(&entry->kv, kv)) {
+            strcpy(entry->name, filename);
+            entry->file_size = file_size;
+            entry->mtime = file_stat.st_mtime;
+            entry->last_use = ++txth_cache_use;
+        }
+        else {
+            free_txth_cache_entry(entry);
+        }
+    }
+    txth_cache_lock_leave();
+
+    return 1;
+}
+
+void vgmstream_set_txth_cache(int max_files) {
+    int i;
+
+#if defined(_WIN32) || defined(WIN32)
+    if (!txth_cache_lock_init) {
+        InitializeCriticalSection(&txth_cache_lock);
+        txth_cache_lock_init = 1;
+    }
+#endif
+    if (max_files < 0)
+        max_files = 0;
+
+    txth_cache_lock_enter();
+    for (i = 0; i < txth_cache_max; i++) {
+        free_txth_cache_entry(&txth_cache[i]);
+    }
+    free(txth_cache);
+    txth_cache = NULL;
+    txth_cache_max = 0;
+
+    if (max_files) {
+        txth_cache = calloc(max_files, sizeof(txth_cache_entry));
+        if (txth_cache)
+            txth_cache_max = max_files;
+    }
+    txth_cache_lock_leave();
+}
+
 /* Simple text parser of "key = value" lines.
  * The code is meh and error handling not exactly the best. */
-static int parse_txth(STREAMFILE * streamFile, STREAMFILE * streamText, txth_header * txth) {
+static int read_txth_keyvals(STREAMFILE * streamText, txth_keyvals * kv) {
     off_t off = 0;
     off_t file_size = get_streamfile_size(streamText);
+    size_t buf_max = 0x100;
 
-    txth->data_size = get_streamfile_size(streamFile); /* for later use */
+    kv->buf_size = 0;
+    kv->count = 0;
+    kv->buf = malloc(buf_max);
+    if (!kv->buf) goto fail;
 
     /* skip BOM if needed */
     if (read_16bitLE(0x00, streamText) == 0xFFFE || read_16bitLE(0x00, streamText) == 0xFEFF)
@@ -419,8 +604,8 @@ static int parse_txth(STREAMFILE * streamFile, STREAMFILE * streamText, txth_hea
         off_t line_start = off, line_end = 0;
         line[0] = key[0] = val[0] = 0;
         
-        /* find line end */
-        while (line_end == 0 && off - line_start < TXTH_LINE_MAX) {
+        /* find line end (leaving room for the line's null) */
+        while (line_end == 0 && off - line_start < TXTH_LINE_MAX - 1) {
             char c = (char)read_8bit(off, streamText);
             if (c == '\n')
                 line_end = off;
@@ -434,7 +619,7 @@ static int parse_txth(STREAMFILE * streamFile, STREAMFILE * streamText, txth_hea
             goto fail; /* bad file / line too long */
         
         /* get key/val (ignores lead/trail spaces, stops at space/comment/separator) */
-        read_streamfile((uint8_t*)line,line_start,line_end, streamText);
+        read_streamfile((uint8_t*)line,line_start,line_end - line_start + 1, streamText);
         line[line_end - line_start + 1] = '\0';
         ok = sscanf(line, " %[^ \t#=] = %[^ \t#\r\n] ", key,val);
         //VGM_LOG("TXTH: ok=%i, key=\"%s\", val=\"%s\" from 0x%lx to 0x%lx\n", ok, key, val, line_start, line_end);
@@ -442,15 +627,29 @@ static int parse_txth(STREAMFILE * streamFile, STREAMFILE * streamText, txth_hea
         if (ok != 2) /* ignore line if no key=val (comment or garbage) */
             continue;
 
-        if (!parse_keyval(streamFile, streamText, txth, key, val)) /* read key/val */
-            goto fail;
+        /* store key/val */
+        {
+            size_t key_size = strlen(key) + 1;
+            size_t val_size = strlen(val) + 1;
+
+            if (kv->buf_size + key_size + val_size > buf_max) {
+                char * buf;
+                buf_max = (kv->buf_size + key_size + val_size) * 2;
+                buf = realloc(kv->buf, buf_max);
+                if (!buf) goto fail;
+                kv->buf = buf;
+            }
+            memcpy(kv->buf + kv->buf_size, key, key_size);
+            memcpy(kv->buf + kv->buf_size + key_size, val, val_size);
+            kv->buf_size += key_size + val_size;
+            kv->count++;
+        }
     }
 
-    if (!txth->loop_flag_set)
-        txth->loop_flag = txth->loop_end_sample && txth->loop_end_sample != 0xFFFFFFFF;
-
     return 1;
 fail:
+    free(kv->buf);
+    kv->buf = NULL;
     return 0;
 }
 
@@ -1,6 +1,10 @@
 #include "meta.h"
 #include "../coding/coding.h"
 
+#ifdef VGM_USE_FFMPEG
+static void update_xma1_samples(VGMSTREAM * vgmstream, STREAMFILE *streamFile, const void * config);
+#endif
+
 /* XMA - Microsoft format derived from WMAPRO, found in X360/XBone games */
 VGMSTREAM * init_vgmstream_xma(STREAMFILE *streamFile) {
     VGMSTREAM * vgmstream = NULL;
@@ -9,6 +13,7 @@ VGMSTREAM * init_vgmstream_xma(STREAMFILE *streamFile) {
     int loop_flag, channel_count, sample_rate, is_xma2_old = 0, is_xma1 = 0;
     int num_samples, loop_start_sample, loop_end_sample, loop_start_b = 0, loop_end_b = 0, loop_subframe = 0;
     int fmt_be = 0;
+    ms_sample_data msd;
 
 
     /* check extension, case insensitive */
@@ -68,7 +73,6 @@ VGMSTREAM * init_vgmstream_xma(STREAMFILE *streamFile) {
 
     /* fix samples; for now only XMA1 is fixed, but XMA2 num_samples don't include skip samples and xmaencode.exe doesn't use it */
     if (is_xma1) {
-        ms_sample_data msd;
         memset(&msd,0,sizeof(ms_sample_data));
 
         msd.xma_version = is_xma1 ? 1 : 2;
@@ -82,11 +86,10 @@ VGMSTREAM * init_vgmstream_xma(STREAMFILE *streamFile) {
         msd.loop_end_subframe   = loop_subframe >> 4; /* upper 4b: subframe where the loop ends, 0..3 */
         msd.chunk_offset= chunk_offset;
 
-        xma_get_samples(&msd, streamFile);
-
-        num_samples = msd.num_samples;
-        loop_start_sample = msd.loop_start_sample;
-        loop_end_sample = msd.loop_end_sample;
+        /* found by reading the whole stream, set below */
+        num_samples = 0;
+        loop_start_sample = 0;
+        loop_end_sample = 0;
         /* XMA2 loop/num_samples don't seem to use msd.skip_samples */
     }
 
@@ -118,6 +121,20 @@ VGMSTREAM * init_vgmstream_xma(STREAMFILE *streamFile) {
         if ( !vgmstream->codec_data ) goto fail;
         vgmstream->coding_type = coding_FFmpeg;
         vgmstream->layout_type = layout_none;
+
+        /* may be deferred, using FFmpeg's estimate (from the bitrate) and no loops until then */
+        if (is_xma1) {
+            ffmpeg_codec_data *data = (ffmpeg_codec_data *)vgmstream->codec_data;
+
+            if (data->totalSamples > 0) {
+                vgmstream->num_samples = (int32_t)data->totalSamples;
+                vgmstream->loop_flag = 0;
+                set_vgmstream_lazy_samples(vgmstream, streamFile, update_xma1_samples, &msd, sizeof(msd));
+            }
+            else {
+                update_xma1_samples(vgmstream, streamFile, &msd);
+            }
+        }
     }
 #else
     goto fail;
@@ -142,6 +159,20 @@ fail:
 }
 
 
+#ifdef VGM_USE_FFMPEG
+/* exact samples/loops from the XMA1 frames */
+static void update_xma1_samples(VGMSTREAM * vgmstream, STREAMFILE *streamFile, const void * config) {
+    ms_sample_data msd = *(const ms_sample_data *)config;
+
+    xma_get_samples(&msd, streamFile);
+
+    vgmstream->num_samples = msd.num_samples;
+    vgmstream->loop_flag = msd.loop_flag;
+    vgmstream->loop_start_sample = msd.loop_start_sample;
+    vgmstream->loop_end_sample = msd.loop_end_sample;
+}
+#endif
+
 #if 0
 /**
  * Get real XMA sample rate (from Microsoft docs).
@@ -1,299 +1,2207 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#if defined(_WIN32) || defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <dirent.h>
+#endif
+#include <sys/stat.h>
+#include <ctype.h>
+#include <time.h>
 #include "streamfile.h"
 #include "util.h"
 #include "vgmstream.h"
 
 
-/* On EOF reads we can return length 0, or ignore and return the requested length + 0-set the buffer.
- * Some decoders don't check for EOF and may decode garbage if returned 0, as read_Nbit() funcs return -1.
- * Only matters for metas that get num_samples wrong (bigger than total data). */
-#define STREAMFILE_IGNORE_EOF 0
+/* On EOF reads we can return length 0, or ignore and return the requested length + 0-set the buffer.
+ * Some decoders don't check for EOF and may decode garbage if returned 0, as read_Nbit() funcs return -1.
+ * Only matters for metas that get num_samples wrong (bigger than total data). */
+#define STREAMFILE_IGNORE_EOF 0
+
+
+/* reference counts for handles shared between STREAMFILEs that may live in different threads */
+#if defined(_WIN32) || defined(WIN32)
+typedef volatile LONG refcount_t;
+#define refcount_inc(refs) InterlockedIncrement(refs)
+#define refcount_dec(refs) InterlockedDecrement(refs)   /* returns new count */
+#else
+typedef volatile int refcount_t;
+#define refcount_inc(refs) __sync_add_and_fetch(refs, 1)
+#define refcount_dec(refs) __sync_sub_and_fetch(refs, 1)
+#endif
+
+
+/* adds all counters to stats */
+static void add_stats(STREAMFILE_STATS * stats, const STREAMFILE_STATS * add) {
+    stats->reads += add->reads;
+    stats->hits += add->hits;
+    stats->misses += add->misses;
+    stats->seeks += add->seeks;
+    stats->bytes_fetched += add->bytes_fetched;
+    stats->bytes_consumed += add->bytes_consumed;
+    stats->handles += add->handles;
+    stats->errors += add->errors;
+}
+
+/* adds counters of a STREAMFILE that reads from inner: calls made to it are its own, while file reads are
+ * done by inner (if inner isn't owned it's counted by its owner instead, pass NULL) */
+static void add_wrapper_stats(STREAMFILE_STATS * stats, const STREAMFILE_STATS * own, STREAMFILE * inner) {
+    STREAMFILE_STATS inner_stats = {0};
+
+    if (inner)
+        get_streamfile_stats(inner,&inner_stats);
+
+    stats->reads += own->reads;
+    stats->hits += own->hits;
+    stats->misses += own->misses;
+    stats->seeks += inner_stats.seeks;
+    stats->bytes_fetched += inner_stats.bytes_fetched;
+    stats->bytes_consumed += own->bytes_consumed;
+    stats->handles += 1 + inner_stats.handles;
+    stats->errors += own->errors + inner_stats.errors;
+}
+
+
+/* **************************************************** */
+
+/* Listings of recently used directories, so opening files that don't exist (dual file stereo and metas
+ * trying companion names) can fail without going to disk, which is slow on network drives. A directory
+ * is listed again when its mtime changes, checked at most every DIR_CACHE_CHECK_TIME seconds. */
+#define DIR_CACHE_CHECK_TIME  1
+
+typedef struct {
+    char * path;            /* directory name, with final separator */
+    size_t path_size;
+    char ** names;          /* sorted file names */
+    int names_count;
+    char * names_buf;       /* storage of names */
+    time_t mtime;           /* directory mtime when listed (-1 if listed in the same second, must list again) */
+    time_t checked;         /* last time mtime was checked */
+    uint32_t last_use;
+} DIR_CACHE_ENTRY;
+
+static DIR_CACHE_ENTRY * dir_cache = NULL; /* max_dirs entries */
+static int dir_cache_max = 0;
+static int dir_cache_count = 0;
+static uint32_t dir_cache_use = 0;
+#if defined(_WIN32) || defined(WIN32)
+static CRITICAL_SECTION dir_cache_lock;
+static int dir_cache_lock_init = 0;
+#define dir_cache_lock_enter() EnterCriticalSection(&dir_cache_lock)
+#define dir_cache_lock_leave() LeaveCriticalSection(&dir_cache_lock)
+#define dir_cache_strcmp _stricmp /* names aren't case sensitive */
+#else
+static pthread_mutex_t dir_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define dir_cache_lock_enter() pthread_mutex_lock(&dir_cache_lock)
+#define dir_cache_lock_leave() pthread_mutex_unlock(&dir_cache_lock)
+#define dir_cache_strcmp strcmp
+#endif
+
+static void free_dir_cache_entry(DIR_CACHE_ENTRY * entry) {
+    free(entry->path);
+    free(entry->names);
+    free(entry->names_buf);
+    memset(entry,0,sizeof(DIR_CACHE_ENTRY));
+}
+
+static int compare_dir_cache_names(const void * a, const void * b) {
+    return dir_cache_strcmp(*(const char **)a, *(const char **)b);
+}
+
+/* reads all file names of entry->path, returns 0 on failure */
+static int list_dir_cache_entry(DIR_CACHE_ENTRY * entry) {
+    char ** names = NULL;
+    char * names_buf = NULL;
+    size_t buf_size = 0, buf_max = 0;
+    int i, count = 0;
+#if defined(_WIN32) || defined(WIN32)
+    char pattern[PATH_LIMIT];
+    WIN32_FIND_DATAA find_data;
+    HANDLE find;
+
+    if (entry->path_size + 2 > sizeof(pattern))
+        return 0;
+    snprintf(pattern,sizeof(pattern),"%s*",entry->path);
+    find = FindFirstFileA(pattern,&find_data);
+    if (find == INVALID_HANDLE_VALUE)
+        return 0;
+    do {
+        const char * name = find_data.cFileName;
+#else
+    DIR * dir;
+    struct dirent * dir_entry;
+
+    dir = opendir(entry->path);
+    if (!dir)
+        return 0;
+    while ((dir_entry = readdir(dir)) != NULL) {
+        const char * name = dir_entry->d_name;
+#endif
+        size_t name_size = strlen(name) + 1;
+
+        if (buf_size + name_size > buf_max) {
+            char * new_buf;
+            buf_max = (buf_size + name_size) * 2;
+            new_buf = realloc(names_buf, buf_max);
+            if (!new_buf) {
+                count = -1;
+                break;
+            }
+            names_buf = new_buf;
+        }
+        memcpy(names_buf + buf_size, name, name_size);
+        buf_size += name_size;
+        count++;
+#if defined(_WIN32) || defined(WIN32)
+    } while (FindNextFileA(find,&find_data));
+    FindClose(find);
+#else
+    }
+    closedir(dir);
+#endif
+    if (count < 0)
+        goto fail;
+
+    names = malloc((count ? count : 1) * sizeof(char *));
+    if (!names) goto fail;
+    for (i = 0, buf_size = 0; i < count; i++) {
+        names[i] = names_buf + buf_size;
+        buf_size += strlen(names[i]) + 1;
+    }
+    qsort(names,count,sizeof(char *),compare_dir_cache_names);
+
+    free(entry->names);
+    free(entry->names_buf);
+    entry->names = names;
+    entry->names_buf = names_buf;
+    entry->names_count = count;
+    return 1;
+
+fail:
+    free(names);
+    free(names_buf);
+    return 0;
+}
+
+/* stats a dir path that ends with a separator, as MSVC's stat fails on those (roots like "/" or "C:\" keep it) */
+static int stat_dir(const char * path, size_t path_size, struct stat * dir_stat) {
+    char dir_path[PATH_LIMIT];
+
+    memcpy(dir_path,path,path_size + 1);
+    if (path_size > 1 && !(path_size == 3 && dir_path[1] == ':'))
+        dir_path[path_size - 1] = '\0';
+    return stat(dir_path,dir_stat);
+}
+
+/* returns 1 if filename is known not to exist (0 if it does, or if it can't be known) */
+static int is_file_missing(const char * filename) {
+    DIR_CACHE_ENTRY * entry = NULL;
+    struct stat dir_stat;
+    char path[PATH_LIMIT];
+    const char * name;
+    size_t path_size;
+    time_t now;
+    int i, lo, hi, missing = 0;
+
+    if (!dir_cache_max)
+        return 0;
+
+    name = strrchr(filename,DIR_SEPARATOR);
+#if defined(_WIN32) || defined(WIN32)
+    if (strrchr(filename,'/') > name)
+        name = strrchr(filename,'/');
+#endif
+    if (!name) /* relative to the current dir, that may change */
+        return 0;
+    name++;
+    path_size = name - filename;
+    if (path_size + 1 > sizeof(path) || name[0] == '\0')
+        return 0;
+    memcpy(path,filename,path_size);
+    path[path_size] = '\0';
+
+    dir_cache_lock_enter();
+    if (!dir_cache_max) /* disabled meanwhile */
+        goto done;
+
+    for (i = 0; i < dir_cache_count; i++) {
+        if (dir_cache[i].path_size == path_size && strcmp(dir_cache[i].path,path) == 0) {
+            entry = &dir_cache[i];
+            break;
+        }
+    }
+
+    now = time(NULL);
+    if (!entry || now - entry->checked >= DIR_CACHE_CHECK_TIME) {
+        if (stat_dir(path,path_size,&dir_stat) != 0) {
+            if (entry) free_dir_cache_entry(entry); /* freed entries are reused first */
+            goto done;
+        }
+
+        if (!entry) {
+            /* use a free entry, a new one, or replace the least recently used one */
+            for (i = 0; i < dir_cache_count; i++) {
+                if (!dir_cache[i].path) {
+                    entry = &dir_cache[i];
+                    break;
+                }
+            }
+            if (!entry && dir_cache_count < dir_cache_max)
+                entry = &dir_cache[dir_cache_count++];
+            if (!entry) {
+                entry = &dir_cache[0];
+                for (i = 1; i < dir_cache_count; i++) {
+                    if (dir_cache[i].last_use < entry->last_use)
+                        entry = &dir_cache[i];
+                }
+                free_dir_cache_entry(entry);
+            }
+        }
+
+        if (!entry->path || entry->mtime != dir_stat.st_mtime) {
+            if (!entry->path) {
+                entry->path = malloc(path_size + 1);
+                if (!entry->path) goto done;
+                memcpy(entry->path,path,path_size + 1);
+                entry->path_size = path_size;
+            }
+            if (!list_dir_cache_entry(entry)) {
+                free_dir_cache_entry(entry);
+                goto done;
+            }
+            /* mtime only has seconds, so a change later in the second it was listed wouldn't change it */
+            if (now - dir_stat.st_mtime > 1)
+                entry->mtime = dir_stat.st_mtime;
+            else
+                entry->mtime = (time_t)-1;
+        }
+        entry->checked = now;
+    }
+    entry->last_use = ++dir_cache_use;
+
+    /* binary search */
+    lo = 0;
+    hi = entry->names_count;
+    missing = 1;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        int cmp = dir_cache_strcmp(entry->names[mid],name);
+        if (cmp == 0) {
+            missing = 0;
+            break;
+        }
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+done:
+    dir_cache_lock_leave();
+    return missing;
+}
+
+void vgmstream_set_dir_cache(int max_dirs) {
+    int i;
+
+#if defined(_WIN32) || defined(WIN32)
+    if (!dir_cache_lock_init) {
+        InitializeCriticalSection(&dir_cache_lock);
+        dir_cache_lock_init = 1;
+    }
+#endif
+    if (max_dirs < 0)
+        max_dirs = 0;
+
+    dir_cache_lock_enter();
+    for (i = 0; i < dir_cache_count; i++) {
+        free_dir_cache_entry(&dir_cache[i]);
+    }
+    free(dir_cache);
+    dir_cache = NULL;
+    dir_cache_count = 0;
+    dir_cache_max = 0;
+
+    if (max_dirs) {
+        dir_cache = calloc(max_dirs, sizeof(DIR_CACHE_ENTRY));
+        if (dir_cache)
+            dir_cache_max = max_dirs;
+    }
+    dir_cache_lock_leave();
+}
+
+
+/* max size a buffer grows to while the file is read sequentially */
+#define STREAMFILE_MAX_READAHEAD 0x100000
+
+/* an open file, shared between all STDIOSTREAMFILEs opened on the same name */
+typedef struct {
+    refcount_t refs;        /* STREAMFILEs using this file */
+    FILE * infile;          /* actual FILE (only used for its descriptor after opening) */
+    int fd;                 /* descriptor for positional reads */
+    size_t filesize;        /* cached file size */
+} STDIO_FILE;
+
+/* a window of the file */
+typedef struct {
+    off_t offset;           /* buffer start in the file */
+    size_t validsize;       /* current buffer size */
+    uint8_t * data;         /* data buffer (allocated on first read) */
+    size_t datasize;        /* allocated size */
+    size_t readsize;        /* bytes to read on next fill, grows on sequential reads */
+} STDIO_BUFFER;
+
+/* a STREAMFILE that operates via standard IO using a buffer. Reads are positional (no seeks on the
+ * shared file), so STREAMFILEs opened from another (each has its own buffer) can be used in different threads. */
+typedef struct {
+    STREAMFILE sf;          /* callbacks */
+    STDIO_FILE * file;      /* shared file */
+    char name[PATH_LIMIT];
+    STDIO_BUFFER buf[2];    /* two windows, so reads alternating between far areas don't refill every time */
+    int current;            /* last used window */
+    size_t buffersize;      /* base buffer size */
+    int sequential_hint;    /* OS was told the file is read sequentially */
+    size_t filesize;        /* cached file size (max offset) */
+    STREAMFILE_STATS stats; /* I/O counters */
+    off_t fetch_end;        /* where the last file read ended */
+#ifdef VGM_DEBUG_OUTPUT
+    int error_notified;
+#endif
+} STDIOSTREAMFILE;
+
+static STREAMFILE * open_stdio_streamfile_buffer(const char * const filename, size_t buffersize);
+static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char * const filename, size_t buffersize);
+static STREAMFILE * open_stdio_streamfile_buffer_by_stdio(STDIO_FILE *file,const char * const filename, size_t buffersize);
+
+/* reads length bytes at offset without touching the file position, returns bytes read or -1 on error */
+static int64_t read_file_at(STDIO_FILE * file, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read = 0;
+
+#if defined(_WIN32) || defined(WIN32)
+    HANDLE handle = (HANDLE)_get_osfhandle(file->fd);
+
+    while (length_read < length) {
+        OVERLAPPED ov;
+        DWORD done = 0;
+        uint64_t position = (uint64_t)offset + length_read;
+
+        memset(&ov,0,sizeof(OVERLAPPED));
+        ov.Offset = (DWORD)(position & 0xFFFFFFFF);
+        ov.OffsetHigh = (DWORD)(position >> 32);
+        if (!ReadFile(handle, dest + length_read, (DWORD)(length - length_read), &done, &ov)) {
+            if (GetLastError() == ERROR_HANDLE_EOF)
+                break;
+            return -1;
+        }
+        if (done == 0)
+            break;
+        length_read += done;
+    }
+#else
+    while (length_read < length) {
+        ssize_t done = pread(file->fd, dest + length_read, length - length_read, offset + length_read);
+        if (done < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        if (done == 0)
+            break; /* EOF */
+        length_read += done;
+    }
+#endif
+
+    return length_read;
+}
+
+/* returns the window with the byte at offset, or NULL */
+static STDIO_BUFFER * find_buffer(STDIOSTREAMFILE * streamfile, off_t offset) {
+    STDIO_BUFFER * buf = &streamfile->buf[streamfile->current];
+    if (offset >= buf->offset && offset < buf->offset + buf->validsize)
+        return buf;
+
+    buf = &streamfile->buf[!streamfile->current];
+    if (offset >= buf->offset && offset < buf->offset + buf->validsize) {
+        streamfile->current = !streamfile->current;
+        return buf;
+    }
+
+    return NULL;
+}
+
+/* marks the current window as past EOF (so get_offset reports the file end, like stdio would) */
+static void set_buffer_eof(STDIOSTREAMFILE * streamfile) {
+    STDIO_BUFFER * buf = &streamfile->buf[streamfile->current];
+    buf->offset = streamfile->filesize;
+    buf->validsize = 0;
+}
+
+/* checks if offset continues a bit after where the window ends */
+static int is_buffer_sequential(STDIO_BUFFER * buf, off_t offset) {
+    off_t buf_end = buf->offset + buf->validsize;
+    return buf->validsize && offset >= buf_end && offset < buf_end + buf->readsize;
+}
+
+/* Refills a window at offset and makes it current. If offset continues where a window ends
+ * (sequential reads) that window is reused and reads grow, otherwise the least recently used
+ * window is replaced with a base-sized read. Returns the window, or NULL on error. */
+static STDIO_BUFFER * fill_buffer(STDIOSTREAMFILE * streamfile, off_t offset) {
+    STDIO_BUFFER * buf;
+    int64_t length_read;
+    int is_sequential = 1;
+
+    if (!is_buffer_sequential(&streamfile->buf[streamfile->current], offset)) {
+        if (is_buffer_sequential(&streamfile->buf[!streamfile->current], offset))
+            streamfile->current = !streamfile->current;
+        else
+            is_sequential = 0;
+    }
+    buf = &streamfile->buf[streamfile->current];
+
+    if (is_sequential) {
+        buf->readsize *= 2;
+        if (buf->readsize > STREAMFILE_MAX_READAHEAD)
+            buf->readsize = STREAMFILE_MAX_READAHEAD;
+        if (buf->readsize < streamfile->buffersize) /* in case base size is bigger */
+            buf->readsize = streamfile->buffersize;
+    }
+    else {
+        streamfile->current = !streamfile->current;
+        buf = &streamfile->buf[streamfile->current];
+        buf->readsize = streamfile->buffersize;
+    }
+
+    buf->validsize = 0; /* buffer is empty now */
+
+    if (buf->datasize < buf->readsize) {
+        uint8_t * data = realloc(buf->data, buf->readsize);
+        if (!data) {
+            if (!buf->data)
+                goto fail;
+            buf->readsize = buf->datasize; /* keep going with what we have */
+        }
+        else {
+            buf->data = data;
+            buf->datasize = buf->readsize;
+        }
+    }
+
+    streamfile->stats.misses++;
+    if (offset != streamfile->fetch_end)
+        streamfile->stats.seeks++;
+
+    length_read = read_file_at(streamfile->file,buf->data,offset,buf->readsize);
+    if (length_read < 0)
+        goto fail; /* fail miserably (shouldn't happen) */
+    buf->offset = offset;
+    buf->validsize = length_read;
+
+    streamfile->stats.bytes_fetched += length_read;
+    streamfile->fetch_end = offset + length_read;
+
+#if defined(__linux__)
+    /* let the OS read ahead in the background too */
+    if (is_sequential && buf->validsize == buf->readsize) {
+        if (!streamfile->sequential_hint) {
+            posix_fadvise(streamfile->file->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            streamfile->sequential_hint = 1;
+        }
+        posix_fadvise(streamfile->file->fd, offset + buf->validsize, buf->readsize, POSIX_FADV_WILLNEED);
+    }
+#endif
+
+    return buf;
+
+fail:
+    buf->offset = streamfile->filesize;
+    streamfile->stats.errors++;
+    return NULL;
+}
+
+static size_t read_the_rest(uint8_t * dest, off_t offset, size_t length, STDIOSTREAMFILE * streamfile) {
+    size_t length_read_total=0;
+
+    while (length > 0) {
+        size_t length_read;
+        STDIO_BUFFER * buf = find_buffer(streamfile,offset);
+
+        if (!buf) {
+            /* request outside file: ignore to avoid seek/read */
+            if (offset > streamfile->filesize) {
+                set_buffer_eof(streamfile);
+#ifdef VGM_DEBUG_OUTPUT
+                if (!streamfile->error_notified) {
+                    VGM_LOG("ERROR: reading over filesize 0x%x @ 0x%lx + 0x%x (buggy meta?)\n", streamfile->filesize, offset, length);
+                    streamfile->error_notified = 1;
+                }
+#endif
+                break;
+            }
+
+            /* fill a buffer */
+            buf = fill_buffer(streamfile,offset);
+            if (!buf)
+                return length_read_total; /* read error or no memory */
+
+            /* can't get anything (EOF), give up */
+            if (buf->validsize == 0)
+                break;
+        }
+
+        /* copy what the buffer has, then continue with the next one if needed */
+        length_read = buf->offset + buf->validsize - offset;
+        if (length_read > length)
+            length_read = length;
+
+        memcpy(dest,buf->data + (offset - buf->offset),length_read);
+        length_read_total += length_read;
+        length -= length_read;
+        dest += length_read;
+        offset += length_read;
+
+        /* buffer ends at EOF, partial read */
+        if (length > 0 && buf->validsize < buf->readsize)
+            break;
+    }
+
+#if STREAMFILE_IGNORE_EOF
+    if (length > 0) {
+        memset(dest,0,length); /* dest is already shifted */
+        return length_read_total + length; /* partially-read + 0-set buffer */
+    }
+#endif
+    return length_read_total; /* full or partially-read buffer */
+}
+
+static size_t read_stdio(STDIOSTREAMFILE *streamfile,uint8_t * dest, off_t offset, size_t length) {
+
+    if (!streamfile || !dest || length<=0)
+        return 0;
+
+    streamfile->stats.reads++;
+
+    /* request outside file: ignore to avoid seek/read in read_the_rest() */
+    if (offset > streamfile->filesize) {
+        set_buffer_eof(streamfile);
+
+#ifdef VGM_DEBUG_OUTPUT
+        if (!streamfile->error_notified) {
+            VGM_LOG("ERROR: offset over filesize 0x%x @ 0x%lx + 0x%x (buggy meta?)\n", streamfile->filesize, offset, length);
+            streamfile->error_notified = 1;
+        }
+#endif
+
+#if STREAMFILE_IGNORE_EOF
+        memset(dest,0,length);
+        return length; /* 0-set buffer */
+#else
+        return 0; /* nothing to read */
+#endif
+    }
+
+    /* just copy if entire request is within the current buffer */
+    {
+        STDIO_BUFFER * buf = &streamfile->buf[streamfile->current];
+        if (offset >= buf->offset && offset + length <= buf->offset + buf->validsize) {
+            memcpy(dest,buf->data + (offset - buf->offset),length);
+            streamfile->stats.hits++;
+            streamfile->stats.bytes_consumed += length;
+            return length;
+        }
+    }
+
+    /* request outside buffer: new read */
+    {
+        uint64_t misses = streamfile->stats.misses;
+        size_t length_read = read_the_rest(dest,offset,length,streamfile);
+        if (streamfile->stats.misses == misses)
+            streamfile->stats.hits++; /* was in the other window */
+        if (length_read < length)
+            streamfile->stats.errors++;
+        streamfile->stats.bytes_consumed += length_read;
+        return length_read;
+    }
+}
+
+static size_t borrow_stdio(STDIOSTREAMFILE *streamfile, const uint8_t ** data, off_t offset, size_t length) {
+    STDIO_BUFFER * buf;
+    size_t length_read;
+
+    if (!streamfile || !data || length<=0 || offset < 0 || offset >= streamfile->filesize)
+        return 0;
+
+    /* refill a buffer at offset if the request isn't fully in one, same as read_the_rest() */
+    buf = find_buffer(streamfile,offset);
+    if (!buf || offset + length > buf->offset + buf->validsize) {
+        if (length > streamfile->buffersize)
+            return 0;
+        buf = fill_buffer(streamfile,offset);
+        if (!buf || buf->validsize == 0)
+            return 0;
+    }
+    else {
+        streamfile->stats.hits++;
+    }
+
+    length_read = buf->offset + buf->validsize - offset;
+    streamfile->stats.reads++;
+    streamfile->stats.bytes_consumed += (length_read < length ? length_read : length);
+    *data = buf->data + (offset - buf->offset);
+    return length_read;
+}
+
+static void close_stdio_file(STDIO_FILE * file) {
+    if (refcount_dec(&file->refs) > 0)
+        return;
+
+    fclose(file->infile);
+    free(file);
+}
+
+static void close_stdio(STDIOSTREAMFILE * streamfile) {
+    close_stdio_file(streamfile->file);
+    free(streamfile->buf[0].data);
+    free(streamfile->buf[1].data);
+    free(streamfile);
+}
+
+static size_t get_size_stdio(STDIOSTREAMFILE * streamfile) {
+    return streamfile->filesize;
+}
+
+static off_t get_offset_stdio(STDIOSTREAMFILE *streamFile) {
+    return streamFile->buf[streamFile->current].offset;
+}
+
+static void get_name_stdio(STDIOSTREAMFILE *streamfile,char *buffer,size_t length) {
+    strncpy(buffer,streamfile->name,length);
+    buffer[length-1]='\0';
+}
+
+static void get_stats_stdio(STDIOSTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    add_stats(stats,&streamfile->stats);
+    stats->handles++;
+}
+
+static STREAMFILE *open_stdio(STDIOSTREAMFILE *streamFile,const char * const filename,size_t buffersize) {
+    STREAMFILE *newstreamFile;
+
+    if (!filename)
+        return NULL;
+
+    // if same name, share the file we already have open (only a new buffer is needed)
+    if (!strcmp(streamFile->name,filename)) {
+        refcount_inc(&streamFile->file->refs);
+        newstreamFile = open_stdio_streamfile_buffer_by_stdio(streamFile->file,filename,buffersize);
+        if (newstreamFile) {
+            return newstreamFile;
+        }
+        // failure, release it and try the default path (which will probably fail a second time)
+        close_stdio_file(streamFile->file);
+    }
+    // a normal open, open a new file
+    return open_stdio_streamfile_buffer(filename,buffersize);
+}
+
+static STREAMFILE * open_stdio_streamfile_buffer_by_stdio(STDIO_FILE *file,const char * const filename, size_t buffersize) {
+    STDIOSTREAMFILE * streamfile;
+
+    streamfile = calloc(1,sizeof(STDIOSTREAMFILE));
+    if (!streamfile) {
+        return NULL;
+    }
+
+    streamfile->sf.read = (void*)read_stdio;
+    streamfile->sf.get_size = (void*)get_size_stdio;
+    streamfile->sf.get_offset = (void*)get_offset_stdio;
+    streamfile->sf.get_name = (void*)get_name_stdio;
+    streamfile->sf.get_realname = (void*)get_name_stdio;
+    streamfile->sf.open = (void*)open_stdio;
+    streamfile->sf.close = (void*)close_stdio;
+    streamfile->sf.borrow = (void*)borrow_stdio;
+    streamfile->sf.get_stats = (void*)get_stats_stdio;
+
+    streamfile->file = file;
+    streamfile->buffersize = buffersize;
+    streamfile->filesize = file->filesize;
+
+    strncpy(streamfile->name,filename,sizeof(streamfile->name));
+    streamfile->name[sizeof(streamfile->name)-1] = '\0';
+
+    return &streamfile->sf;
+}
+
+static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char * const filename, size_t buffersize) {
+    STDIO_FILE * file;
+    STREAMFILE * streamFile;
+
+    file = calloc(1,sizeof(STDIO_FILE));
+    if (!file) {
+        return NULL;
+    }
+
+    file->refs = 1;
+    file->infile = infile;
+    file->fd = fileno(infile);
+
+    /* cache filesize */
+    fseeko(infile,0,SEEK_END);
+    file->filesize = ftello(infile);
+
+    streamFile = open_stdio_streamfile_buffer_by_stdio(file,filename,buffersize);
+    if (!streamFile) {
+        free(file); /* infile is closed by the caller */
+        return NULL;
+    }
+
+    return streamFile;
+}
+
+static STREAMFILE * open_stdio_streamfile_buffer(const char * const filename, size_t buffersize) {
+    FILE * infile;
+    STREAMFILE *streamFile;
+
+    if (is_file_missing(filename))
+        return NULL;
+
+    infile = fopen(filename,"rb");
+    if (!infile) return NULL;
+
+    streamFile = open_stdio_streamfile_buffer_by_file(infile,filename,buffersize);
+    if (!streamFile) {
+        fclose(infile);
+    }
+
+    return streamFile;
+}
+
+
+STREAMFILE * open_stdio_streamfile(const char * filename) {
+    return open_stdio_streamfile_buffer(filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
+}
+
+STREAMFILE * open_stdio_streamfile_by_file(FILE * file, const char * filename) {
+    return open_stdio_streamfile_buffer_by_file(file,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
+}
+
+
+/* **************************************************** */
+
+/* a whole file mapped in memory, shared between all STREAMFILEs opened on the same name */
+typedef struct {
+    refcount_t refs;        /* STREAMFILEs using this mapping */
+    uint8_t * data;         /* mapped file (NULL if empty) */
+    size_t size;            /* mapped size (whole file) */
+#if defined(_WIN32) || defined(WIN32)
+    HANDLE mapping;
+#endif
+} MMAP_FILE;
+
+/* a STREAMFILE that reads from a memory mapped file (no buffers or seeks, reads are plain copies) */
+typedef struct {
+    STREAMFILE sf;          /* callbacks */
+    MMAP_FILE * map;        /* shared mapping */
+    char name[PATH_LIMIT];
+    off_t offset;           /* last read end, for get_offset */
+    STREAMFILE_STATS stats; /* I/O counters (all reads are hits, paging is up to the OS) */
+} MMAPSTREAMFILE;
+
+static STREAMFILE * open_mmap_streamfile_by_map(MMAP_FILE * map, const char * const filename);
+
+static MMAP_FILE * map_file(const char * const filename) {
+    MMAP_FILE * map = calloc(1,sizeof(MMAP_FILE));
+    if (!map) return NULL;
+
+#if defined(_WIN32) || defined(WIN32)
+    {
+        HANDLE file;
+        LARGE_INTEGER filesize;
+
+        file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (file == INVALID_HANDLE_VALUE) goto fail;
+        if (!GetFileSizeEx(file, &filesize) || (uint64_t)filesize.QuadPart > (size_t)-1) {
+            CloseHandle(file);
+            goto fail;
+        }
+        map->size = (size_t)filesize.QuadPart;
+
+        if (map->size) {
+            /* the mapping keeps its own reference to the file */
+            map->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            CloseHandle(file);
+            if (!map->mapping) goto fail;
+
+            map->data = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+            if (!map->data) {
+                CloseHandle(map->mapping);
+                goto fail;
+            }
+        }
+        else {
+            CloseHandle(file);
+        }
+    }
+#else
+    {
+        int fd;
+        struct stat st;
+
+        fd = open(filename, O_RDONLY);
+        if (fd < 0) goto fail;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || (uint64_t)st.st_size > (size_t)-1) {
+            close(fd);
+            goto fail;
+        }
+        map->size = (size_t)st.st_size;
+
+        if (map->size) {
+            void * data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data == MAP_FAILED) {
+                close(fd);
+                goto fail;
+            }
+            map->data = data;
+        }
+
+        /* the mapping stays valid after closing, so no handle is kept per file */
+        close(fd);
+    }
+#endif
+
+    map->refs = 1;
+    return map;
+
+fail:
+    free(map);
+    return NULL;
+}
+
+static void unmap_file(MMAP_FILE * map) {
+    if (refcount_dec(&map->refs) > 0)
+        return;
+
+#if defined(_WIN32) || defined(WIN32)
+    if (map->data) {
+        UnmapViewOfFile(map->data);
+        CloseHandle(map->mapping);
+    }
+#else
+    if (map->data)
+        munmap(map->data, map->size);
+#endif
+    free(map);
+}
+
+static size_t read_mmap(MMAPSTREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read;
+
+    if (!streamfile || !dest || length<=0 || offset < 0)
+        return 0;
+
+    /* request outside file */
+    if (offset >= streamfile->map->size) {
+        streamfile->offset = streamfile->map->size;
+#if STREAMFILE_IGNORE_EOF
+        memset(dest,0,length);
+        return length; /* 0-set buffer */
+#else
+        return 0; /* nothing to read */
+#endif
+    }
+
+    length_read = length;
+    if (offset + length > streamfile->map->size)
+        length_read = streamfile->map->size - offset;
+
+    memcpy(dest, streamfile->map->data + offset, length_read);
+    streamfile->offset = offset + length_read;
+    streamfile->stats.reads++;
+    streamfile->stats.hits++;
+    streamfile->stats.bytes_consumed += length_read;
+
+#if STREAMFILE_IGNORE_EOF
+    if (length_read < length) {
+        memset(dest+length_read,0,length-length_read);
+        return length; /* partially-read + 0-set buffer */
+    }
+#endif
+    return length_read;
+}
+
+static size_t borrow_mmap(MMAPSTREAMFILE *streamfile, const uint8_t ** data, off_t offset, size_t length) {
+    if (!streamfile || !data || length<=0 || offset < 0 || offset >= streamfile->map->size)
+        return 0;
+
+    streamfile->stats.reads++;
+    streamfile->stats.hits++;
+    streamfile->stats.bytes_consumed += (offset + length > streamfile->map->size ? streamfile->map->size - offset : length);
+    *data = streamfile->map->data + offset;
+    return streamfile->map->size - offset;
+}
+
+static size_t get_size_mmap(MMAPSTREAMFILE * streamfile) {
+    return streamfile->map->size;
+}
+
+static off_t get_offset_mmap(MMAPSTREAMFILE *streamfile) {
+    return streamfile->offset;
+}
+
+static void get_name_mmap(MMAPSTREAMFILE *streamfile,char *buffer,size_t length) {
+    strncpy(buffer,streamfile->name,length);
+    buffer[length-1]='\0';
+}
+
+static void get_stats_mmap(MMAPSTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    add_stats(stats,&streamfile->stats);
+    stats->handles++;
+}
+
+static STREAMFILE *open_mmap(MMAPSTREAMFILE *streamfile,const char * const filename,size_t buffersize) {
+    STREAMFILE *newstreamFile;
+
+    if (!filename)
+        return NULL;
+
+    /* if same name, share the mapping (no buffer or file handle needed per channel) */
+    if (!strcmp(streamfile->name,filename)) {
+        refcount_inc(&streamfile->map->refs);
+        newstreamFile = open_mmap_streamfile_by_map(streamfile->map,filename);
+        if (newstreamFile)
+            return newstreamFile;
+        unmap_file(streamfile->map);
+        return NULL;
+    }
+
+    /* a normal open, map a new file (companion files) */
+    return open_mmap_streamfile(filename);
+}
+
+static void close_mmap(MMAPSTREAMFILE * streamfile) {
+    unmap_file(streamfile->map);
+    free(streamfile);
+}
+
+static STREAMFILE * open_mmap_streamfile_by_map(MMAP_FILE * map, const char * const filename) {
+    MMAPSTREAMFILE * streamfile;
+
+    streamfile = calloc(1,sizeof(MMAPSTREAMFILE));
+    if (!streamfile) return NULL;
+
+    streamfile->sf.read = (void*)read_mmap;
+    streamfile->sf.get_size = (void*)get_size_mmap;
+    streamfile->sf.get_offset = (void*)get_offset_mmap;
+    streamfile->sf.get_name = (void*)get_name_mmap;
+    streamfile->sf.get_realname = (void*)get_name_mmap;
+    streamfile->sf.open = (void*)open_mmap;
+    streamfile->sf.close = (void*)close_mmap;
+    streamfile->sf.borrow = (void*)borrow_mmap;
+    streamfile->sf.get_stats = (void*)get_stats_mmap;
+
+    streamfile->map = map;
+
+    strncpy(streamfile->name,filename,sizeof(streamfile->name));
+    streamfile->name[sizeof(streamfile->name)-1] = '\0';
+
+    return &streamfile->sf;
+}
+
+STREAMFILE * open_mmap_streamfile(const char * filename) {
+    MMAP_FILE * map;
+    STREAMFILE * streamFile;
+
+    if (!filename)
+        return NULL;
+    if (is_file_missing(filename))
+        return NULL;
+
+    map = map_file(filename);
+    if (!map) /* not a regular file or can't be mapped (ex. too big for 32-bit address space) */
+        return open_stdio_streamfile(filename);
+
+    streamFile = open_mmap_streamfile_by_map(map,filename);
+    if (!streamFile)
+        unmap_file(map);
+
+    return streamFile;
+}
+
+/* **************************************************** */
+
+/* a STREAMFILE that reads from a caller's buffer (not copied, must outlive all STREAMFILEs opened from it) */
+typedef struct {
+    STREAMFILE sf;          /* callbacks */
+    const uint8_t * buf;
+    size_t size;
+    char name[PATH_LIMIT];
+    off_t offset;           /* last read end, for get_offset */
+    STREAMFILE_STATS stats; /* I/O counters (all reads are hits) */
+} MEMORYSTREAMFILE;
+
+static size_t read_memory(MEMORYSTREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read;
+
+    if (!streamfile || !dest || length<=0 || offset < 0)
+        return 0;
+
+    /* request outside buffer */
+    if (offset >= streamfile->size) {
+        streamfile->offset = streamfile->size;
+#if STREAMFILE_IGNORE_EOF
+        memset(dest,0,length);
+        return length; /* 0-set buffer */
+#else
+        return 0; /* nothing to read */
+#endif
+    }
+
+    length_read = length;
+    if (offset + length > streamfile->size)
+        length_read = streamfile->size - offset;
+
+    memcpy(dest, streamfile->buf + offset, length_read);
+    streamfile->offset = offset + length_read;
+    streamfile->stats.reads++;
+    streamfile->stats.hits++;
+    streamfile->stats.bytes_consumed += length_read;
+
+#if STREAMFILE_IGNORE_EOF
+    if (length_read < length) {
+        memset(dest+length_read,0,length-length_read);
+        return length; /* partially-read + 0-set buffer */
+    }
+#endif
+    return length_read;
+}
+
+static size_t borrow_memory(MEMORYSTREAMFILE *streamfile, const uint8_t ** data, off_t offset, size_t length) {
+    if (!streamfile || !data || length<=0 || offset < 0 || offset >= streamfile->size)
+        return 0;
+
+    streamfile->stats.reads++;
+    streamfile->stats.hits++;
+    streamfile->stats.bytes_consumed += (offset + length > streamfile->size ? streamfile->size - offset : length);
+    *data = streamfile->buf + offset;
+    return streamfile->size - offset;
+}
+
+static size_t get_size_memory(MEMORYSTREAMFILE * streamfile) {
+    return streamfile->size;
+}
+
+static off_t get_offset_memory(MEMORYSTREAMFILE *streamfile) {
+    return streamfile->offset;
+}
+
+static void get_name_memory(MEMORYSTREAMFILE *streamfile,char *buffer,size_t length) {
+    strncpy(buffer,streamfile->name,length);
+    buffer[length-1]='\0';
+}
+
+static void get_stats_memory(MEMORYSTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    add_stats(stats,&streamfile->stats);
+    stats->handles++;
+}
+
+static STREAMFILE *open_memory(MEMORYSTREAMFILE *streamfile,const char * const filename,size_t buffersize) {
+    if (!filename)
+        return NULL;
+
+    /* if same name, another view of the same buffer */
+    if (!strcmp(streamfile->name,filename))
+        return open_memory_streamfile(streamfile->buf,streamfile->size,filename);
+
+    /* a normal open (companion files) */
+    return open_stdio_streamfile(filename);
+}
+
+static void close_memory(MEMORYSTREAMFILE * streamfile) {
+    free(streamfile);
+}
+
+STREAMFILE * open_memory_streamfile(const uint8_t * buf, size_t size, const char * name) {
+    MEMORYSTREAMFILE * streamfile;
+
+    if (!buf && size)
+        return NULL;
+
+    streamfile = calloc(1,sizeof(MEMORYSTREAMFILE));
+    if (!streamfile) return NULL;
+
+    streamfile->sf.read = (void*)read_memory;
+    streamfile->sf.get_size = (void*)get_size_memory;
+    streamfile->sf.get_offset = (void*)get_offset_memory;
+    streamfile->sf.get_name = (void*)get_name_memory;
+    streamfile->sf.get_realname = (void*)get_name_memory;
+    streamfile->sf.open = (void*)open_memory;
+    streamfile->sf.close = (void*)close_memory;
+    streamfile->sf.borrow = (void*)borrow_memory;
+    streamfile->sf.get_stats = (void*)get_stats_memory;
+
+    streamfile->buf = buf;
+    streamfile->size = size;
+
+    strncpy(streamfile->name,name ? name : "",sizeof(streamfile->name));
+    streamfile->name[sizeof(streamfile->name)-1] = '\0';
+
+    return &streamfile->sf;
+}
+
+/* **************************************************** */
+
+/* a STREAMFILE that buffers reads of another, for STREAMFILEs that are slow on small reads */
+typedef struct {
+    STREAMFILE sf;          /* callbacks */
+    STREAMFILE * inner;     /* wrapped STREAMFILE (owned) */
+    off_t offset;           /* buffer start */
+    size_t validsize;       /* current buffer size */
+    uint8_t * buffer;       /* data buffer (allocated on first read) */
+    size_t buffersize;      /* max buffer size */
+    STREAMFILE_STATS stats; /* I/O counters of calls to this STREAMFILE */
+} BUFFERSTREAMFILE;
+
+/* refills the buffer at offset, returns bytes now in the buffer */
+static size_t fill_buffer_buffer(BUFFERSTREAMFILE * streamfile, off_t offset) {
+    streamfile->validsize = 0;
+    if (!streamfile->buffer) {
+        streamfile->buffer = malloc(streamfile->buffersize);
+        if (!streamfile->buffer)
+            return 0;
+    }
+
+    streamfile->stats.misses++;
+    streamfile->offset = offset;
+    streamfile->validsize = read_streamfile(streamfile->buffer, offset, streamfile->buffersize, streamfile->inner);
+    return streamfile->validsize;
+}
+
+static size_t read_buffer(BUFFERSTREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read_total = 0;
+    uint64_t misses;
+
+    if (!streamfile || !dest || length<=0 || offset < 0)
+        return 0;
+
+    misses = streamfile->stats.misses;
+    while (length > 0) {
+        size_t length_read;
+
+        if (!(offset >= streamfile->offset && offset < streamfile->offset + streamfile->validsize)) {
+            if (!fill_buffer_buffer(streamfile, offset))
+                break;
+        }
+
+        length_read = streamfile->offset + streamfile->validsize - offset;
+        if (length_read > length)
+            length_read = length;
+
+        memcpy(dest, streamfile->buffer + (offset - streamfile->offset), length_read);
+        length_read_total += length_read;
+        length -= length_read;
+        dest += length_read;
+        offset += length_read;
+
+        /* buffer ends at EOF */
+        if (length > 0 && streamfile->validsize < streamfile->buffersize)
+            break;
+    }
+
+    streamfile->stats.reads++;
+    if (streamfile->stats.misses == misses)
+        streamfile->stats.hits++;
+    if (length > 0)
+        streamfile->stats.errors++;
+    streamfile->stats.bytes_consumed += length_read_total;
+    return length_read_total;
+}
+
+static size_t borrow_buffer(BUFFERSTREAMFILE *streamfile, const uint8_t ** data, off_t offset, size_t length) {
+    size_t length_read;
+
+    if (!streamfile || !data || length<=0 || offset < 0 || length > streamfile->buffersize)
+        return 0;
+
+    if (!(offset >= streamfile->offset && offset + length <= streamfile->offset + streamfile->validsize)) {
+        if (!fill_buffer_buffer(streamfile, offset))
+            return 0;
+    }
+    else {
+        streamfile->stats.hits++;
+    }
+
+    length_read = streamfile->offset + streamfile->validsize - offset;
+    streamfile->stats.reads++;
+    streamfile->stats.bytes_consumed += (length_read < length ? length_read : length);
+    *data = streamfile->buffer + (offset - streamfile->offset);
+    return length_read;
+}
+
+static size_t get_size_buffer(BUFFERSTREAMFILE * streamfile) {
+    return streamfile->inner->get_size(streamfile->inner);
+}
+
+static off_t get_offset_buffer(BUFFERSTREAMFILE *streamfile) {
+    return streamfile->offset;
+}
+
+static void get_name_buffer(BUFFERSTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_name(streamfile->inner,buffer,length);
+}
+
+static void get_realname_buffer(BUFFERSTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_realname(streamfile->inner,buffer,length);
+}
+
+static void get_stats_buffer(BUFFERSTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    add_wrapper_stats(stats,&streamfile->stats,streamfile->inner);
+}
+
+static STREAMFILE *open_buffer(BUFFERSTREAMFILE *streamfile,const char * const filename,size_t buffersize) {
+    STREAMFILE *newstreamFile, *newbufferFile;
+
+    newstreamFile = streamfile->inner->open(streamfile->inner,filename,buffersize);
+    if (!newstreamFile)
+        return NULL;
+
+    newbufferFile = open_buffer_streamfile(newstreamFile,streamfile->buffersize);
+    if (!newbufferFile) {
+        close_streamfile(newstreamFile);
+        return NULL;
+    }
+    return newbufferFile;
+}
+
+static void close_buffer(BUFFERSTREAMFILE * streamfile) {
+    close_streamfile(streamfile->inner);
+    free(streamfile->buffer);
+    free(streamfile);
+}
+
+STREAMFILE * open_buffer_streamfile(STREAMFILE * streamfile, size_t buffer_size) {
+    BUFFERSTREAMFILE * this_sf;
+
+    if (!streamfile)
+        return NULL;
+
+    this_sf = calloc(1,sizeof(BUFFERSTREAMFILE));
+    if (!this_sf) return NULL;
+
+    this_sf->sf.read = (void*)read_buffer;
+    this_sf->sf.get_size = (void*)get_size_buffer;
+    this_sf->sf.get_offset = (void*)get_offset_buffer;
+    this_sf->sf.get_name = (void*)get_name_buffer;
+    this_sf->sf.get_realname = (void*)get_realname_buffer;
+    this_sf->sf.open = (void*)open_buffer;
+    this_sf->sf.close = (void*)close_buffer;
+    this_sf->sf.borrow = (void*)borrow_buffer;
+    this_sf->sf.get_stats = (void*)get_stats_buffer;
+    this_sf->sf.stream_index = streamfile->stream_index;
+
+    this_sf->inner = streamfile;
+    this_sf->buffersize = buffer_size ? buffer_size : STREAMFILE_DEFAULT_BUFFER_SIZE;
+
+    return &this_sf->sf;
+}
+
+/* **************************************************** */
+
+/* a STREAMFILE for format detection: keeps the blocks of another that were read (first and last pinned),
+ * so the many header checks of failed inits don't re-read or evict data. Doesn't own the wrapped STREAMFILE,
+ * and files opened from it are plain ones (it's only meant to live while probing).
+ * One made for another thread also uses the blocks of a parent probe, which is left untouched meanwhile. */
+#define PROBE_BLOCK_SIZE  0x8000
+#define PROBE_MAX_BLOCKS  32
+
+typedef struct {
+    off_t offset;
+    size_t validsize;
+    uint8_t * data;
+    uint32_t last_use;
+} PROBE_BLOCK;
+
+typedef struct _PROBESTREAMFILE {
+    STREAMFILE sf;          /* callbacks */
+    STREAMFILE * inner;     /* wrapped STREAMFILE (not owned) */
+    struct _PROBESTREAMFILE * parent; /* shared read-only blocks (not owned), or NULL */
+    const volatile int * cancel; /* set by another thread to fail reads, or NULL */
+    size_t size;            /* wrapped STREAMFILE size */
+    off_t offset;           /* last block read, or size on EOF (like stdio, some metas loop until EOF by it) */
+    PROBE_BLOCK blocks[PROBE_MAX_BLOCKS];
+    int block_count;
+    uint32_t use_count;
+    STREAMFILE_STATS stats; /* I/O counters of calls to this STREAMFILE */
+} PROBESTREAMFILE;
+
+/* returns the (loaded) block that contains offset, or NULL on error */
+static PROBE_BLOCK * get_probe_block(PROBESTREAMFILE * streamfile, off_t offset) {
+    off_t block_offset = offset - (offset % PROBE_BLOCK_SIZE);
+    off_t last_offset = streamfile->size > 0 ? (streamfile->size - 1) - ((streamfile->size - 1) % PROBE_BLOCK_SIZE) : 0;
+    PROBE_BLOCK * block = NULL;
+    size_t block_size;
+    int i;
+
+    for (i = 0; i < streamfile->block_count; i++) {
+        if (streamfile->blocks[i].offset == block_offset) {
+            block = &streamfile->blocks[i];
+            block->last_use = ++streamfile->use_count;
+            return block;
+        }
+    }
+
+    if (streamfile->parent) {
+        for (i = 0; i < streamfile->parent->block_count; i++) {
+            if (streamfile->parent->blocks[i].offset == block_offset)
+                return &streamfile->parent->blocks[i]; /* read-only */
+        }
+    }
+
+    /* not found: use a new block or reuse the least recently used one (other than first and last) */
+    if (streamfile->block_count < PROBE_MAX_BLOCKS) {
+        block = &streamfile->blocks[streamfile->block_count];
+        block->data = malloc(PROBE_BLOCK_SIZE);
+        if (!block->data)
+            return NULL;
+        streamfile->block_count++;
+    }
+    else {
+        for (i = 0; i < streamfile->block_count; i++) {
+            PROBE_BLOCK * candidate = &streamfile->blocks[i];
+            if (candidate->offset == 0 || candidate->offset == last_offset)
+                continue;
+            if (!block || candidate->last_use < block->last_use)
+                block = candidate;
+        }
+        if (!block)
+            return NULL;
+    }
+
+    block_size = PROBE_BLOCK_SIZE;
+    if (block_offset + block_size > streamfile->size)
+        block_size = streamfile->size - block_offset;
+
+    streamfile->stats.misses++;
+    block->offset = block_offset;
+    block->validsize = read_streamfile(block->data, block_offset, block_size, streamfile->inner);
+    block->last_use = ++streamfile->use_count;
+    return block;
+}
+
+static size_t read_probe(PROBESTREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read_total = 0;
+    uint64_t misses;
+
+    if (!streamfile || !dest || length<=0)
+        return 0;
+    if (streamfile->cancel && *streamfile->cancel)
+        return 0;
+
+    misses = streamfile->stats.misses;
+    while (length > 0) {
+        PROBE_BLOCK * block;
+        size_t length_read;
+
+        if (offset < 0 || offset >= streamfile->size)
+            break;
+        block = get_probe_block(streamfile, offset);
+        if (!block || offset >= block->offset + block->validsize)
+            break;
+        streamfile->offset = block->offset;
+
+        length_read = block->offset + block->validsize - offset;
+        if (length_read > length)
+            length_read = length;
+
+        memcpy(dest, block->data + (offset - block->offset), length_read);
+        length_read_total += length_read;
+        length -= length_read;
+        dest += length_read;
+        offset += length_read;
+
+        /* short block (read error) */
+        if (length > 0 && block->validsize < PROBE_BLOCK_SIZE)
+            break;
+    }
+
+    if (length > 0)
+        streamfile->offset = streamfile->size;
+    streamfile->stats.reads++;
+    if (streamfile->stats.misses == misses)
+        streamfile->stats.hits++;
+    streamfile->stats.bytes_consumed += length_read_total;
+    return length_read_total;
+}
+
+static size_t borrow_probe(PROBESTREAMFILE *streamfile, const uint8_t ** data, off_t offset, size_t length) {
+    PROBE_BLOCK * block;
+    size_t length_read;
+    uint64_t misses;
+
+    if (!streamfile || !data || length<=0)
+        return 0;
+    if (streamfile->cancel && *streamfile->cancel)
+        return 0;
+
+    misses = streamfile->stats.misses;
+    block = (offset < 0 || offset >= streamfile->size) ? NULL : get_probe_block(streamfile, offset);
+    if (!block || offset >= block->offset + block->validsize) {
+        streamfile->offset = streamfile->size;
+        return 0;
+    }
+
+    length_read = block->offset + block->validsize - offset;
+    streamfile->offset = block->offset;
+    streamfile->stats.reads++;
+    if (streamfile->stats.misses == misses)
+        streamfile->stats.hits++;
+    streamfile->stats.bytes_consumed += (length_read < length ? length_read : length);
+    *data = block->data + (offset - block->offset);
+    return length_read;
+}
+
+static size_t get_size_probe(PROBESTREAMFILE * streamfile) {
+    return streamfile->size;
+}
+
+static off_t get_offset_probe(PROBESTREAMFILE *streamfile) {
+    return streamfile->offset;
+}
+
+static void get_name_probe(PROBESTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_name(streamfile->inner,buffer,length);
+}
+
+static void get_realname_probe(PROBESTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_realname(streamfile->inner,buffer,length);
+}
+
+static void get_stats_probe(PROBESTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    add_wrapper_stats(stats,&streamfile->stats,streamfile->inner);
+}
+
+static STREAMFILE *open_probe(PROBESTREAMFILE *streamfile,const char * const filename,size_t buffersize) {
+    if (streamfile->cancel && *streamfile->cancel)
+        return NULL;
+    return streamfile->inner->open(streamfile->inner,filename,buffersize);
+}
+
+static void close_probe(PROBESTREAMFILE * streamfile) {
+    int i;
+    for (i = 0; i < streamfile->block_count; i++) {
+        free(streamfile->blocks[i].data);
+    }
+    free(streamfile);
+}
+
+STREAMFILE * open_probe_streamfile(STREAMFILE * streamfile) {
+    return open_probe_streamfile_shared(streamfile, NULL, NULL);
+}
+
+STREAMFILE * open_probe_streamfile_shared(STREAMFILE * streamfile, STREAMFILE * parent_probe, const volatile int * cancel) {
+    PROBESTREAMFILE * this_sf;
+
+    if (!streamfile)
+        return NULL;
+
+    this_sf = calloc(1,sizeof(PROBESTREAMFILE));
+    if (!this_sf) return NULL;
+
+    this_sf->sf.read = (void*)read_probe;
+    this_sf->sf.get_size = (void*)get_size_probe;
+    this_sf->sf.get_offset = (void*)get_offset_probe;
+    this_sf->sf.get_name = (void*)get_name_probe;
+    this_sf->sf.get_realname = (void*)get_realname_probe;
+    this_sf->sf.open = (void*)open_probe;
+    this_sf->sf.close = (void*)close_probe;
+    this_sf->sf.borrow = (void*)borrow_probe;
+    this_sf->sf.get_stats = (void*)get_stats_probe;
+    this_sf->sf.stream_index = streamfile->stream_index;
+
+    this_sf->inner = streamfile;
+    this_sf->parent = (PROBESTREAMFILE *)parent_probe;
+    this_sf->cancel = cancel;
+    this_sf->size = get_streamfile_size(streamfile);
+
+    return &this_sf->sf;
+}
+
+/* **************************************************** */
+
+/* a STREAMFILE that sees part of another as a file, optionally deinterleaving it (unbuffered,
+ * callers get a BUFFERSTREAMFILE on top) */
+typedef struct {
+    STREAMFILE sf;          /* callbacks */
+    STREAMFILE * inner;     /* parent STREAMFILE (not owned) */
+    char name[PATH_LIMIT];
+    off_t start;            /* data start in the parent */
+    size_t size;            /* logical size */
+    size_t interleave;      /* block size, or 0 if data is contiguous */
+    size_t stride;          /* distance between blocks */
+    off_t offset;           /* last read end, for get_offset */
+    STREAMFILE_STATS stats; /* I/O counters of calls to this STREAMFILE */
+} WINDOWSTREAMFILE;
+
+static STREAMFILE * open_window_streamfile_raw(STREAMFILE * streamfile, const char * name, off_t offset, size_t size, size_t interleave, size_t stride);
+
+static size_t read_window(WINDOWSTREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read_total = 0;
+
+    if (!streamfile || !dest || length<=0 || offset < 0)
+        return 0;
+
+    streamfile->stats.reads++;
+
+    /* truncate at end of logical file */
+    if (offset >= streamfile->size)
+        return 0;
+    if (offset + length > streamfile->size)
+        length = streamfile->size - offset;
+
+    /* contiguous data: a single read */
+    if (!streamfile->interleave) {
+        length_read_total = read_streamfile(dest, streamfile->start + offset, length, streamfile->inner);
+        streamfile->offset = offset + length_read_total;
+        streamfile->stats.bytes_consumed += length_read_total;
+        return length_read_total;
+    }
+
+    /* interleaved data: one read per block */
+    while (length > 0) {
+        off_t block_num = offset / streamfile->interleave;
+        off_t intrablock_offset = offset % streamfile->interleave;
+        off_t physical_offset = streamfile->start + block_num * streamfile->stride + intrablock_offset;
+        size_t to_read, length_read;
+
+        to_read = streamfile->interleave - intrablock_offset;
+        if (to_read > length)
+            to_read = length;
+
+        length_read = read_streamfile(dest, physical_offset, to_read, streamfile->inner);
+        length_read_total += length_read;
+        streamfile->offset = offset + length_read;
+        if (length_read != to_read)
+            break; /* parent EOF */
+
+        dest += length_read;
+        offset += length_read;
+        length -= length_read;
+    }
+
+    streamfile->stats.bytes_consumed += length_read_total;
+    return length_read_total;
+}
+
+static size_t get_size_window(WINDOWSTREAMFILE * streamfile) {
+    return streamfile->size;
+}
+
+static off_t get_offset_window(WINDOWSTREAMFILE *streamfile) {
+    return streamfile->offset;
+}
+
+static void get_name_window(WINDOWSTREAMFILE *streamfile,char *buffer,size_t length) {
+    strncpy(buffer,streamfile->name,length);
+    buffer[length-1]='\0';
+}
+
+static void get_stats_window(WINDOWSTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    add_wrapper_stats(stats,&streamfile->stats,NULL); /* parent is counted by its owner */
+}
+
+static STREAMFILE *open_window(WINDOWSTREAMFILE *streamfile,const char * const filename,size_t buffersize) {
+    /* only the window itself exists */
+    if (!filename || strcmp(streamfile->name,filename))
+        return NULL;
+
+    return open_window_streamfile_raw(streamfile->inner,streamfile->name,streamfile->start,streamfile->size,streamfile->interleave,streamfile->stride);
+}
+
+static void close_window(WINDOWSTREAMFILE * streamfile) {
+    free(streamfile);
+}
+
+static STREAMFILE * open_window_streamfile_raw(STREAMFILE * streamfile, const char * name, off_t offset, size_t size, size_t interleave, size_t stride) {
+    WINDOWSTREAMFILE * this_sf;
+
+    if (!streamfile || !name)
+        return NULL;
+    if (interleave && stride < interleave)
+        return NULL;
+
+    this_sf = calloc(1,sizeof(WINDOWSTREAMFILE));
+    if (!this_sf) return NULL;
+
+    this_sf->sf.read = (void*)read_window;
+    this_sf->sf.get_size = (void*)get_size_window;
+    this_sf->sf.get_offset = (void*)get_offset_window;
+    this_sf->sf.get_name = (void*)get_name_window;
+    this_sf->sf.get_realname = (void*)get_name_window;
+    this_sf->sf.open = (void*)open_window;
+    this_sf->sf.close = (void*)close_window;
+    this_sf->sf.get_stats = (void*)get_stats_window;
+
+    this_sf->inner = streamfile;
+    this_sf->start = offset;
+    this_sf->size = size;
+    this_sf->interleave = interleave;
+    this_sf->stride = stride;
+
+    strncpy(this_sf->name,name,sizeof(this_sf->name));
+    this_sf->name[sizeof(this_sf->name)-1] = '\0';
+
+    return &this_sf->sf;
+}
 
+STREAMFILE * open_window_streamfile(STREAMFILE * streamfile, const char * name, off_t offset, size_t size, size_t interleave, size_t stride) {
+    STREAMFILE * windowFile, * bufferFile;
+
+    windowFile = open_window_streamfile_raw(streamfile,name,offset,size,interleave,stride);
+    if (!windowFile)
+        return NULL;
+
+    bufferFile = open_buffer_streamfile(windowFile,0);
+    if (!bufferFile) {
+        close_streamfile(windowFile);
+        return NULL;
+    }
+    return bufferFile;
+}
+
+/* **************************************************** */
 
-/* a STREAMFILE that operates via standard IO using a buffer */
+/* a STREAMFILE that wraps another and XORs part of its data with a repeating key (decrypts on read,
+ * so callers just see plain data) */
 typedef struct {
     STREAMFILE sf;          /* callbacks */
-    FILE * infile;          /* actual FILE */
+    STREAMFILE * inner;     /* wrapped STREAMFILE (owned) */
+    off_t start;            /* encrypted area */
+    size_t size;
+    uint8_t * key;          /* key, then its first 8 bytes again (so a word at any key position is contiguous) */
+    size_t key_size;
+} XORSTREAMFILE;
+
+static void xor_data(XORSTREAMFILE * streamfile, uint8_t * data, off_t offset, size_t length) {
+    off_t end = streamfile->start + streamfile->size;
+    size_t pos;
+
+    /* only XOR what's inside the encrypted area */
+    if (offset < streamfile->start) {
+        size_t skip = streamfile->start - offset;
+        if (skip >= length)
+            return;
+        data += skip;
+        offset += skip;
+        length -= skip;
+    }
+    if (offset >= end)
+        return;
+    if (offset + length > end)
+        length = end - offset;
+
+    pos = (offset - streamfile->start) % streamfile->key_size;
+
+    /* a word at a time (compilers turn the memcpy into plain loads/stores) */
+    while (length >= 8) {
+        uint64_t data_word, key_word;
+        memcpy(&data_word, data, 8);
+        memcpy(&key_word, streamfile->key + pos, 8);
+        data_word ^= key_word;
+        memcpy(data, &data_word, 8);
+
+        data += 8;
+        length -= 8;
+        pos = (pos + 8) % streamfile->key_size;
+    }
+
+    while (length > 0) {
+        *data++ ^= streamfile->key[pos];
+        length--;
+        pos++;
+        if (pos == streamfile->key_size)
+            pos = 0;
+    }
+}
+
+static size_t read_xor(XORSTREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read = read_streamfile(dest, offset, length, streamfile->inner);
+    xor_data(streamfile, dest, offset, length_read);
+    return length_read;
+}
+
+static size_t get_size_xor(XORSTREAMFILE * streamfile) {
+    return streamfile->inner->get_size(streamfile->inner);
+}
+
+static off_t get_offset_xor(XORSTREAMFILE *streamfile) {
+    return streamfile->inner->get_offset(streamfile->inner);
+}
+
+static void get_name_xor(XORSTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_name(streamfile->inner,buffer,length);
+}
+
+static void get_realname_xor(XORSTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_realname(streamfile->inner,buffer,length);
+}
+
+static void get_stats_xor(XORSTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    get_streamfile_stats(streamfile->inner,stats); /* just passes reads */
+}
+
+static STREAMFILE *open_xor(XORSTREAMFILE *streamfile,const char * const filename,size_t buffersize) {
+    STREAMFILE *newstreamFile, *newxorFile;
     char name[PATH_LIMIT];
-    off_t offset;           /* current offset */
-    size_t validsize;       /* current buffer size */
-    uint8_t * buffer;       /* data buffer */
-    size_t buffersize;      /* max buffer size */
-    size_t filesize;        /* cached file size (max offset) */
-#ifdef VGM_DEBUG_OUTPUT
-    int error_notified;
-#endif
-#ifdef PROFILE_STREAMFILE
-    size_t bytes_read;
-    int error_count;
-#endif
-} STDIOSTREAMFILE;
 
-static STREAMFILE * open_stdio_streamfile_buffer(const char * const filename, size_t buffersize);
-static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char * const filename, size_t buffersize);
+    if (!filename)
+        return NULL;
 
-static size_t read_the_rest(uint8_t * dest, off_t offset, size_t length, STDIOSTREAMFILE * streamfile) {
-    size_t length_read_total=0;
+    newstreamFile = streamfile->inner->open(streamfile->inner,filename,buffersize);
+    if (!newstreamFile)
+        return NULL;
 
-    /* is the part of the requested length in the buffer? */
-    if (offset >= streamfile->offset && offset < streamfile->offset + streamfile->validsize) {
-        size_t length_read;
-        off_t offset_into_buffer = offset - streamfile->offset;
-        length_read = streamfile->validsize - offset_into_buffer;
+    /* only the same file is encrypted (not companion files) */
+    streamfile->inner->get_name(streamfile->inner,name,sizeof(name));
+    if (strcmp(name,filename))
+        return newstreamFile;
 
-        memcpy(dest,streamfile->buffer + offset_into_buffer,length_read);
-        length_read_total += length_read;
-        length -= length_read;
-        offset += length_read;
-        dest += length_read;
+    newxorFile = open_xor_streamfile(newstreamFile,streamfile->key,streamfile->key_size,streamfile->start,streamfile->size);
+    if (!newxorFile) {
+        close_streamfile(newstreamFile);
+        return NULL;
     }
+    return newxorFile;
+}
 
-    /* What would make more sense here is to read the whole request
-     * at once into the dest buffer, as it must be large enough, and then
-     * copy some part of that into our own buffer.
-     * The destination buffer is supposed to be much smaller than the
-     * STREAMFILE buffer, though. Maybe we should only ever return up
-     * to the buffer size to avoid having to deal with things like this
-     * which are outside of my intended use.
-     */
-    /* read the rest of the requested length */
-    while (length > 0) {
-        size_t length_to_read;
-        size_t length_read;
-        streamfile->validsize = 0; /* buffer is empty now */
+static void close_xor(XORSTREAMFILE * streamfile) {
+    close_streamfile(streamfile->inner);
+    free(streamfile->key);
+    free(streamfile);
+}
 
-        /* request outside file: ignore to avoid seek/read */
-        if (offset > streamfile->filesize) {
-            streamfile->offset = streamfile->filesize;
+STREAMFILE * open_xor_streamfile(STREAMFILE * streamfile, const uint8_t * key, size_t key_size, off_t offset, size_t size) {
+    XORSTREAMFILE * this_sf;
+    size_t i;
 
-#ifdef VGM_DEBUG_OUTPUT
-            if (!streamfile->error_notified) {
-                VGM_LOG("ERROR: reading over filesize 0x%x @ 0x%lx + 0x%x (buggy meta?)\n", streamfile->filesize, offset, length);
-                streamfile->error_notified = 1;
-            }
-#endif
+    if (!streamfile || !key || !key_size)
+        return NULL;
 
-#if STREAMFILE_IGNORE_EOF
-            memset(dest,0,length); /* dest is already shifted */
-            return length_read_total + length; /* partially-read + 0-set buffer */
-#else
-            return length_read_total; /* partially-read buffer */
-#endif
-        }
+    this_sf = calloc(1,sizeof(XORSTREAMFILE));
+    if (!this_sf) return NULL;
 
-        /* position to new offset */
-        if (fseeko(streamfile->infile,offset,SEEK_SET)) {
-            streamfile->offset = streamfile->filesize;
-#ifdef PROFILE_STREAMFILE
-            streamfile->error_count++;
-#endif
-            return 0; /* fail miserably (fseek shouldn't fail and reach this) */
-        }
-        streamfile->offset = offset;
+    this_sf->key = malloc(key_size + 8);
+    if (!this_sf->key) {
+        free(this_sf);
+        return NULL;
+    }
+    for (i = 0; i < key_size + 8; i++) {
+        this_sf->key[i] = key[i % key_size];
+    }
 
-        /* decide how much must be read this time */
-        if (length > streamfile->buffersize)
-            length_to_read = streamfile->buffersize;
-        else
-            length_to_read = length;
+    this_sf->sf.read = (void*)read_xor;
+    this_sf->sf.get_size = (void*)get_size_xor;
+    this_sf->sf.get_offset = (void*)get_offset_xor;
+    this_sf->sf.get_name = (void*)get_name_xor;
+    this_sf->sf.get_realname = (void*)get_realname_xor;
+    this_sf->sf.open = (void*)open_xor;
+    this_sf->sf.close = (void*)close_xor;
+    this_sf->sf.get_stats = (void*)get_stats_xor;
+    this_sf->sf.stream_index = streamfile->stream_index;
+
+    this_sf->inner = streamfile;
+    this_sf->start = offset;
+    this_sf->size = size;
+    this_sf->key_size = key_size;
+
+    return &this_sf->sf;
+}
 
-        /* fill the buffer */
-        length_read = fread(streamfile->buffer,sizeof(uint8_t),streamfile->buffersize,streamfile->infile);
-        streamfile->validsize = length_read;
+/* **************************************************** */
 
-#ifdef PROFILE_STREAMFILE
-        if (ferror(streamfile->infile)) {
-            clearerr(streamfile->infile);
-            streamfile->error_count++;
-        }
+#if !defined(_WIN32) && !defined(WIN32)
 
-        streamfile->bytes_read += length_read;
-#endif
+/* a STREAMFILE that wraps another and reads its next (predicted) window in a helper thread,
+ * so decoding and I/O overlap. The wrapped STREAMFILE is only touched with io_lock held.
+ * STREAMFILEs opened from it (channels, companion files) share the same thread, so opening
+ * many doesn't start a thread each. */
+struct _PREFETCHSTREAMFILE;
 
-        /* if we can't get enough to satisfy the request (EOF) we give up */
-        if (length_read < length_to_read) {
-            memcpy(dest,streamfile->buffer,length_read);
+typedef struct {
+    pthread_t thread;
+    pthread_mutex_t lock;   /* protects the next_x of its streamfiles, the list and stop */
+    pthread_cond_t cond;
+    struct _PREFETCHSTREAMFILE * streamfiles; /* ones using the thread */
+    int stop;
+} PREFETCH_READER;
+
+typedef struct _PREFETCHSTREAMFILE {
+    STREAMFILE sf;          /* callbacks */
+    STREAMFILE * inner;     /* wrapped STREAMFILE (owned) */
+    size_t buffersize;      /* window size */
 
-#if STREAMFILE_IGNORE_EOF
-            memset(dest+length_read,0,length-length_read);
-            return length_read_total + length; /* partially-read + 0-set buffer */
-#else
-            return length_read_total + length_read; /* partially-read buffer */
-#endif
+    /* current window (only used by the caller) */
+    uint8_t * buffer;
+    off_t offset;
+    size_t validsize;
+    off_t last_offset;      /* previous window start, to predict the next */
+    off_t stride;           /* last distance between windows */
+
+    /* prefetched window (filled by the thread) */
+    uint8_t * next_buffer;
+    off_t next_offset;
+    size_t next_validsize;
+    int next_state;         /* PREFETCH_x */
+
+    PREFETCH_READER * reader; /* shared thread */
+    struct _PREFETCHSTREAMFILE * next; /* in the reader's list */
+    pthread_mutex_t io_lock;/* protects inner */
+
+    STREAMFILE_STATS stats; /* I/O counters of calls to this STREAMFILE (misses are windows not prefetched) */
+} PREFETCHSTREAMFILE;
+
+enum { PREFETCH_EMPTY, PREFETCH_REQUESTED, PREFETCH_READING, PREFETCH_READY };
+
+static STREAMFILE * open_prefetch_streamfile_reader(STREAMFILE * streamfile, PREFETCH_READER * reader);
+
+static void * prefetch_thread(void * arg) {
+    PREFETCH_READER * reader = arg;
+
+    pthread_mutex_lock(&reader->lock);
+    while (1) {
+        PREFETCHSTREAMFILE * streamfile;
+        off_t offset;
+        size_t length_read;
+
+        /* each streamfile has one request at most, so taking them in list order is fair enough */
+        for (streamfile = reader->streamfiles; streamfile; streamfile = streamfile->next) {
+            if (streamfile->next_state == PREFETCH_REQUESTED)
+                break;
         }
+        if (reader->stop)
+            break;
+        if (!streamfile) {
+            pthread_cond_wait(&reader->cond, &reader->lock);
+            continue;
+        }
+
+        offset = streamfile->next_offset;
+        streamfile->next_state = PREFETCH_READING;
+        pthread_mutex_unlock(&reader->lock);
+
+        pthread_mutex_lock(&streamfile->io_lock);
+        length_read = read_streamfile(streamfile->next_buffer, offset, streamfile->buffersize, streamfile->inner);
+        pthread_mutex_unlock(&streamfile->io_lock);
 
-        /* use the new buffer */
-        memcpy(dest,streamfile->buffer,length_to_read);
-        length_read_total += length_to_read;
-        length -= length_to_read;
-        dest += length_to_read;
-        offset += length_to_read;
+        pthread_mutex_lock(&reader->lock);
+        streamfile->next_validsize = length_read;
+        streamfile->next_state = PREFETCH_READY;
+        pthread_cond_broadcast(&reader->cond);
     }
+    pthread_mutex_unlock(&reader->lock);
 
-    return length_read_total;
+    return NULL;
 }
 
-static size_t read_stdio(STDIOSTREAMFILE *streamfile,uint8_t * dest, off_t offset, size_t length) {
+static PREFETCH_READER * open_prefetch_reader(void) {
+    PREFETCH_READER * reader = calloc(1,sizeof(PREFETCH_READER));
+    if (!reader) return NULL;
 
-    if (!streamfile || !dest || length<=0)
+    if (pthread_mutex_init(&reader->lock, NULL) != 0)
+        goto fail;
+    if (pthread_cond_init(&reader->cond, NULL) != 0) {
+        pthread_mutex_destroy(&reader->lock);
+        goto fail;
+    }
+    if (pthread_create(&reader->thread, NULL, prefetch_thread, reader) != 0) {
+        pthread_cond_destroy(&reader->cond);
+        pthread_mutex_destroy(&reader->lock);
+        goto fail;
+    }
+    return reader;
+
+fail:
+    free(reader);
+    return NULL;
+}
+
+static void close_prefetch_reader(PREFETCH_READER * reader) {
+    pthread_mutex_lock(&reader->lock);
+    reader->stop = 1;
+    pthread_cond_broadcast(&reader->cond);
+    pthread_mutex_unlock(&reader->lock);
+    pthread_join(reader->thread, NULL);
+
+    pthread_cond_destroy(&reader->cond);
+    pthread_mutex_destroy(&reader->lock);
+    free(reader);
+}
+
+/* Guesses the next window from the last two: a repeated jump (channel data in an interleaved
+ * file) continues with the same stride, and reads after the last window (or a good guess) are
+ * assumed to be sequential. Random reads aren't prefetched, as that would only double the I/O. */
+static void prefetch_next(PREFETCHSTREAMFILE * streamfile, int is_prefetched) {
+    off_t stride = streamfile->offset - streamfile->last_offset;
+    off_t next_offset;
+
+    if (stride > 0 && stride == streamfile->stride && stride != streamfile->buffersize)
+        next_offset = streamfile->offset + stride;
+    else if (is_prefetched || (stride > 0 && stride < 2*streamfile->buffersize))
+        next_offset = streamfile->offset + streamfile->buffersize;
+    else
+        next_offset = -1;
+    streamfile->stride = stride;
+    streamfile->last_offset = streamfile->offset;
+
+    if (next_offset < 0)
+        return;
+    if (streamfile->validsize < streamfile->buffersize && next_offset >= streamfile->offset + streamfile->validsize)
+        return; /* EOF */
+
+    /* the thread isn't using this streamfile's window (ready ones are discarded and reading ones waited for) */
+    pthread_mutex_lock(&streamfile->reader->lock);
+    streamfile->next_offset = next_offset;
+    streamfile->next_state = PREFETCH_REQUESTED;
+    pthread_cond_broadcast(&streamfile->reader->cond);
+    pthread_mutex_unlock(&streamfile->reader->lock);
+}
+
+/* makes the current window start at or contain offset, returns 0 on error */
+static int prefetch_window(PREFETCHSTREAMFILE * streamfile, off_t offset) {
+    int is_prefetched = 0;
+
+    /* wait for the thread and take its window if it has offset */
+    pthread_mutex_lock(&streamfile->reader->lock);
+    while (streamfile->next_state == PREFETCH_REQUESTED || streamfile->next_state == PREFETCH_READING)
+        pthread_cond_wait(&streamfile->reader->cond, &streamfile->reader->lock);
+    if (streamfile->next_state == PREFETCH_READY) {
+        if (offset >= streamfile->next_offset && offset < streamfile->next_offset + streamfile->next_validsize) {
+            uint8_t * buffer = streamfile->buffer;
+            streamfile->buffer = streamfile->next_buffer;
+            streamfile->next_buffer = buffer;
+            streamfile->offset = streamfile->next_offset;
+            streamfile->validsize = streamfile->next_validsize;
+            is_prefetched = 1;
+        }
+        streamfile->next_state = PREFETCH_EMPTY;
+    }
+    pthread_mutex_unlock(&streamfile->reader->lock);
+
+    /* bad guess, read it now */
+    if (!is_prefetched) {
+        streamfile->stats.misses++;
+        pthread_mutex_lock(&streamfile->io_lock);
+        streamfile->validsize = read_streamfile(streamfile->buffer, offset, streamfile->buffersize, streamfile->inner);
+        pthread_mutex_unlock(&streamfile->io_lock);
+        streamfile->offset = offset;
+    }
+
+    prefetch_next(streamfile, is_prefetched);
+    return streamfile->validsize > 0;
+}
+
+static size_t read_prefetch(PREFETCHSTREAMFILE *streamfile, uint8_t * dest, off_t offset, size_t length) {
+    size_t length_read_total = 0;
+    uint64_t misses;
+
+    if (!streamfile || !dest || length<=0 || offset < 0)
         return 0;
 
-    /* request outside file: ignore to avoid seek/read in read_the_rest() */
-    if (offset > streamfile->filesize) {
-        streamfile->offset = streamfile->filesize;
+    misses = streamfile->stats.misses;
+    while (length > 0) {
+        size_t length_read;
 
-#ifdef VGM_DEBUG_OUTPUT
-        if (!streamfile->error_notified) {
-            VGM_LOG("ERROR: offset over filesize 0x%x @ 0x%lx + 0x%x (buggy meta?)\n", streamfile->filesize, offset, length);
-            streamfile->error_notified = 1;
+        if (!(offset >= streamfile->offset && offset < streamfile->offset + streamfile->validsize)) {
+            if (!prefetch_window(streamfile, offset))
+                break;
         }
-#endif
 
-#if STREAMFILE_IGNORE_EOF
-        memset(dest,0,length);
-        return length; /* 0-set buffer */
-#else
-        return 0; /* nothing to read */
-#endif
-    }
+        length_read = streamfile->offset + streamfile->validsize - offset;
+        if (length_read > length)
+            length_read = length;
 
-    /* just copy if entire request is within the buffer */
-    if (offset >= streamfile->offset && offset + length <= streamfile->offset + streamfile->validsize) {
-        off_t offset_into_buffer = offset - streamfile->offset;
-        memcpy(dest,streamfile->buffer + offset_into_buffer,length);
-        return length;
-    }
+        memcpy(dest, streamfile->buffer + (offset - streamfile->offset), length_read);
+        length_read_total += length_read;
+        length -= length_read;
+        dest += length_read;
+        offset += length_read;
 
-    /* request outside buffer: new fread */
-    {
-        size_t length_read = read_the_rest(dest,offset,length,streamfile);
-#ifdef PROFILE_STREAMFILE
-        if (length_read < length) 
-            streamfile->error_count++;
-#endif
-        return length_read;
+        /* window ends at EOF */
+        if (length > 0 && streamfile->validsize < streamfile->buffersize)
+            break;
     }
+
+    streamfile->stats.reads++;
+    if (streamfile->stats.misses == misses)
+        streamfile->stats.hits++;
+    if (length > 0)
+        streamfile->stats.errors++;
+    streamfile->stats.bytes_consumed += length_read_total;
+    return length_read_total;
 }
 
-static void close_stdio(STDIOSTREAMFILE * streamfile) {
-    fclose(streamfile->infile);
-    free(streamfile->buffer);
-    free(streamfile);
+static size_t borrow_prefetch(PREFETCHSTREAMFILE *streamfile, const uint8_t ** data, off_t offset, size_t length) {
+    size_t length_read;
+    uint64_t misses;
+
+    if (!streamfile || !data || length<=0 || offset < 0 || length > streamfile->buffersize)
+        return 0;
+
+    misses = streamfile->stats.misses;
+    if (!(offset >= streamfile->offset && offset + length <= streamfile->offset + streamfile->validsize)) {
+        if (!prefetch_window(streamfile, offset))
+            return 0;
+        if (offset < streamfile->offset || offset + length > streamfile->offset + streamfile->validsize) {
+            /* window has offset but not all of length (prefetched), realign */
+            if (!prefetch_window(streamfile, offset) || offset != streamfile->offset)
+                return 0;
+        }
+    }
+
+    length_read = streamfile->offset + streamfile->validsize - offset;
+    streamfile->stats.reads++;
+    if (streamfile->stats.misses == misses)
+        streamfile->stats.hits++;
+    streamfile->stats.bytes_consumed += (length_read < length ? length_read : length);
+    *data = streamfile->buffer + (offset - streamfile->offset);
+    return length_read;
 }
 
-static size_t get_size_stdio(STDIOSTREAMFILE * streamfile) {
-    return streamfile->filesize;
+static size_t get_size_prefetch(PREFETCHSTREAMFILE * streamfile) {
+    return streamfile->inner->get_size(streamfile->inner);
 }
 
-static off_t get_offset_stdio(STDIOSTREAMFILE *streamFile) {
-    return streamFile->offset;
+static off_t get_offset_prefetch(PREFETCHSTREAMFILE *streamfile) {
+    return streamfile->offset;
 }
 
-static void get_name_stdio(STDIOSTREAMFILE *streamfile,char *buffer,size_t length) {
-    strncpy(buffer,streamfile->name,length);
-    buffer[length-1]='\0';
+static void get_name_prefetch(PREFETCHSTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_name(streamfile->inner,buffer,length);
 }
 
-#ifdef PROFILE_STREAMFILE
-static size_t get_bytes_read_stdio(STDIOSTREAMFILE *streamFile) {
-    return streamFile->bytes_read;
+static void get_realname_prefetch(PREFETCHSTREAMFILE *streamfile,char *buffer,size_t length) {
+    streamfile->inner->get_realname(streamfile->inner,buffer,length);
 }
-static size_t get_error_count_stdio(STDIOSTREAMFILE *streamFile) {
-    return streamFile->error_count;
+
+static void get_stats_prefetch(PREFETCHSTREAMFILE *streamfile, STREAMFILE_STATS * stats) {
+    /* inner may be read by the thread */
+    pthread_mutex_lock(&streamfile->io_lock);
+    add_wrapper_stats(stats,&streamfile->stats,streamfile->inner);
+    pthread_mutex_unlock(&streamfile->io_lock);
 }
-#endif
 
-static STREAMFILE *open_stdio(STDIOSTREAMFILE *streamFile,const char * const filename,size_t buffersize) {
-    int newfd;
-    FILE *newfile;
-    STREAMFILE *newstreamFile;
+static STREAMFILE *open_prefetch(PREFETCHSTREAMFILE *streamfile,const char * const filename,size_t buffersize) {
+    STREAMFILE *newstreamFile, *newprefetchFile;
 
-    if (!filename)
+    /* inner may be shared with the thread */
+    pthread_mutex_lock(&streamfile->io_lock);
+    newstreamFile = streamfile->inner->open(streamfile->inner,filename,buffersize);
+    pthread_mutex_unlock(&streamfile->io_lock);
+    if (!newstreamFile)
         return NULL;
 
-    // if same name, duplicate the file pointer we already have open
-    if (!strcmp(streamFile->name,filename)) {
-        if (((newfd = dup(fileno(streamFile->infile))) >= 0) &&
-            (newfile = fdopen( newfd, "rb" ))) 
-        {
-            newstreamFile = open_stdio_streamfile_buffer_by_file(newfile,filename,buffersize);
-            if (newstreamFile) { 
-                return newstreamFile;
-            }
-            // failure, close it and try the default path (which will probably fail a second time)
-            fclose(newfile);
-        }
+    /* each channel keeps its own windows (and read pattern), but the thread is shared */
+    newprefetchFile = open_prefetch_streamfile_reader(newstreamFile, streamfile->reader);
+    if (!newprefetchFile) {
+        close_streamfile(newstreamFile);
+        return NULL;
     }
-    // a normal open, open a new file
-    return open_stdio_streamfile_buffer(filename,buffersize);
+    return newprefetchFile;
 }
 
-static STREAMFILE * open_stdio_streamfile_buffer_by_file(FILE *infile,const char * const filename, size_t buffersize) {
-    uint8_t * buffer;
-    STDIOSTREAMFILE * streamfile;
+static void close_prefetch(PREFETCHSTREAMFILE * streamfile) {
+    PREFETCH_READER * reader = streamfile->reader;
+    PREFETCHSTREAMFILE ** prev;
+    int is_last;
+
+    /* stop using the thread (waiting if it's reading for this one) */
+    pthread_mutex_lock(&reader->lock);
+    while (streamfile->next_state == PREFETCH_READING)
+        pthread_cond_wait(&reader->cond, &reader->lock);
+    for (prev = &reader->streamfiles; *prev != streamfile; prev = &(*prev)->next)
+        ;
+    *prev = streamfile->next;
+    is_last = (reader->streamfiles == NULL);
+    pthread_mutex_unlock(&reader->lock);
+    if (is_last)
+        close_prefetch_reader(reader);
+
+    pthread_mutex_destroy(&streamfile->io_lock);
+
+    close_streamfile(streamfile->inner);
+    free(streamfile->buffer);
+    free(streamfile->next_buffer);
+    free(streamfile);
+}
 
-    buffer = calloc(buffersize,1);
-    if (!buffer) {
-        return NULL;
-    }
+/* reader is the thread to use, or NULL to start one */
+static STREAMFILE * open_prefetch_streamfile_reader(STREAMFILE * streamfile, PREFETCH_READER * reader) {
+    PREFETCHSTREAMFILE * this_sf;
 
-    streamfile = calloc(1,sizeof(STDIOSTREAMFILE));
-    if (!streamfile) {
-        free(buffer);
+    if (!streamfile)
         return NULL;
-    }
 
-    streamfile->sf.read = (void*)read_stdio;
-    streamfile->sf.get_size = (void*)get_size_stdio;
-    streamfile->sf.get_offset = (void*)get_offset_stdio;
-    streamfile->sf.get_name = (void*)get_name_stdio;
-    streamfile->sf.get_realname = (void*)get_name_stdio;
-    streamfile->sf.open = (void*)open_stdio;
-    streamfile->sf.close = (void*)close_stdio;
-#ifdef PROFILE_STREAMFILE
-    streamfile->sf.get_bytes_read = (void*)get_bytes_read_stdio;
-    streamfile->sf.get_error_count = (void*)get_error_count_stdio;
-#endif
+    this_sf = calloc(1,sizeof(PREFETCHSTREAMFILE));
+    if (!this_sf) return NULL;
+
+    this_sf->sf.read = (void*)read_prefetch;
+    this_sf->sf.get_size = (void*)get_size_prefetch;
+    this_sf->sf.get_offset = (void*)get_offset_prefetch;
+    this_sf->sf.get_name = (void*)get_name_prefetch;
+    this_sf->sf.get_realname = (void*)get_realname_prefetch;
+    this_sf->sf.open = (void*)open_prefetch;
+    this_sf->sf.close = (void*)close_prefetch;
+    this_sf->sf.borrow = (void*)borrow_prefetch;
+    this_sf->sf.get_stats = (void*)get_stats_prefetch;
+    this_sf->sf.stream_index = streamfile->stream_index;
+
+    this_sf->inner = streamfile;
+    this_sf->buffersize = STREAMFILE_DEFAULT_BUFFER_SIZE;
+    this_sf->buffer = malloc(this_sf->buffersize);
+    this_sf->next_buffer = malloc(this_sf->buffersize);
+    if (!this_sf->buffer || !this_sf->next_buffer)
+        goto fail;
 
-    streamfile->infile = infile;
-    streamfile->buffersize = buffersize;
-    streamfile->buffer = buffer;
+    if (pthread_mutex_init(&this_sf->io_lock, NULL) != 0)
+        goto fail;
 
-    strncpy(streamfile->name,filename,sizeof(streamfile->name));
-    streamfile->name[sizeof(streamfile->name)-1] = '\0';
+    if (!reader) {
+        reader = open_prefetch_reader();
+        if (!reader) {
+            pthread_mutex_destroy(&this_sf->io_lock);
+            goto fail;
+        }
+    }
+    this_sf->reader = reader;
+    pthread_mutex_lock(&reader->lock);
+    this_sf->next = reader->streamfiles;
+    reader->streamfiles = this_sf;
+    pthread_mutex_unlock(&reader->lock);
 
-    /* cache filesize */
-    fseeko(streamfile->infile,0,SEEK_END);
-    streamfile->filesize = ftello(streamfile->infile);
+    return &this_sf->sf;
 
-    return &streamfile->sf;
+fail:
+    free(this_sf->buffer);
+    free(this_sf->next_buffer);
+    free(this_sf);
+    return NULL;
 }
 
-static STREAMFILE * open_stdio_streamfile_buffer(const char * const filename, size_t buffersize) {
-    FILE * infile;
-    STREAMFILE *streamFile;
-
-    infile = fopen(filename,"rb");
-    if (!infile) return NULL;
-
-    streamFile = open_stdio_streamfile_buffer_by_file(infile,filename,buffersize);
-    if (!streamFile) {
-        fclose(infile);
-    }
-
-    return streamFile;
+STREAMFILE * open_prefetch_streamfile(STREAMFILE * streamfile) {
+    return open_prefetch_streamfile_reader(streamfile, NULL);
 }
 
+#else
 
-STREAMFILE * open_stdio_streamfile(const char * filename) {
-    return open_stdio_streamfile_buffer(filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
+/* no threads here, so no prefetching */
+STREAMFILE * open_prefetch_streamfile(STREAMFILE * streamfile) {
+    return streamfile;
 }
 
-STREAMFILE * open_stdio_streamfile_by_file(FILE * file, const char * filename) {
-    return open_stdio_streamfile_buffer_by_file(file,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
-}
+#endif
 
 
 /* **************************************************** */
@@ -384,32 +2292,22 @@ fail:
  * Opens an stream using the base streamFile name plus a new extension (ex. for headers in a separate file)
  */
 STREAMFILE * open_stream_ext(STREAMFILE *streamFile, const char * ext) {
+    const STREAMFILE_NAME_INFO * info = get_streamfile_name_info(streamFile);
     char filename_ext[PATH_LIMIT];
 
     streamFile->get_name(streamFile,filename_ext,sizeof(filename_ext));
-    strcpy(filename_ext + strlen(filename_ext) - strlen(filename_extension(filename_ext)), ext);
+    strcpy(filename_ext + info->name_size - info->ext_size, ext);
 
     return streamFile->open(streamFile,filename_ext,STREAMFILE_DEFAULT_BUFFER_SIZE);
 }
 
 /* Opens an stream in the same folder */
 STREAMFILE * open_stream_name(STREAMFILE *streamFile, const char * name) {
-    char foldername[PATH_LIMIT];
+    const STREAMFILE_NAME_INFO * info = get_streamfile_name_info(streamFile);
     char filename[PATH_LIMIT];
-    const char *path;
-
-    streamFile->get_name(streamFile,foldername,sizeof(foldername));
 
-    path = strrchr(foldername,DIR_SEPARATOR);
-    if (path!=NULL) path = path+1;
-
-    if (path) {
-        strcpy(filename, foldername);
-        filename[path-foldername] = '\0';
-        strcat(filename, name);
-    } else {
-        strcpy(filename, name);
-    }
+    streamFile->get_name(streamFile,filename,sizeof(filename));
+    strcpy(filename + info->path_size, name);
 
     return streamFile->open(streamFile,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
 }
@@ -540,31 +2438,27 @@ fail:
  * returns 0 on failure
  */
 int check_extensions(STREAMFILE *streamFile, const char * cmp_exts) {
-    char filename[PATH_LIMIT];
-    const char * ext = NULL;
-    const char * cmp_ext = NULL;
-    const char * ststr_res = NULL;
-    size_t ext_len, cmp_len;
+    const STREAMFILE_NAME_INFO * info = get_streamfile_name_info(streamFile);
+    const char * cmp_ext = cmp_exts;
 
-    streamFile->get_name(streamFile,filename,sizeof(filename));
-    ext = filename_extension(filename);
-    ext_len = strlen(ext);
+    if (info->ext_size >= sizeof(info->ext))
+        return 0; /* too long to be in any list */
 
-    cmp_ext = cmp_exts;
+    /* compare each listed ext char by char with the (lowercased) one, moving to the next on mismatch */
     do {
-        ststr_res = strstr(cmp_ext, ",");
-        cmp_len = ststr_res == NULL
-                  ? strlen(cmp_ext) /* total length if more not found */
-                  : (intptr_t)ststr_res - (intptr_t)cmp_ext; /* find next ext; ststr_res should always be greater than cmp_ext, resulting in a positive cmp_len */
+        const char * ext = info->ext;
 
-        if (ext_len == cmp_len && strncasecmp(ext,cmp_ext, ext_len) == 0)
+        while (*cmp_ext != ',' && *cmp_ext != '\0' && *ext == tolower((unsigned char)*cmp_ext)) {
+            ext++;
+            cmp_ext++;
+        }
+        if (*ext == '\0' && (*cmp_ext == ',' || *cmp_ext == '\0'))
             return 1;
 
-        cmp_ext = ststr_res;
-        if (cmp_ext != NULL)
-            cmp_ext = cmp_ext + 1; /* skip comma */
-
-    } while (cmp_ext != NULL);
+        while (*cmp_ext != ',' && *cmp_ext != '\0') {
+            cmp_ext++;
+        }
+    } while (*cmp_ext++ != '\0'); /* skip comma */
 
     return 0;
 }
@@ -617,18 +2511,11 @@ int get_streamfile_name(STREAMFILE *streamFile, char * buffer, size_t size) {
     return 1;
 }
 int get_streamfile_path(STREAMFILE *streamFile, char * buffer, size_t size) {
-    const char *path;
+    const STREAMFILE_NAME_INFO * info = get_streamfile_name_info(streamFile);
 
     streamFile->get_name(streamFile,buffer,size);
-
-    path = strrchr(buffer,DIR_SEPARATOR);
-    if (path!=NULL) path = path+1; /* includes "/" */
-
-    if (path) {
-        buffer[path - buffer] = '\0';
-    } else {
-        buffer[0] = '\0';
-    }
+    if (info->path_size < size)
+        buffer[info->path_size] = '\0'; /* includes "/" */
 
     return 1;
 }
@@ -637,3 +2524,37 @@ int get_streamfile_ext(STREAMFILE *streamFile, char * filename, size_t size) {
     strcpy(filename, filename_extension(filename));
     return 1;
 }
+
+/* computes the name parts once, as the name of a STREAMFILE doesn't change */
+const STREAMFILE_NAME_INFO * get_streamfile_name_info(STREAMFILE *streamFile) {
+    STREAMFILE_NAME_INFO * info = &streamFile->name_info;
+
+    if (!info->filled) {
+        char filename[PATH_LIMIT];
+        const char * path;
+        const char * ext;
+        size_t i;
+
+        streamFile->get_name(streamFile,filename,sizeof(filename));
+        info->name_size = strlen(filename);
+
+        path = strrchr(filename,DIR_SEPARATOR);
+        info->path_size = path ? path + 1 - filename : 0;
+
+        ext = filename_extension(filename);
+        info->ext_size = strlen(ext);
+        if (info->ext_size < sizeof(info->ext)) {
+            for (i = 0; i < info->ext_size; i++) {
+                info->ext[i] = tolower((unsigned char)ext[i]);
+            }
+            info->ext[i] = '\0';
+        }
+        else {
+            info->ext[0] = '\0';
+        }
+
+        info->filled = 1;
+    }
+
+    return info;
+}
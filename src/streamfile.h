@@ -42,6 +42,30 @@
 #endif
 #endif
 
+/* I/O counters of a STREAMFILE, to see how much is read (and how) to get the data that is used.
+ * reads/hits/misses/bytes_consumed are about calls made to the STREAMFILE, while seeks/bytes_fetched/errors
+ * are about reads done on the actual file, so STREAMFILEs that wrap another report its counters for those. */
+typedef struct {
+    uint64_t reads;             /* read/borrow calls */
+    uint64_t hits;              /* calls served from buffered/mapped data */
+    uint64_t misses;            /* buffer refills (a big read may need a few) */
+    uint64_t seeks;             /* refills that don't continue where the last one ended */
+    uint64_t bytes_fetched;     /* bytes read from the file into buffers */
+    uint64_t bytes_consumed;    /* bytes returned to callers */
+    uint64_t handles;           /* STREAMFILEs counted */
+    uint64_t errors;            /* failed or short reads */
+} STREAMFILE_STATS;
+
+/* Parts of a STREAMFILE's name, so callers checking the extension (every meta) don't need to copy
+ * and parse the full name each time. Same rules as filename_extension: extension is after the last dot. */
+typedef struct {
+    int filled;                 /* set once computed */
+    size_t name_size;           /* full name length */
+    size_t path_size;           /* directory length, including the last separator (0 if none) */
+    size_t ext_size;            /* extension length (0 if none) */
+    char ext[0x20];             /* extension in lowercase (empty if it doesn't fit) */
+} STREAMFILE_NAME_INFO;
+
 /* struct representing a file with callbacks. Code should use STREAMFILEs and not std C functions
  * to do file operations, as plugins may need to provide their own callbacks. */
 typedef struct _STREAMFILE {
@@ -55,16 +79,21 @@ typedef struct _STREAMFILE {
     struct _STREAMFILE * (*open)(struct _STREAMFILE *,const char * const filename,size_t buffersize);
     void (*close)(struct _STREAMFILE *);
 
-#ifdef PROFILE_STREAMFILE
-    size_t (*get_bytes_read)(struct _STREAMFILE *);
-    int (*get_error_count)(struct _STREAMFILE *);
-#endif
+    /* Optional (may be NULL): points data to the STREAMFILE's own copy of the bytes at offset (already
+     * buffered/mapped, or after refilling its buffer), returning how many are valid there, or 0 if it can't.
+     * Data is read-only and valid until the next call to the STREAMFILE. */
+    size_t (*borrow)(struct _STREAMFILE *,const uint8_t ** data,off_t offset,size_t length);
 
+    /* Optional (may be NULL): adds the STREAMFILE's I/O counters to stats. */
+    void (*get_stats)(struct _STREAMFILE *,STREAMFILE_STATS * stats);
 
     /* Substream selection for files with multiple streams. Manually used in metas if supported.
      * Not ideal here, but it's the simplest way to pass to all init_vgmstream_x functions. */
     int stream_index; /* 0=default/auto (first), 1=first, N=Nth */
 
+    /* Name parts, computed on first use by get_streamfile_name_info (must start zeroed). */
+    STREAMFILE_NAME_INFO name_info;
+
 } STREAMFILE;
 
 /* create a STREAMFILE from path */
@@ -73,6 +102,48 @@ STREAMFILE * open_stdio_streamfile(const char * filename);
 /* create a STREAMFILE from pre-opened file path */
 STREAMFILE * open_stdio_streamfile_by_file(FILE * file, const char * filename);
 
+/* create a STREAMFILE from path that maps the whole file in memory (shared by all
+ * STREAMFILEs opened on the same name), or a stdio STREAMFILE if it can't be mapped.
+ * The file shouldn't be truncated while in use. */
+STREAMFILE * open_mmap_streamfile(const char * filename);
+
+/* create a STREAMFILE that reads from a buffer already in memory (not copied, so it must stay valid
+ * until all STREAMFILEs opened from it are closed). Opening the same name returns another view
+ * of the buffer, other names (companion files) are opened from disk. */
+STREAMFILE * open_memory_streamfile(const uint8_t * buf, size_t size, const char * name);
+
+/* create a STREAMFILE that buffers reads of another (now owned by it), for STREAMFILEs that are slow
+ * on many small reads. STREAMFILEs opened from it are buffered too. buffer_size 0 uses the default. */
+STREAMFILE * open_buffer_streamfile(STREAMFILE * streamfile, size_t buffer_size);
+
+/* create a STREAMFILE that caches what's read from another during format detection, so failed probes
+ * don't repeat I/O. streamfile isn't owned and must outlive it. STREAMFILEs opened from it are plain
+ * ones from streamfile, as it's only meant to be used while probing. */
+STREAMFILE * open_probe_streamfile(STREAMFILE * streamfile);
+
+/* create a probe STREAMFILE (as above) for another thread, that also reads the blocks already loaded by
+ * parent_probe (a STREAMFILE from open_probe_streamfile over the same file), so threads share the header.
+ * parent_probe isn't owned and can't be used until this is closed. While *cancel is set (if given) reads
+ * and opens fail, so an init that's no longer needed stops early. */
+STREAMFILE * open_probe_streamfile_shared(STREAMFILE * streamfile, STREAMFILE * parent_probe, const volatile int * cancel);
+
+/* create a buffered STREAMFILE that sees part of another as a separate file called name: size bytes
+ * from offset, or if interleave is set, interleave-sized blocks every stride bytes (one channel of
+ * interleaved data). streamfile isn't owned and must outlive it. Opening the same name returns
+ * another window, other names fail. */
+STREAMFILE * open_window_streamfile(STREAMFILE * streamfile, const char * name, off_t offset, size_t size, size_t interleave, size_t stride);
+
+/* create a STREAMFILE that wraps another (now owned by it) and decrypts size bytes from offset by XORing
+ * them with key (repeated every key_size bytes, key[0] applies at offset). STREAMFILEs opened from it
+ * with the same name are decrypted too. */
+STREAMFILE * open_xor_streamfile(STREAMFILE * streamfile, const uint8_t * key, size_t key_size, off_t offset, size_t size);
+
+/* create a STREAMFILE that wraps another (now owned by it) and reads ahead in a background thread,
+ * guessing the next buffer from the read pattern. STREAMFILEs opened from it are wrapped too, sharing the thread.
+ * Returns NULL on failure (streamfile is left open), or the same streamfile if threads aren't supported
+ * (Windows builds, where it's a no-op). */
+STREAMFILE * open_prefetch_streamfile(STREAMFILE * streamfile);
+
 
 /* close a file, destroy the STREAMFILE object */
 static inline void close_streamfile(STREAMFILE * streamfile) {
@@ -84,29 +155,37 @@ static inline size_t read_streamfile(uint8_t * dest, off_t offset, size_t length
     return streamfile->read(streamfile,dest,offset,length);
 }
 
+/* Gets length bytes at offset, lent by the STREAMFILE if possible (no copy) or else read into buf
+ * (which must fit length). Bytes that can't be read are set to 0xFF, same as read_8bit's -1 on EOF.
+ * Returned data is valid until the next call to the STREAMFILE, meant for decoders reading a frame. */
+static inline const uint8_t * borrow_streamfile(uint8_t * buf, off_t offset, size_t length, STREAMFILE * streamfile) {
+    size_t bytes;
+
+    if (streamfile->borrow) {
+        const uint8_t * data;
+        if (streamfile->borrow(streamfile,&data,offset,length) >= length)
+            return data;
+    }
+
+    bytes = read_streamfile(buf,offset,length,streamfile);
+    if (bytes < length)
+        memset(buf + bytes, 0xFF, length - bytes);
+    return buf;
+}
+
 /* return file size */
 static inline size_t get_streamfile_size(STREAMFILE * streamfile) {
     return streamfile->get_size(streamfile);
 }
 
-#ifdef PROFILE_STREAMFILE
-/* return how many bytes we read into buffers */
-static inline size_t get_streamfile_bytes_read(STREAMFILE * streamfile) {
-    if (streamfile->get_bytes_read)
-        return streamfile->get_bytes_read(streamfile);
+/* adds the STREAMFILE's I/O counters to stats (which should be zeroed before the first call) */
+static inline void get_streamfile_stats(STREAMFILE * streamfile, STREAMFILE_STATS * stats) {
+    if (streamfile->get_stats)
+        streamfile->get_stats(streamfile,stats);
     else
-        return 0;
+        stats->handles++; /* doesn't count anything */
 }
 
-/* return how many times we encountered a read error */
-static inline int get_streamfile_error_count(STREAMFILE * streamfile) {
-    if (streamfile->get_error_count)
-        return streamfile->get_error_count(streamfile);
-    else
-        return 0;
-}
-#endif
-
 /* Sometimes you just need an int, and we're doing the buffering.
 * Note, however, that if these fail to read they'll return -1,
 * so that should not be a valid value or there should be some backup. */
@@ -175,4 +254,5 @@ int find_chunk(STREAMFILE *streamFile, uint32_t chunk_id, off_t start_offset, in
 int get_streamfile_name(STREAMFILE *streamFile, char * buffer, size_t size);
 int get_streamfile_path(STREAMFILE *streamFile, char * buffer, size_t size);
 int get_streamfile_ext(STREAMFILE *streamFile, char * filename, size_t size);
+const STREAMFILE_NAME_INFO * get_streamfile_name_info(STREAMFILE *streamFile);
 #endif
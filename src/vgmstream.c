@@ -5,6 +5,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <ctype.h>
+#if defined(_WIN32) || defined(WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
 #include "vgmstream.h"
 #include "meta/meta.h"
 #include "layout/layout.h"
@@ -15,394 +23,925 @@
  * If a suitable file is found, open it and change opened_stream to a stereo stream. */
 static void try_dual_file_stereo(VGMSTREAM * opened_stream, STREAMFILE *streamFile);
 
+/* Saves the decoder state if checkpoints are enabled and there isn't one near the current sample yet. */
+static void save_vgmstream_checkpoint(VGMSTREAM * vgmstream);
+/* Tells if decoding can restart at any block start (with the layout's block update), to index blocks for seeking. */
+static int is_vgmstream_block_restart(VGMSTREAM * vgmstream);
+
+
+typedef struct {
+    VGMSTREAM * (*init)(STREAMFILE *streamFile);
+    const char * name;
+    const char * extensions; /* same as the init's check_extensions, or NULL if it takes any extension */
+    uint32_t id; /* 32-bit BE value the init requires at 0x00, or 0 if it doesn't check one */
+} init_vgmstream_info;
+
+#define INIT_FCN(fcn)  fcn, #fcn /* plus its name, for profiling */
 
 /*
- * List of functions that will recognize files.
+ * List of functions that will recognize files, in priority order.
+ * Extensions must include every one the init function may accept (more is fine, just slower),
+ * as only inits that list the file's extension (or NULL) are tried. Likewise the id must be
+ * one the init always rejects files without (use 0 if unsure).
+ * Both duplicate the init's own checks, so when changing its check_extensions or header id
+ * update them here too (debug builds log files that an init accepts but the list skips).
  */
-VGMSTREAM * (*init_vgmstream_fcns[])(STREAMFILE *streamFile) = {
-    init_vgmstream_adx,
-    init_vgmstream_brstm,
-	init_vgmstream_bfwav,
-	init_vgmstream_bfstm,
-	init_vgmstream_mca,
-	init_vgmstream_btsnd,
-    init_vgmstream_nds_strm,
-    init_vgmstream_agsc,
-    init_vgmstream_ngc_adpdtk,
-    init_vgmstream_rsf,
-    init_vgmstream_afc,
-    init_vgmstream_ast,
-    init_vgmstream_halpst,
-    init_vgmstream_rs03,
-    init_vgmstream_ngc_dsp_std,
-    init_vgmstream_ngc_mdsp_std,
-	init_vgmstream_ngc_dsp_csmp,
-    init_vgmstream_Cstr,
-    init_vgmstream_gcsw,
-    init_vgmstream_ps2_ads,
-    init_vgmstream_ps2_npsf,
-    init_vgmstream_rwsd,
-    init_vgmstream_cdxa,
-    init_vgmstream_ps2_rxws,
-    init_vgmstream_ps2_rxw,
-    init_vgmstream_ps2_int,
-    init_vgmstream_ngc_dsp_stm,
-    init_vgmstream_ps2_exst,
-    init_vgmstream_ps2_svag,
-    init_vgmstream_ps2_mib,
-    init_vgmstream_ngc_mpdsp,
-    init_vgmstream_ps2_mic,
-    init_vgmstream_ngc_dsp_std_int,
-    init_vgmstream_raw,
-    init_vgmstream_ps2_vag,
-    init_vgmstream_psx_gms,
-    init_vgmstream_ps2_str,
-    init_vgmstream_ps2_ild,
-    init_vgmstream_ps2_pnb,
-    init_vgmstream_xbox_wavm,
-    init_vgmstream_xbox_xwav,
-    init_vgmstream_ngc_str,
-    init_vgmstream_ea_schl,
-    init_vgmstream_caf,
-    init_vgmstream_ps2_vpk,
-    init_vgmstream_genh,
+static const init_vgmstream_info init_vgmstream_fcns[] = {
+    {INIT_FCN(init_vgmstream_adx), "adx", 0},
+    {INIT_FCN(init_vgmstream_brstm), "brstm,brstmspm", 0x5253544D},
+    {INIT_FCN(init_vgmstream_bfwav), "bfwav,fwav,bfwavnsmbu", 0x46574156},
+    {INIT_FCN(init_vgmstream_bfstm), "bfstm", 0x4653544D},
+    {INIT_FCN(init_vgmstream_mca), "mca", 0x4D414450},
+    {INIT_FCN(init_vgmstream_btsnd), "btsnd", 0},
+    {INIT_FCN(init_vgmstream_nds_strm), "strm", 0x5354524D},
+    {INIT_FCN(init_vgmstream_agsc), "agsc", 0x00000001},
+    {INIT_FCN(init_vgmstream_ngc_adpdtk), "dtk,adp", 0},
+    {INIT_FCN(init_vgmstream_rsf), "rsf", 0},
+    {INIT_FCN(init_vgmstream_afc), "afc", 0},
+    {INIT_FCN(init_vgmstream_ast), "ast", 0x5354524D},
+    {INIT_FCN(init_vgmstream_halpst), "hps", 0x2048414C},
+    {INIT_FCN(init_vgmstream_rs03), "dsp", 0x52530003},
+    {INIT_FCN(init_vgmstream_ngc_dsp_std), "dsp", 0},
+    {INIT_FCN(init_vgmstream_ngc_mdsp_std), "dsp,mdsp", 0},
+    {INIT_FCN(init_vgmstream_ngc_dsp_csmp), "csmp", 0},
+    {INIT_FCN(init_vgmstream_Cstr), "dsp", 0x43737472},
+    {INIT_FCN(init_vgmstream_gcsw), "gcw", 0x47435357},
+    {INIT_FCN(init_vgmstream_ps2_ads), "ads,ss2", 0x53536864},
+    {INIT_FCN(init_vgmstream_ps2_npsf), "nps,npsf", 0x4E505346},
+    {INIT_FCN(init_vgmstream_rwsd), "rwsd,rwar,rwav,bcwav,bms", 0},
+    {INIT_FCN(init_vgmstream_cdxa), "xa,str", 0},
+    {INIT_FCN(init_vgmstream_ps2_rxws), "xws,xwb", 0},
+    {INIT_FCN(init_vgmstream_ps2_rxw), "rxw", 0},
+    {INIT_FCN(init_vgmstream_ps2_int), "int,wp2", 0},
+    {INIT_FCN(init_vgmstream_ngc_dsp_stm), "stm,dsp", 0},
+    {INIT_FCN(init_vgmstream_ps2_exst), "sts", 0x45585354},
+    {INIT_FCN(init_vgmstream_ps2_svag), "svag", 0x53766167},
+    {INIT_FCN(init_vgmstream_ps2_mib), "mib,mi4,vb,xag", 0},
+    {INIT_FCN(init_vgmstream_ngc_mpdsp), "mpdsp", 0},
+    {INIT_FCN(init_vgmstream_ps2_mic), "mic", 0x00080000},
+    {INIT_FCN(init_vgmstream_ngc_dsp_std_int), "dsp,mss,gcm", 0},
+    {INIT_FCN(init_vgmstream_raw), "raw", 0},
+    {INIT_FCN(init_vgmstream_ps2_vag), "vag,swag,str", 0},
+    {INIT_FCN(init_vgmstream_psx_gms), "gms", 0},
+    {INIT_FCN(init_vgmstream_ps2_str), "str", 0},
+    {INIT_FCN(init_vgmstream_ps2_ild), "ild", 0x494C4400},
+    {INIT_FCN(init_vgmstream_ps2_pnb), "pnb", 0},
+    {INIT_FCN(init_vgmstream_xbox_wavm), "wavm", 0},
+    {INIT_FCN(init_vgmstream_xbox_xwav), "xwav", 0},
+    {INIT_FCN(init_vgmstream_ngc_str), "str", 0xFAAF0001},
+    {INIT_FCN(init_vgmstream_ea_schl), "str,asf,mus,eam,sng,aud,sx,strm,xa,xsf,exa,stm,ast", 0x5343486C},
+    {INIT_FCN(init_vgmstream_caf), "cfn", 0x43414620},
+    {INIT_FCN(init_vgmstream_ps2_vpk), "vpk", 0x204B5056},
+    {INIT_FCN(init_vgmstream_genh), "genh", 0x47454E48},
 #ifdef VGM_USE_VORBIS
-    init_vgmstream_ogg_vorbis,
-    init_vgmstream_sli_ogg,
-    init_vgmstream_sfl,
+    {INIT_FCN(init_vgmstream_ogg_vorbis), "logg,ogg,um3,kovs", 0},
+    {INIT_FCN(init_vgmstream_sli_ogg), "sli", 0},
+    {INIT_FCN(init_vgmstream_sfl), "sfl", 0x52494646},
 #endif
 #if 0
-	init_vgmstream_mp4_aac,
+    {INIT_FCN(init_vgmstream_mp4_aac), NULL, 0},
 #endif
 #if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
-	init_vgmstream_akb,
-#endif
-    init_vgmstream_sadb,
-    init_vgmstream_ps2_bmdx,
-    init_vgmstream_wsi,
-    init_vgmstream_aifc,
-    init_vgmstream_str_snds,
-    init_vgmstream_ws_aud,
-    init_vgmstream_ahx,
-    init_vgmstream_ivb,
-    init_vgmstream_svs,
-    init_vgmstream_riff,
-    init_vgmstream_rifx,
-    init_vgmstream_pos,
-    init_vgmstream_nwa,
-    init_vgmstream_ea_1snh,
-    init_vgmstream_xss,
-    init_vgmstream_sl3,
-    init_vgmstream_hgc1,
-    init_vgmstream_aus,
-    init_vgmstream_rws,
-    init_vgmstream_fsb,
-    init_vgmstream_fsb4_wav,
-    init_vgmstream_fsb5,
-    init_vgmstream_rwx,
-    init_vgmstream_xwb,
-    init_vgmstream_ps2_xa30,
-    init_vgmstream_musc,
-    init_vgmstream_musx_v004,
-    init_vgmstream_musx_v005,
-    init_vgmstream_musx_v006,
-    init_vgmstream_musx_v010,
-    init_vgmstream_musx_v201,
-    init_vgmstream_leg,
-    init_vgmstream_filp,
-    init_vgmstream_ikm,
-    init_vgmstream_sfs,
-    init_vgmstream_bg00,
-    init_vgmstream_sat_dvi,
-    init_vgmstream_dc_kcey,
-    init_vgmstream_ps2_rstm,
-    init_vgmstream_acm,
-    init_vgmstream_mus_acm,
-    init_vgmstream_ps2_kces,
-    init_vgmstream_ps2_dxh,
-    init_vgmstream_ps2_psh,
-    init_vgmstream_scd_pcm,
-	init_vgmstream_ps2_pcm,
-    init_vgmstream_ps2_rkv,
-    init_vgmstream_ps2_psw,
-    init_vgmstream_ps2_vas,
-    init_vgmstream_ps2_tec,
-    init_vgmstream_ps2_enth,
-    init_vgmstream_sdt,
-    init_vgmstream_aix,
-    init_vgmstream_ngc_tydsp,
-    init_vgmstream_ngc_swd,
-    init_vgmstream_capdsp,
-    init_vgmstream_xbox_wvs,
-    init_vgmstream_ngc_wvs,
-    init_vgmstream_dc_str,
-    init_vgmstream_dc_str_v2,
-    init_vgmstream_xbox_matx,
-    init_vgmstream_de2,
-    init_vgmstream_vs,
-    init_vgmstream_dc_str,
-    init_vgmstream_dc_str_v2,
-    init_vgmstream_xbox_xmu,
-    init_vgmstream_xbox_xvas,
-    init_vgmstream_ngc_bh2pcm,
-    init_vgmstream_sat_sap,
-    init_vgmstream_dc_idvi,
-    init_vgmstream_ps2_rnd,
-    init_vgmstream_wii_idsp,
-    init_vgmstream_kraw,
-    init_vgmstream_ps2_omu,
-    init_vgmstream_ps2_xa2,
+    {INIT_FCN(init_vgmstream_akb), NULL, 0x414B4220},
+#endif
+    {INIT_FCN(init_vgmstream_sadb), "sad", 0x73616462},
+    {INIT_FCN(init_vgmstream_ps2_bmdx), "bmdx", 0x01006408},
+    {INIT_FCN(init_vgmstream_wsi), "wsi", 0},
+    {INIT_FCN(init_vgmstream_aifc), "aifc,afc,aifcl,cbd2,aiff,aif,aiffl", 0},
+    {INIT_FCN(init_vgmstream_str_snds), "str", 0},
+    {INIT_FCN(init_vgmstream_ws_aud), "aud", 0},
+    {INIT_FCN(init_vgmstream_ahx), "ahx", 0},
+    {INIT_FCN(init_vgmstream_ivb), "ivb", 0x42564949},
+    {INIT_FCN(init_vgmstream_svs), "svs", 0x53565300},
+    {INIT_FCN(init_vgmstream_riff), "wav,lwav,da,cd,sgb,med,mwv,sns,at3,rws", 0x52494646},
+    {INIT_FCN(init_vgmstream_rifx), "wav,lwav", 0x52494658},
+    {INIT_FCN(init_vgmstream_pos), "pos", 0},
+    {INIT_FCN(init_vgmstream_nwa), "nwa", 0},
+    {INIT_FCN(init_vgmstream_ea_1snh), "asf,as4,cnk", 0x31534E68},
+    {INIT_FCN(init_vgmstream_xss), "xss", 0},
+    {INIT_FCN(init_vgmstream_sl3), "sl3", 0x534C3300},
+    {INIT_FCN(init_vgmstream_hgc1), "hgc1", 0x68674331},
+    {INIT_FCN(init_vgmstream_aus), "aus", 0x41555320},
+    {INIT_FCN(init_vgmstream_rws), "rws", 0x0D080000},
+    {INIT_FCN(init_vgmstream_fsb), "fsb,wii,bnk", 0},
+    {INIT_FCN(init_vgmstream_fsb4_wav), "fsb,wii,bnk", 0x00574156},
+    {INIT_FCN(init_vgmstream_fsb5), "fsb", 0x46534235},
+    {INIT_FCN(init_vgmstream_rwx), "rwx", 0x52415758},
+    {INIT_FCN(init_vgmstream_xwb), "xwb", 0},
+    {INIT_FCN(init_vgmstream_ps2_xa30), "xa,xa30", 0x58413330},
+    {INIT_FCN(init_vgmstream_musc), "mus,musc", 0x4D555343},
+    {INIT_FCN(init_vgmstream_musx_v004), "musx", 0x4D555358},
+    {INIT_FCN(init_vgmstream_musx_v005), "musx", 0x4D555358},
+    {INIT_FCN(init_vgmstream_musx_v006), "musx", 0x4D555358},
+    {INIT_FCN(init_vgmstream_musx_v010), "musx", 0x4D555358},
+    {INIT_FCN(init_vgmstream_musx_v201), "musx", 0x4D555358},
+    {INIT_FCN(init_vgmstream_leg), "leg", 0},
+    {INIT_FCN(init_vgmstream_filp), "filp", 0x46494C70},
+    {INIT_FCN(init_vgmstream_ikm), "ikm", 0},
+    {INIT_FCN(init_vgmstream_sfs), "sfs", 0x53544552},
+    {INIT_FCN(init_vgmstream_bg00), "bg00", 0x42473030},
+    {INIT_FCN(init_vgmstream_sat_dvi), "pcm,dvi", 0x4456492E},
+    {INIT_FCN(init_vgmstream_dc_kcey), "pcm,kcey", 0x4B434559},
+    {INIT_FCN(init_vgmstream_ps2_rstm), "rstm", 0x5253544D},
+    {INIT_FCN(init_vgmstream_acm), "acm", 0x97280301},
+    {INIT_FCN(init_vgmstream_mus_acm), "mus", 0},
+    {INIT_FCN(init_vgmstream_ps2_kces), "kces,vig", 0x01006408},
+    {INIT_FCN(init_vgmstream_ps2_dxh), "dxh", 0x00445848},
+    {INIT_FCN(init_vgmstream_ps2_psh), "psh", 0},
+    {INIT_FCN(init_vgmstream_scd_pcm), "pcm", 0x00020000},
+    {INIT_FCN(init_vgmstream_ps2_pcm), "pcm", 0},
+    {INIT_FCN(init_vgmstream_ps2_rkv), "rkv", 0},
+    {INIT_FCN(init_vgmstream_ps2_psw), "psw", 0},
+    {INIT_FCN(init_vgmstream_ps2_vas), "vas", 0},
+    {INIT_FCN(init_vgmstream_ps2_tec), "tec", 0},
+    {INIT_FCN(init_vgmstream_ps2_enth), "enth", 0},
+    {INIT_FCN(init_vgmstream_sdt), "sdt", 0},
+    {INIT_FCN(init_vgmstream_aix), "aix", 0x41495846},
+    {INIT_FCN(init_vgmstream_ngc_tydsp), "tydsp", 0},
+    {INIT_FCN(init_vgmstream_ngc_swd), "swd", 0x505346D1},
+    {INIT_FCN(init_vgmstream_capdsp), "capdsp", 0},
+    {INIT_FCN(init_vgmstream_xbox_wvs), "wvs", 0},
+    {INIT_FCN(init_vgmstream_ngc_wvs), "wvs", 0},
+    {INIT_FCN(init_vgmstream_dc_str), "str", 0},
+    {INIT_FCN(init_vgmstream_dc_str_v2), "str", 0x02000000},
+    {INIT_FCN(init_vgmstream_xbox_matx), "matx", 0},
+    {INIT_FCN(init_vgmstream_de2), "de2", 0},
+    {INIT_FCN(init_vgmstream_vs), "vs", 0xC8000000},
+    {INIT_FCN(init_vgmstream_dc_str), "str", 0},
+    {INIT_FCN(init_vgmstream_dc_str_v2), "str", 0x02000000},
+    {INIT_FCN(init_vgmstream_xbox_xmu), "xmu", 0},
+    {INIT_FCN(init_vgmstream_xbox_xvas), "xvas", 0},
+    {INIT_FCN(init_vgmstream_ngc_bh2pcm), "bh2pcm", 0},
+    {INIT_FCN(init_vgmstream_sat_sap), "sap", 0},
+    {INIT_FCN(init_vgmstream_dc_idvi), "dvi,idvi", 0x49445649},
+    {INIT_FCN(init_vgmstream_ps2_rnd), "rnd", 0},
+    {INIT_FCN(init_vgmstream_wii_idsp), "gcm,idsp", 0x49445350},
+    {INIT_FCN(init_vgmstream_kraw), "kraw", 0x6B524157},
+    {INIT_FCN(init_vgmstream_ps2_omu), "omu", 0},
+    {INIT_FCN(init_vgmstream_ps2_xa2), "xa2", 0},
     //init_vgmstream_idsp,
-    init_vgmstream_idsp2,
-    init_vgmstream_idsp3,
-    init_vgmstream_idsp4,
-    init_vgmstream_ngc_ymf,
-    init_vgmstream_sadl,
-    init_vgmstream_ps2_ccc,
-    init_vgmstream_psx_fag,
-    init_vgmstream_ps2_mihb,
-    init_vgmstream_ngc_pdt,
-    init_vgmstream_wii_mus,
-    init_vgmstream_dc_asd,
-    init_vgmstream_naomi_spsd,
-    init_vgmstream_rsd2vag,
-    init_vgmstream_rsd2pcmb,
-    init_vgmstream_rsd2xadp,
-	init_vgmstream_rsd3vag,
-	init_vgmstream_rsd3gadp,
-    init_vgmstream_rsd3pcm,
-	init_vgmstream_rsd3pcmb,
-    init_vgmstream_rsd4pcmb,
-    init_vgmstream_rsd4pcm,
-	init_vgmstream_rsd4radp,
-    init_vgmstream_rsd4vag,
-    init_vgmstream_rsd6vag,
-    init_vgmstream_rsd6wadp,
-    init_vgmstream_rsd6xadp,
-    init_vgmstream_rsd6radp,
-    init_vgmstream_bgw,
-    init_vgmstream_spw,
-    init_vgmstream_ps2_ass,
-    init_vgmstream_waa_wac_wad_wam,
-    init_vgmstream_seg,
-    init_vgmstream_nds_strm_ffta2,
-    init_vgmstream_str_asr,
-    init_vgmstream_zwdsp,
-    init_vgmstream_gca,
-    init_vgmstream_spt_spd,
-    init_vgmstream_ish_isd,
-    init_vgmstream_gsp_gsb,
-    init_vgmstream_ydsp,
-    init_vgmstream_msvp,
-    init_vgmstream_ngc_ssm,
-    init_vgmstream_ps2_joe,
-    init_vgmstream_vgs,
-    init_vgmstream_dc_dcsw_dcs,
-    init_vgmstream_wii_smp,
-    init_vgmstream_emff_ps2,
-    init_vgmstream_emff_ngc,
-    init_vgmstream_thp,
-    init_vgmstream_wii_sts,
-    init_vgmstream_ps2_p2bt,
-    init_vgmstream_ps2_gbts,
-    init_vgmstream_wii_sng,
-    init_vgmstream_ngc_dsp_iadp,
-    init_vgmstream_aax,
-    init_vgmstream_utf_dsp,
-    init_vgmstream_ngc_ffcc_str,
-    init_vgmstream_sat_baka,
-    init_vgmstream_nds_swav,
-    init_vgmstream_ps2_vsf,
-    init_vgmstream_nds_rrds,
-    init_vgmstream_ps2_tk5,
-    init_vgmstream_ps2_vsf_tta,
-    init_vgmstream_ads,
-    init_vgmstream_wii_str,
-    init_vgmstream_ps2_mcg,
-    init_vgmstream_zsd,
-    init_vgmstream_ps2_vgs,
-    init_vgmstream_RedSpark,
-    init_vgmstream_ivaud,
-    init_vgmstream_wii_wsd,
-    init_vgmstream_wii_ndp,
-    init_vgmstream_ps2_sps,
-    init_vgmstream_ps2_xa2_rrp,
-    init_vgmstream_nds_hwas,
-	init_vgmstream_ngc_lps,
-    init_vgmstream_ps2_snd,
-    init_vgmstream_naomi_adpcm,
-	init_vgmstream_sd9,
-	init_vgmstream_2dx9,
-	init_vgmstream_dsp_ygo,
-    init_vgmstream_ps2_vgv,
-    init_vgmstream_ngc_gcub,
-    init_vgmstream_maxis_xa,
-    init_vgmstream_ngc_sck_dsp,
-    init_vgmstream_apple_caff,
-	init_vgmstream_pc_mxst,
-	init_vgmstream_sab,
-    init_vgmstream_exakt_sc,
-    init_vgmstream_wii_bns,
-    init_vgmstream_wii_was,
-    init_vgmstream_pona_3do,
-    init_vgmstream_pona_psx,
-    init_vgmstream_xbox_hlwav,
-    init_vgmstream_stx,
-    init_vgmstream_myspd,
-    init_vgmstream_his,
-	init_vgmstream_ps2_ast,
-	init_vgmstream_dmsg,
-    init_vgmstream_ngc_dsp_aaap,
-    init_vgmstream_ngc_dsp_konami,
-    init_vgmstream_ps2_ster,
-    init_vgmstream_ps2_wb,
-    init_vgmstream_bnsf,
-    init_vgmstream_s14_sss,
-    init_vgmstream_ps2_gcm,
-    init_vgmstream_ps2_smpl,
-    init_vgmstream_ps2_msa,
-    init_vgmstream_ps2_voi,
-    init_vgmstream_ps2_khv,
-    init_vgmstream_pc_smp,
-    init_vgmstream_ngc_bo2,
-    init_vgmstream_dsp_ddsp,
-    init_vgmstream_p3d,
-	init_vgmstream_ps2_tk1,
-	init_vgmstream_ps2_adsc,
-    init_vgmstream_ngc_dsp_mpds,
-    init_vgmstream_dsp_str_ig,
-    init_vgmstream_psx_mgav,
-    init_vgmstream_ngc_dsp_sth_str1,
-    init_vgmstream_ngc_dsp_sth_str2,
-    init_vgmstream_ngc_dsp_sth_str3,
-    init_vgmstream_ps2_b1s,
-    init_vgmstream_ps2_wad,
-    init_vgmstream_dsp_xiii,
-    init_vgmstream_dsp_cabelas,
-    init_vgmstream_ps2_adm,
-	init_vgmstream_ps2_lpcm,
-    init_vgmstream_dsp_bdsp,
-	init_vgmstream_ps2_vms,
-	init_vgmstream_xau,
-    init_vgmstream_gh3_bar,
-    init_vgmstream_ffw,
-    init_vgmstream_dsp_dspw,
-    init_vgmstream_ps2_jstm,
-    init_vgmstream_xvag,
-	init_vgmstream_ps3_cps,
-    init_vgmstream_sqex_scd,
-    init_vgmstream_ngc_nst_dsp,
-    init_vgmstream_baf,
-    init_vgmstream_ps3_msf,
-	init_vgmstream_nub_vag,
-	init_vgmstream_ps3_past,
-    init_vgmstream_sgxd,
-	init_vgmstream_ngca,
-	init_vgmstream_wii_ras,
-	init_vgmstream_ps2_spm,
-	init_vgmstream_x360_tra,
-	init_vgmstream_ps2_iab,
-	init_vgmstream_ps2_strlr,
-    init_vgmstream_lsf_n1nj4n,
-	init_vgmstream_vawx,
-    init_vgmstream_pc_snds,
-	init_vgmstream_ps2_wmus,
-	init_vgmstream_hyperscan_kvag,
-	init_vgmstream_ios_psnd,
-	init_vgmstream_pc_adp_bos,
-	init_vgmstream_pc_adp_otns,
-    init_vgmstream_eb_sfx,
-    init_vgmstream_eb_sf0,
-	init_vgmstream_ps3_klbs,
-    init_vgmstream_ps2_mtaf,
-	init_vgmstream_tun,
-	init_vgmstream_wpd,
-	init_vgmstream_mn_str,
-	init_vgmstream_mss,
-	init_vgmstream_ps2_hsf,
-	init_vgmstream_ps3_ivag,
-	init_vgmstream_ps2_2pfs,
-    init_vgmstream_xnbm,
-	init_vgmstream_rsd6oogv,
-	init_vgmstream_ubi_ckd,
-	init_vgmstream_ps2_vbk,
-	init_vgmstream_otm,
-	init_vgmstream_bcstm,
-	init_vgmstream_3ds_idsp,
-    init_vgmstream_kt_g1l,
-    init_vgmstream_kt_wiibgm,
-    init_vgmstream_hca,
-    init_vgmstream_ps2_svag_snk,
-    init_vgmstream_ps2_vds_vdm,
-    init_vgmstream_x360_cxs,
-    init_vgmstream_dsp_adx,
-    init_vgmstream_akb_multi,
-    init_vgmstream_akb2_multi,
+    {INIT_FCN(init_vgmstream_idsp2), "idsp", 0x69647370},
+    {INIT_FCN(init_vgmstream_idsp3), "idsp", 0x49445350},
+    {INIT_FCN(init_vgmstream_idsp4), "idsp", 0x49445350},
+    {INIT_FCN(init_vgmstream_ngc_ymf), "ymf", 0x00000180},
+    {INIT_FCN(init_vgmstream_sadl), "sad", 0x7361646C},
+    {INIT_FCN(init_vgmstream_ps2_ccc), "ccc", 0x01000000},
+    {INIT_FCN(init_vgmstream_psx_fag), "fag", 0x01000000},
+    {INIT_FCN(init_vgmstream_ps2_mihb), "mihb", 0x40000000},
+    {INIT_FCN(init_vgmstream_ngc_pdt), "pdt", 0x50445420},
+    {INIT_FCN(init_vgmstream_wii_mus), "mus", 0},
+    {INIT_FCN(init_vgmstream_dc_asd), "asd", 0},
+    {INIT_FCN(init_vgmstream_naomi_spsd), "spsd", 0x53505344},
+    {INIT_FCN(init_vgmstream_rsd2vag), "rsd", 0x52534432},
+    {INIT_FCN(init_vgmstream_rsd2pcmb), "rsd", 0x52534432},
+    {INIT_FCN(init_vgmstream_rsd2xadp), "rsd", 0x52534432},
+    {INIT_FCN(init_vgmstream_rsd3vag), "rsd", 0x52534433},
+    {INIT_FCN(init_vgmstream_rsd3gadp), "rsd", 0x52534433},
+    {INIT_FCN(init_vgmstream_rsd3pcm), "rsd", 0x52534433},
+    {INIT_FCN(init_vgmstream_rsd3pcmb), "rsd", 0x52534433},
+    {INIT_FCN(init_vgmstream_rsd4pcmb), "rsd", 0x52534434},
+    {INIT_FCN(init_vgmstream_rsd4pcm), "rsd", 0x52534434},
+    {INIT_FCN(init_vgmstream_rsd4radp), "rsd", 0x52534434},
+    {INIT_FCN(init_vgmstream_rsd4vag), "rsd", 0x52534434},
+    {INIT_FCN(init_vgmstream_rsd6vag), "rsd", 0x52534436},
+    {INIT_FCN(init_vgmstream_rsd6wadp), "rsd", 0x52534436},
+    {INIT_FCN(init_vgmstream_rsd6xadp), "rsd", 0x52534436},
+    {INIT_FCN(init_vgmstream_rsd6radp), "rsd", 0x52534436},
+    {INIT_FCN(init_vgmstream_bgw), "bgw", 0x42474D53},
+    {INIT_FCN(init_vgmstream_spw), "spw", 0x53655761},
+    {INIT_FCN(init_vgmstream_ps2_ass), "ass", 0x02000000},
+    {INIT_FCN(init_vgmstream_waa_wac_wad_wam), "waa,wac,wad,wam", 0x52494646},
+    {INIT_FCN(init_vgmstream_seg), "seg", 0x73656700},
+    {INIT_FCN(init_vgmstream_nds_strm_ffta2), "strm", 0x52494646},
+    {INIT_FCN(init_vgmstream_str_asr), "str,asr", 0},
+    {INIT_FCN(init_vgmstream_zwdsp), "zwdsp", 0},
+    {INIT_FCN(init_vgmstream_gca), "gca", 0x47434131},
+    {INIT_FCN(init_vgmstream_spt_spd), "spd", 0},
+    {INIT_FCN(init_vgmstream_ish_isd), "isd", 0},
+    {INIT_FCN(init_vgmstream_gsp_gsb), "gsb", 0},
+    {INIT_FCN(init_vgmstream_ydsp), "ydsp", 0x59445350},
+    {INIT_FCN(init_vgmstream_msvp), "msvp", 0x4D535670},
+    {INIT_FCN(init_vgmstream_ngc_ssm), "ssm", 0},
+    {INIT_FCN(init_vgmstream_ps2_joe), "joe", 0},
+    {INIT_FCN(init_vgmstream_vgs), "vgs", 0x56675321},
+    {INIT_FCN(init_vgmstream_dc_dcsw_dcs), "dcs", 0},
+    {INIT_FCN(init_vgmstream_wii_smp), "smp", 0x05000000},
+    {INIT_FCN(init_vgmstream_emff_ps2), "emff", 0},
+    {INIT_FCN(init_vgmstream_emff_ngc), "emff", 0},
+    {INIT_FCN(init_vgmstream_thp), "thp,dsp", 0x54485000},
+    {INIT_FCN(init_vgmstream_wii_sts), "sts", 0},
+    {INIT_FCN(init_vgmstream_ps2_p2bt), "p2bt", 0},
+    {INIT_FCN(init_vgmstream_ps2_gbts), "gbts", 0},
+    {INIT_FCN(init_vgmstream_wii_sng), "sng", 0x30545352},
+    {INIT_FCN(init_vgmstream_ngc_dsp_iadp), "iadp", 0x69616470},
+    {INIT_FCN(init_vgmstream_aax), "aax", 0},
+    {INIT_FCN(init_vgmstream_utf_dsp), NULL, 0},
+    {INIT_FCN(init_vgmstream_ngc_ffcc_str), "str", 0x53545200},
+    {INIT_FCN(init_vgmstream_sat_baka), "baka", 0},
+    {INIT_FCN(init_vgmstream_nds_swav), "swav", 0x53574156},
+    {INIT_FCN(init_vgmstream_ps2_vsf), "vsf", 0x56534600},
+    {INIT_FCN(init_vgmstream_nds_rrds), "rrds", 0},
+    {INIT_FCN(init_vgmstream_ps2_tk5), "tk5", 0x544B3553},
+    {INIT_FCN(init_vgmstream_ps2_vsf_tta), "vsf", 0x534D5353},
+    {INIT_FCN(init_vgmstream_ads), "ads", 0x64685353},
+    {INIT_FCN(init_vgmstream_wii_str), "str", 0},
+    {INIT_FCN(init_vgmstream_ps2_mcg), "mcg", 0},
+    {INIT_FCN(init_vgmstream_zsd), "zsd", 0x5A534400},
+    {INIT_FCN(init_vgmstream_ps2_vgs), "vgs", 0x56475300},
+    {INIT_FCN(init_vgmstream_RedSpark), "rsd", 0},
+    {INIT_FCN(init_vgmstream_ivaud), "ivaud", 0},
+    {INIT_FCN(init_vgmstream_wii_wsd), "wsd", 0},
+    {INIT_FCN(init_vgmstream_wii_ndp), "ndp", 0x4E445000},
+    {INIT_FCN(init_vgmstream_ps2_sps), "sps", 0},
+    {INIT_FCN(init_vgmstream_ps2_xa2_rrp), "xa2", 0},
+    {INIT_FCN(init_vgmstream_nds_hwas), "hwas", 0x73617768},
+    {INIT_FCN(init_vgmstream_ngc_lps), "lps", 0},
+    {INIT_FCN(init_vgmstream_ps2_snd), "snd", 0x53534E44},
+    {INIT_FCN(init_vgmstream_naomi_adpcm), "adpcm", 0},
+    {INIT_FCN(init_vgmstream_sd9), "sd9", 0x53443900},
+    {INIT_FCN(init_vgmstream_2dx9), "2dx9", 0x32445839},
+    {INIT_FCN(init_vgmstream_dsp_ygo), "dsp", 0},
+    {INIT_FCN(init_vgmstream_ps2_vgv), "vgv", 0},
+    {INIT_FCN(init_vgmstream_ngc_gcub), "gcub", 0x47437562},
+    {INIT_FCN(init_vgmstream_maxis_xa), "xa", 0},
+    {INIT_FCN(init_vgmstream_ngc_sck_dsp), "sck", 0},
+    {INIT_FCN(init_vgmstream_apple_caff), "caf", 0x63616666},
+    {INIT_FCN(init_vgmstream_pc_mxst), "mxst", 0},
+    {INIT_FCN(init_vgmstream_sab), "sab", 0},
+    {INIT_FCN(init_vgmstream_exakt_sc), "sc", 0},
+    {INIT_FCN(init_vgmstream_wii_bns), "bns", 0},
+    {INIT_FCN(init_vgmstream_wii_was), "dsp,isws,was", 0x69535753},
+    {INIT_FCN(init_vgmstream_pona_3do), "pona", 0x13020000},
+    {INIT_FCN(init_vgmstream_pona_psx), "pona", 0x00000800},
+    {INIT_FCN(init_vgmstream_xbox_hlwav), "hlwav", 0x14000000},
+    {INIT_FCN(init_vgmstream_stx), "stx", 0},
+    {INIT_FCN(init_vgmstream_myspd), "myspd", 0},
+    {INIT_FCN(init_vgmstream_his), "his", 0},
+    {INIT_FCN(init_vgmstream_ps2_ast), "ast", 0x41535400},
+    {INIT_FCN(init_vgmstream_dmsg), "dmsg", 0x52494646},
+    {INIT_FCN(init_vgmstream_ngc_dsp_aaap), "dsp", 0x41414170},
+    {INIT_FCN(init_vgmstream_ngc_dsp_konami), "dsp", 0},
+    {INIT_FCN(init_vgmstream_ps2_ster), "ster", 0x53544552},
+    {INIT_FCN(init_vgmstream_ps2_wb), "wb", 0},
+    {INIT_FCN(init_vgmstream_bnsf), "bnsf", 0x424E5346},
+    {INIT_FCN(init_vgmstream_s14_sss), "sss,s14", 0},
+    {INIT_FCN(init_vgmstream_ps2_gcm), "gcm", 0x4D434700},
+    {INIT_FCN(init_vgmstream_ps2_smpl), "smpl", 0x534D504C},
+    {INIT_FCN(init_vgmstream_ps2_msa), "msa", 0},
+    {INIT_FCN(init_vgmstream_ps2_voi), "voi", 0},
+    {INIT_FCN(init_vgmstream_ps2_khv), "khv", 0x56414770},
+    {INIT_FCN(init_vgmstream_pc_smp), "smp", 0},
+    {INIT_FCN(init_vgmstream_ngc_bo2), "bo2", 0},
+    {INIT_FCN(init_vgmstream_dsp_ddsp), "ddsp", 0},
+    {INIT_FCN(init_vgmstream_p3d), "p3d", 0},
+    {INIT_FCN(init_vgmstream_ps2_tk1), "tk1", 0x544B3553},
+    {INIT_FCN(init_vgmstream_ps2_adsc), "ads", 0x41445343},
+    {INIT_FCN(init_vgmstream_ngc_dsp_mpds), "dsp,mds", 0x4D504453},
+    {INIT_FCN(init_vgmstream_dsp_str_ig), "str", 0},
+    {INIT_FCN(init_vgmstream_psx_mgav), "str", 0x52565753},
+    {INIT_FCN(init_vgmstream_ngc_dsp_sth_str1), "sth", 0},
+    {INIT_FCN(init_vgmstream_ngc_dsp_sth_str2), "sth", 0},
+    {INIT_FCN(init_vgmstream_ngc_dsp_sth_str3), "sth", 0},
+    {INIT_FCN(init_vgmstream_ps2_b1s), "b1s", 0},
+    {INIT_FCN(init_vgmstream_ps2_wad), "wad", 0},
+    {INIT_FCN(init_vgmstream_dsp_xiii), "dsp", 0},
+    {INIT_FCN(init_vgmstream_dsp_cabelas), "dsp", 0},
+    {INIT_FCN(init_vgmstream_ps2_adm), "adm", 0},
+    {INIT_FCN(init_vgmstream_ps2_lpcm), "lpcm", 0x4C50434D},
+    {INIT_FCN(init_vgmstream_dsp_bdsp), "bdsp", 0},
+    {INIT_FCN(init_vgmstream_ps2_vms), "vms", 0x564D5320},
+    {INIT_FCN(init_vgmstream_xau), "xau", 0x58415500},
+    {INIT_FCN(init_vgmstream_gh3_bar), "bar", 0},
+    {INIT_FCN(init_vgmstream_ffw), "ffw", 0},
+    {INIT_FCN(init_vgmstream_dsp_dspw), "dspw", 0x44535057},
+    {INIT_FCN(init_vgmstream_ps2_jstm), "stm,jstm", 0x4A53544D},
+    {INIT_FCN(init_vgmstream_xvag), "xvag", 0x58564147},
+    {INIT_FCN(init_vgmstream_ps3_cps), "cps", 0x43505320},
+    {INIT_FCN(init_vgmstream_sqex_scd), "scd", 0x53454442},
+    {INIT_FCN(init_vgmstream_ngc_nst_dsp), "dsp", 0},
+    {INIT_FCN(init_vgmstream_baf), "baf", 0x57415645},
+    {INIT_FCN(init_vgmstream_ps3_msf), "msf,at3", 0},
+    {INIT_FCN(init_vgmstream_nub_vag), "vag", 0x76616700},
+    {INIT_FCN(init_vgmstream_ps3_past), "past", 0x534E4450},
+    {INIT_FCN(init_vgmstream_sgxd), "sgx,sgd,sgb", 0},
+    {INIT_FCN(init_vgmstream_ngca), "ngca", 0x4E474341},
+    {INIT_FCN(init_vgmstream_wii_ras), "ras", 0x5241535F},
+    {INIT_FCN(init_vgmstream_ps2_spm), "spm", 0x53504D00},
+    {INIT_FCN(init_vgmstream_x360_tra), "tra", 0},
+    {INIT_FCN(init_vgmstream_ps2_iab), "iab", 0x10000000},
+    {INIT_FCN(init_vgmstream_ps2_strlr), "str", 0},
+    {INIT_FCN(init_vgmstream_lsf_n1nj4n), "lsf", 0x216E316E},
+    {INIT_FCN(init_vgmstream_vawx), "vawx,xwv", 0x56415758},
+    {INIT_FCN(init_vgmstream_pc_snds), "snds", 0},
+    {INIT_FCN(init_vgmstream_ps2_wmus), "wmus", 0},
+    {INIT_FCN(init_vgmstream_hyperscan_kvag), "bvg", 0x4B564147},
+    {INIT_FCN(init_vgmstream_ios_psnd), "psnd", 0x50534E44},
+    {INIT_FCN(init_vgmstream_pc_adp_bos), "adp", 0x41445021},
+    {INIT_FCN(init_vgmstream_pc_adp_otns), "adp", 0},
+    {INIT_FCN(init_vgmstream_eb_sfx), "sfx,sf0", 0},
+    {INIT_FCN(init_vgmstream_eb_sf0), "sf0", 0},
+    {INIT_FCN(init_vgmstream_ps3_klbs), "bnk", 0},
+    {INIT_FCN(init_vgmstream_ps2_mtaf), "mtaf", 0x4D544146},
+    {INIT_FCN(init_vgmstream_tun), "tun", 0x414C5020},
+    {INIT_FCN(init_vgmstream_wpd), "wpd", 0x20445057},
+    {INIT_FCN(init_vgmstream_mn_str), "mnstr", 0},
+    {INIT_FCN(init_vgmstream_mss), "mss", 0x4D435353},
+    {INIT_FCN(init_vgmstream_ps2_hsf), "hsf", 0x48534600},
+    {INIT_FCN(init_vgmstream_ps3_ivag), "ivag", 0x49564147},
+    {INIT_FCN(init_vgmstream_ps2_2pfs), "2pfs,sap", 0x32504653},
+    {INIT_FCN(init_vgmstream_xnbm), "xnb", 0},
+    {INIT_FCN(init_vgmstream_rsd6oogv), "rsd", 0},
+    {INIT_FCN(init_vgmstream_ubi_ckd), "ckd", 0x52494646},
+    {INIT_FCN(init_vgmstream_ps2_vbk), "vbk", 0x2E56424B},
+    {INIT_FCN(init_vgmstream_otm), "otm", 0},
+    {INIT_FCN(init_vgmstream_bcstm), "bcstm", 0x4353544D},
+    {INIT_FCN(init_vgmstream_3ds_idsp), NULL, 0},
+    {INIT_FCN(init_vgmstream_kt_g1l), "g1l", 0},
+    {INIT_FCN(init_vgmstream_kt_wiibgm), "g1l,dsp", 0},
+    {INIT_FCN(init_vgmstream_hca), "hca", 0},
+    {INIT_FCN(init_vgmstream_ps2_svag_snk), "svag", 0x5641476D},
+    {INIT_FCN(init_vgmstream_ps2_vds_vdm), "vds,vdm", 0},
+    {INIT_FCN(init_vgmstream_x360_cxs), "cxs", 0x43585320},
+    {INIT_FCN(init_vgmstream_dsp_adx), "adx", 0x02000000},
+    {INIT_FCN(init_vgmstream_akb_multi), "akb", 0x414B4220},
+    {INIT_FCN(init_vgmstream_akb2_multi), "akb", 0x414B4232},
 #ifdef VGM_USE_FFMPEG
-    init_vgmstream_mp4_aac_ffmpeg,
-#endif
-    init_vgmstream_bik,
-    init_vgmstream_x360_ast,
-    init_vgmstream_wwise,
-    init_vgmstream_ubi_raki,
-    init_vgmstream_x360_pasx,
-    init_vgmstream_nub_xma,
-    init_vgmstream_xma,
-    init_vgmstream_sxd,
-    init_vgmstream_ogl,
-    init_vgmstream_mc3,
-    init_vgmstream_gtd,
-    init_vgmstream_rsd6xma,
-    init_vgmstream_ta_aac_x360,
-    init_vgmstream_ta_aac_ps3,
-    init_vgmstream_ps3_mta2,
-    init_vgmstream_ngc_ulw,
-    init_vgmstream_pc_xa30,
-    init_vgmstream_wii_04sw,
-    init_vgmstream_ea_bnk,
-    init_vgmstream_ea_schl_fixed,
-    init_vgmstream_sk_aud,
-    init_vgmstream_stm,
-    init_vgmstream_ea_snu,
-    init_vgmstream_awc,
-    init_vgmstream_nsw_opus,
-    init_vgmstream_pc_al2,
-    init_vgmstream_pc_ast,
-    init_vgmstream_ubi_sb,
-
-    init_vgmstream_txth,  /* should go at the end (lower priority) */
+    {INIT_FCN(init_vgmstream_mp4_aac_ffmpeg), "mp4,m4a,m4v,lmp4,bin", 0},
+#endif
+    {INIT_FCN(init_vgmstream_bik), "bik,bika,bik2,bik2a,bk2,bk2a", 0},
+    {INIT_FCN(init_vgmstream_x360_ast), "ast", 0x41535442},
+    {INIT_FCN(init_vgmstream_wwise), "wem,wav,lwav,ogg,logg,xma", 0},
+    {INIT_FCN(init_vgmstream_ubi_raki), "rak,ckd", 0},
+    {INIT_FCN(init_vgmstream_x360_pasx), "past", 0x50415358},
+    {INIT_FCN(init_vgmstream_nub_xma), "xma", 0x786D6100},
+    {INIT_FCN(init_vgmstream_xma), "xma,xma2,nps,str", 0},
+    {INIT_FCN(init_vgmstream_sxd), "sxd,sxd2", 0},
+    {INIT_FCN(init_vgmstream_ogl), "ogl", 0},
+    {INIT_FCN(init_vgmstream_mc3), "mc3", 0x4D504333},
+    {INIT_FCN(init_vgmstream_gtd), "gtd", 0x47485320},
+    {INIT_FCN(init_vgmstream_rsd6xma), "rsd", 0x52534436},
+    {INIT_FCN(init_vgmstream_ta_aac_x360), "aac,laac,ace", 0x41414320},
+    {INIT_FCN(init_vgmstream_ta_aac_ps3), "aac,laac,ace", 0x41414320},
+    {INIT_FCN(init_vgmstream_ps3_mta2), "mta2,bgm,dbm", 0},
+    {INIT_FCN(init_vgmstream_ngc_ulw), "ulw", 0},
+    {INIT_FCN(init_vgmstream_pc_xa30), "xa,xa30", 0x58413330},
+    {INIT_FCN(init_vgmstream_wii_04sw), "xa,04sw", 0x30345357},
+    {INIT_FCN(init_vgmstream_ea_bnk), "bnk,sdt,mus", 0},
+    {INIT_FCN(init_vgmstream_ea_schl_fixed), "asf", 0x5343486C},
+    {INIT_FCN(init_vgmstream_sk_aud), "aud", 0x11534B10},
+    {INIT_FCN(init_vgmstream_stm), "stm,lstm,stma,amts,ps2stm", 0},
+    {INIT_FCN(init_vgmstream_ea_snu), "snu", 0},
+    {INIT_FCN(init_vgmstream_awc), "awc", 0},
+    {INIT_FCN(init_vgmstream_nsw_opus), "opus", 0},
+    {INIT_FCN(init_vgmstream_pc_al2), "al2", 0},
+    {INIT_FCN(init_vgmstream_pc_ast), "ast", 0x4153544C},
+    {INIT_FCN(init_vgmstream_ubi_sb), "sb0,sb1,sb2,sb3,sb4,sb5,sb6,sb7", 0},
+
+    {INIT_FCN(init_vgmstream_txth), NULL, 0},  /* should go at the end (lower priority) */
 #ifdef VGM_USE_FFMPEG
-    init_vgmstream_ffmpeg, /* should go at the end */
+    {INIT_FCN(init_vgmstream_ffmpeg), NULL, 0}, /* should go at the end */
 #endif
 };
 
 
+#define INIT_VGMSTREAM_FCNS_SIZE  (sizeof(init_vgmstream_fcns)/sizeof(init_vgmstream_fcns[0]))
+#define INIT_VGMSTREAM_EXT_MAX    32 /* bigger than any listed extension */
+
+/* extension to init functions index, so opening a file only tries the few inits that may accept it */
+typedef struct {
+    const char * ext;   /* lowercase */
+    int fcn;            /* position in init_vgmstream_fcns */
+} init_vgmstream_ext;
+
+typedef struct {
+    init_vgmstream_ext * exts; /* sorted by ext then fcn */
+    int exts_count;
+    int * any_fcns;             /* inits without extensions, in order */
+    int any_fcns_count;
+    char * ext_names;
+} init_vgmstream_index;
+
+static init_vgmstream_index * volatile fcns_index = NULL; /* built on first use */
+
+static int compare_init_vgmstream_ext(const void * a, const void * b) {
+    const init_vgmstream_ext * ea = a;
+    const init_vgmstream_ext * eb = b;
+    int cmp = strcmp(ea->ext, eb->ext);
+    if (cmp == 0)
+        cmp = ea->fcn - eb->fcn;
+    return cmp;
+}
+
+static void free_init_vgmstream_index(init_vgmstream_index * index) {
+    if (!index) return;
+    free(index->exts);
+    free(index->any_fcns);
+    free(index->ext_names);
+    free(index);
+}
+
+static init_vgmstream_index * build_init_vgmstream_index(void) {
+    init_vgmstream_index * index = NULL;
+    size_t names_size = 0;
+    int i, exts_count = 0, any_count = 0;
+    char * name;
+
+    /* count extensions and total size (each ',' becomes a '\0') */
+    for (i = 0; i < INIT_VGMSTREAM_FCNS_SIZE; i++) {
+        const char * exts = init_vgmstream_fcns[i].extensions;
+        if (!exts) {
+            any_count++;
+            continue;
+        }
+        exts_count++;
+        for (; *exts; exts++) {
+            if (*exts == ',')
+                exts_count++;
+        }
+        names_size += strlen(init_vgmstream_fcns[i].extensions) + 1;
+    }
+
+    index = calloc(1, sizeof(init_vgmstream_index));
+    if (!index) goto fail;
+    index->exts = calloc(exts_count, sizeof(init_vgmstream_ext));
+    index->any_fcns = calloc(any_count, sizeof(int));
+    index->ext_names = calloc(names_size, sizeof(char));
+    if (!index->exts || !index->any_fcns || !index->ext_names) goto fail;
+
+    name = index->ext_names;
+    for (i = 0; i < INIT_VGMSTREAM_FCNS_SIZE; i++) {
+        const char * exts = init_vgmstream_fcns[i].extensions;
+        if (!exts) {
+            index->any_fcns[index->any_fcns_count++] = i;
+            continue;
+        }
+
+        index->exts[index->exts_count].ext = name;
+        index->exts[index->exts_count].fcn = i;
+        index->exts_count++;
+        for (; *exts; exts++) {
+            if (*exts == ',') {
+                *name++ = '\0';
+                index->exts[index->exts_count].ext = name;
+                index->exts[index->exts_count].fcn = i;
+                index->exts_count++;
+            }
+            else {
+                *name++ = tolower((unsigned char)*exts);
+            }
+        }
+        *name++ = '\0';
+    }
+
+    qsort(index->exts, index->exts_count, sizeof(init_vgmstream_ext), compare_init_vgmstream_ext);
+
+    return index;
+fail:
+    free_init_vgmstream_index(index);
+    return NULL;
+}
+
+#if defined(_WIN32) || defined(WIN32)
+static init_vgmstream_index * get_init_vgmstream_index(void) {
+    static volatile LONG building = 0;
+    init_vgmstream_index * index = fcns_index;
+    if (index)
+        return index;
+
+    /* first caller builds it, others just do a full scan meanwhile */
+    if (InterlockedCompareExchange(&building, 1, 0) != 0)
+        return NULL;
+    index = build_init_vgmstream_index();
+    InterlockedExchangePointer((PVOID volatile *)&fcns_index, index);
+    return index;
+}
+#else
+static pthread_once_t fcns_index_once = PTHREAD_ONCE_INIT;
+
+static void init_vgmstream_index_once(void) {
+    fcns_index = build_init_vgmstream_index();
+}
+
+static init_vgmstream_index * get_init_vgmstream_index(void) {
+    pthread_once(&fcns_index_once, init_vgmstream_index_once);
+    return fcns_index;
+}
+#endif
+
+/* Adds an init to the candidate list unless the file's id rules it out (read once, when first needed) */
+static void add_init_vgmstream_candidate(STREAMFILE *streamFile, int * fcns, int * count, int fcn, uint32_t * id, int * id_read) {
+    uint32_t init_id = init_vgmstream_fcns[fcn].id;
+
+    if (*count > 0 && fcns[*count-1] == fcn)
+        return; /* an init may list the same ext twice */
+
+    if (init_id) {
+        if (!*id_read) {
+            *id = (uint32_t)read_32bitBE(0x00,streamFile); /* same as the init would (-1 on EOF) */
+            *id_read = 1;
+        }
+        if (*id != init_id)
+            return;
+    }
+
+    fcns[(*count)++] = fcn;
+}
+
+/* Writes to fcns (in priority order) the inits that may accept the streamFile's extension and id, returns count */
+static int get_init_vgmstream_candidates(STREAMFILE *streamFile, int * fcns) {
+    init_vgmstream_index * index = get_init_vgmstream_index();
+    const STREAMFILE_NAME_INFO * info;
+    uint32_t id = 0;
+    int i, lo, hi, any, id_read = 0, count = 0;
+
+    if (!index) { /* can't happen often, try everything */
+        for (i = 0; i < INIT_VGMSTREAM_FCNS_SIZE; i++) {
+            add_init_vgmstream_candidate(streamFile, fcns, &count, i, &id, &id_read);
+        }
+        return count;
+    }
+
+    info = get_streamfile_name_info(streamFile);
+    if (info->ext_size >= INIT_VGMSTREAM_EXT_MAX || info->ext_size >= sizeof(info->ext)) {
+        lo = hi = 0; /* can't match any listed extension */
+    }
+    else {
+        const char * ext = info->ext; /* lowercase */
+
+        /* find first entry for ext, then all consecutive ones */
+        lo = 0;
+        hi = index->exts_count;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if (strcmp(index->exts[mid].ext, ext) < 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        hi = lo;
+        while (hi < index->exts_count && strcmp(index->exts[hi].ext, ext) == 0) {
+            hi++;
+        }
+    }
+
+    /* merge both lists, keeping the original order */
+    any = 0;
+    while (lo < hi || any < index->any_fcns_count) {
+        int fcn;
+        if (any >= index->any_fcns_count || (lo < hi && index->exts[lo].fcn < index->any_fcns[any]))
+            fcn = index->exts[lo++].fcn;
+        else
+            fcn = index->any_fcns[any++];
+
+        add_init_vgmstream_candidate(streamFile, fcns, &count, fcn, &id, &id_read);
+    }
+
+    return count;
+}
+
+/* finds an init function by name, or -1 if not found */
+static int find_init_vgmstream_fcn(const char * name) {
+    int i;
+
+    for (i = 0; i < INIT_VGMSTREAM_FCNS_SIZE; i++) {
+        if (strcmp(init_vgmstream_fcns[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+/* detection profiling: measures each init call and reports it to the callback */
+typedef struct {
+    vgmstream_probe_callback callback;
+    void * data;
+    STREAMFILE * streamFile;    /* file the inits read */
+    VGMSTREAM_PROBE probe;
+    STREAMFILE_STATS stats;     /* counters when the current init started */
+    double start;
+} init_vgmstream_profiler;
+
+static double get_profiler_time(void) {
+#if defined(_WIN32) || defined(WIN32)
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+static void start_profiler_probe(init_vgmstream_profiler * profiler, int fcn) {
+    if (!profiler) return;
+
+    memset(&profiler->stats,0,sizeof(STREAMFILE_STATS));
+    get_streamfile_stats(profiler->streamFile,&profiler->stats);
+    profiler->probe.name = init_vgmstream_fcns[fcn].name;
+    profiler->start = get_profiler_time();
+}
+
+static void end_profiler_probe(init_vgmstream_profiler * profiler, probe_outcome_t outcome) {
+    STREAMFILE_STATS stats;
+    if (!profiler) return;
+
+    profiler->probe.time = get_profiler_time() - profiler->start;
+    memset(&stats,0,sizeof(STREAMFILE_STATS));
+    get_streamfile_stats(profiler->streamFile,&stats);
+    profiler->probe.outcome = outcome;
+    profiler->probe.reads = stats.reads - profiler->stats.reads;
+    profiler->probe.bytes_read = stats.bytes_consumed - profiler->stats.bytes_consumed;
+    profiler->probe.bytes_fetched = stats.bytes_fetched - profiler->stats.bytes_fetched;
+    profiler->callback(&profiler->probe, profiler->data);
+}
+
+/* these are little hacky checks, returns PROBE_ACCEPTED or why the VGMSTREAM should be discarded */
+static probe_outcome_t check_init_vgmstream(VGMSTREAM * vgmstream) {
+
+    /* fail if there is nothing to play (without this check vgmstream can generate empty files) */
+    if (vgmstream->num_samples <= 0) {
+        VGM_LOG("VGMSTREAM: wrong num_samples (ns=%i / 0x%08x)\n", vgmstream->num_samples, vgmstream->num_samples);
+        return PROBE_BAD_SAMPLES;
+    }
+
+    /* everything should have a reasonable sample rate (a verification of the metadata) */
+    if (!check_sample_rate(vgmstream->sample_rate)) {
+        VGM_LOG("VGMSTREAM: wrong sample rate (sr=%i)\n", vgmstream->sample_rate);
+        return PROBE_BAD_SAMPLE_RATE;
+    }
+
+    return PROBE_ACCEPTED;
+}
+
+#ifdef VGM_DEBUG_OUTPUT
+/* Tries the inits before last_fcn (in priority order) that the extensions/ids skipped, and logs any that accepts
+ * the file, as that means its entry in init_vgmstream_fcns doesn't match its checks. */
+static void check_init_vgmstream_skipped(STREAMFILE *streamFile, const int * fcns, int fcns_size, int last_fcn) {
+    int i, j;
+
+    for (i = 0; i < last_fcn; i++) {
+        VGMSTREAM * vgmstream;
+
+        for (j = 0; j < fcns_size; j++) {
+            if (fcns[j] == i)
+                break;
+        }
+        if (j < fcns_size)
+            continue;
+
+        vgmstream = init_vgmstream_fcns[i].init(streamFile);
+        if (!vgmstream)
+            continue;
+        if (check_init_vgmstream(vgmstream) == PROBE_ACCEPTED)
+            VGM_LOG("VGMSTREAM: %s accepts the file but its extensions/id skip it\n", init_vgmstream_fcns[i].name);
+        close_vgmstream(vgmstream);
+    }
+}
+#endif
+
+static int probe_threads = 0; /* 0/1: try inits one by one */
+
+void vgmstream_set_probe_threads(int threads) {
+    probe_threads = threads;
+}
+
+#if !defined(_WIN32) && !defined(WIN32)
+
+#define PROBE_THREADS_MAX  16
+
+struct init_vgmstream_worker;
+
+/* candidates shared by the probing threads, taken in order */
+typedef struct {
+    const int * fcns;
+    VGMSTREAM ** results;       /* valid VGMSTREAM of each candidate, if any */
+    int next;                   /* next candidate to try */
+    int limit;                  /* first valid candidate found so far, later ones aren't tried */
+    struct init_vgmstream_worker * workers;
+    int workers_count;
+    pthread_mutex_t lock;
+} init_vgmstream_parallel;
+
+typedef struct init_vgmstream_worker {
+    init_vgmstream_parallel * parallel;
+    STREAMFILE * streamFile;    /* this thread's own file handle */
+    STREAMFILE * streamProbe;   /* and probe over it */
+    int current;                /* candidate being tried */
+    volatile int cancel;        /* set when a lower candidate is valid, so the probe fails and the init ends early */
+    pthread_t thread;
+    int thread_started;
+} init_vgmstream_worker;
+
+static void * init_vgmstream_worker_thread(void * arg) {
+    init_vgmstream_worker * worker = arg;
+    init_vgmstream_parallel * parallel = worker->parallel;
+
+    while (1) {
+        VGMSTREAM * vgmstream;
+        int i, limit;
+
+        pthread_mutex_lock(&parallel->lock);
+        i = parallel->next++;
+        limit = parallel->limit;
+        worker->current = i;
+        worker->cancel = 0;
+        pthread_mutex_unlock(&parallel->lock);
+        if (i >= limit)
+            break;
+
+        vgmstream = init_vgmstream_fcns[parallel->fcns[i]].init(worker->streamProbe);
+        if (vgmstream && check_init_vgmstream(vgmstream) != PROBE_ACCEPTED) {
+            close_vgmstream(vgmstream);
+            vgmstream = NULL;
+        }
+
+        if (vgmstream) {
+            int j;
+
+            pthread_mutex_lock(&parallel->lock);
+            parallel->results[i] = vgmstream;
+            if (i < parallel->limit) {
+                parallel->limit = i;
+
+                /* stop inits of later candidates already running (their results are discarded anyway) */
+                for (j = 0; j < parallel->workers_count; j++) {
+                    if (parallel->workers[j].current > i)
+                        parallel->workers[j].cancel = 1;
+                }
+            }
+            pthread_mutex_unlock(&parallel->lock);
+        }
+    }
+
+    return NULL;
+}
+
+/* Tries the candidates in several threads, each with its own file and a probe sharing what streamProbe
+ * has read. Lower candidates are always tried, so the result is the same as trying them one by one, but
+ * once one is valid later ones aren't started. Returns the position of the valid candidate (fcns_size if
+ * none) and sets its VGMSTREAM, or -1 if threads couldn't be used. */
+static int init_vgmstream_parallel_probe(STREAMFILE * streamFile, STREAMFILE * streamProbe, const int * fcns, int fcns_size, VGMSTREAM ** p_vgmstream) {
+    init_vgmstream_parallel parallel;
+    init_vgmstream_worker workers[PROBE_THREADS_MAX];
+    char filename[PATH_LIMIT];
+    uint8_t buf[1];
+    int i, workers_count, position = -1;
+
+    workers_count = probe_threads;
+    if (workers_count > PROBE_THREADS_MAX)
+        workers_count = PROBE_THREADS_MAX;
+    if (workers_count > fcns_size)
+        workers_count = fcns_size;
+    if (workers_count <= 1)
+        return -1;
+
+    memset(&parallel,0,sizeof(init_vgmstream_parallel));
+    memset(workers,0,sizeof(workers));
+    parallel.fcns = fcns;
+    parallel.limit = fcns_size;
+    parallel.workers = workers;
+    parallel.workers_count = workers_count;
+    parallel.results = calloc(fcns_size, sizeof(VGMSTREAM *));
+    if (!parallel.results)
+        return -1;
+    if (pthread_mutex_init(&parallel.lock, NULL) != 0) {
+        free(parallel.results);
+        return -1;
+    }
+
+    /* load the last block too (usually checked), as the shared probe can't be modified while threads run */
+    read_streamfile(buf, get_streamfile_size(streamProbe) - 1, 1, streamProbe);
+
+    streamFile->get_name(streamFile,filename,sizeof(filename));
+    for (i = 0; i < workers_count; i++) {
+        workers[i].parallel = &parallel;
+        workers[i].streamFile = streamFile->open(streamFile,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
+        if (!workers[i].streamFile) goto fail;
+        workers[i].streamFile->stream_index = streamFile->stream_index;
+        workers[i].streamProbe = open_probe_streamfile_shared(workers[i].streamFile, streamProbe, &workers[i].cancel);
+        if (!workers[i].streamProbe) goto fail;
+    }
+
+#ifdef VGM_USE_MPEG
+    /* global inits that aren't thread-safe are done before starting threads */
+    mpeg_init_library();
+#endif
+
+    /* this thread is the first worker */
+    for (i = 1; i < workers_count; i++) {
+        if (pthread_create(&workers[i].thread, NULL, init_vgmstream_worker_thread, &workers[i]) != 0)
+            break; /* the rest will do */
+        workers[i].thread_started = 1;
+    }
+    init_vgmstream_worker_thread(&workers[0]);
+    for (i = 1; i < workers_count; i++) {
+        if (workers[i].thread_started)
+            pthread_join(workers[i].thread, NULL);
+    }
+
+    /* keep the first valid one */
+    *p_vgmstream = NULL;
+    position = fcns_size;
+    for (i = 0; i < fcns_size; i++) {
+        if (!parallel.results[i])
+            continue;
+        if (!*p_vgmstream) {
+            *p_vgmstream = parallel.results[i];
+            position = i;
+        }
+        else {
+            close_vgmstream(parallel.results[i]);
+        }
+    }
+
+fail:
+    for (i = 0; i < workers_count; i++) {
+        if (workers[i].streamProbe) close_streamfile(workers[i].streamProbe);
+        if (workers[i].streamFile) close_streamfile(workers[i].streamFile);
+    }
+    pthread_mutex_destroy(&parallel.lock);
+    free(parallel.results);
+    return position;
+}
+
+#else
+
+/* no threads here (same as STREAMFILE prefetching) */
+static int init_vgmstream_parallel_probe(STREAMFILE * streamFile, STREAMFILE * streamProbe, const int * fcns, int fcns_size, VGMSTREAM ** p_vgmstream) {
+    return -1;
+}
+
+#endif
+
 /* internal version with all parameters */
-static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int do_dfs) {
-    int i, fcns_size;
+static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int do_dfs, vgmstream_probe_callback callback, void * data) {
+    STREAMFILE *streamProbe, *streamInit;
+    init_vgmstream_profiler profiler_data, *profiler = NULL;
+    VGMSTREAM_CACHE_INFO cache_info;
+    char filename[PATH_LIMIT];
+    int fcns[INIT_VGMSTREAM_FCNS_SIZE];
+    VGMSTREAM * vgmstream_found = NULL;
+    int i, fcns_size, cache_fcn = -1;
     
     if (!streamFile)
         return NULL;
 
-    fcns_size = (sizeof(init_vgmstream_fcns)/sizeof(init_vgmstream_fcns[0]));
-    /* try a series of formats, see which works */
-    for (i=0; i < fcns_size; i++) {
-        /* call init function and see if valid VGMSTREAM was returned */
-        VGMSTREAM * vgmstream = (init_vgmstream_fcns[i])(streamFile);
-        if (vgmstream) {
-            /* these are little hacky checks */
+    /* inits re-read the same headers, so cache what's read while probing (the
+     * probe file is only used by the inits, that open their own files to play) */
+    streamProbe = open_probe_streamfile(streamFile);
+    streamInit = streamProbe ? streamProbe : streamFile;
 
-            /* fail if there is nothing to play (without this check vgmstream can generate empty files) */
-            if (vgmstream->num_samples <= 0) {
-                VGM_LOG("VGMSTREAM: wrong num_samples (ns=%i / 0x%08x)\n", vgmstream->num_samples, vgmstream->num_samples);
-                close_vgmstream(vgmstream);
-                continue;
+    if (callback) {
+        memset(&profiler_data,0,sizeof(init_vgmstream_profiler));
+        profiler_data.callback = callback;
+        profiler_data.data = data;
+        profiler_data.streamFile = streamInit;
+        profiler = &profiler_data;
+    }
+
+    fcns_size = get_init_vgmstream_candidates(streamInit, fcns);
+
+    /* try first the format that detected this file last time, if cached */
+    if (do_dfs) {
+        streamFile->get_name(streamFile,filename,sizeof(filename));
+        if (vgmstream_get_cache_info(filename, streamFile->stream_index, &cache_info))
+            cache_fcn = find_init_vgmstream_fcn(cache_info.meta);
+
+        for (i = 0; cache_fcn >= 0 && i < fcns_size; i++) {
+            if (fcns[i] == cache_fcn) {
+                memmove(fcns + 1, fcns, i * sizeof(int));
+                fcns[0] = cache_fcn;
+                break;
             }
+        }
+    }
+
+    /* when allowed, try all at once if there is no better guess (a cached format is likely the one) */
+    i = -1;
+    if (probe_threads > 1 && streamProbe && !profiler && cache_fcn < 0)
+        i = init_vgmstream_parallel_probe(streamFile, streamProbe, fcns, fcns_size, &vgmstream_found);
+    if (i < 0)
+        i = 0;
+
+    /* try a series of formats, see which works */
+    for (; i < fcns_size; i++) {
+        VGMSTREAM * vgmstream;
 
-            /* everything should have a reasonable sample rate (a verification of the metadata) */
-            if (!check_sample_rate(vgmstream->sample_rate)) {
-                VGM_LOG("VGMSTREAM: wrong sample rate (sr=%i)\n", vgmstream->sample_rate);
+        /* call init function and see if valid VGMSTREAM was returned */
+        if (vgmstream_found) { /* already tried */
+            vgmstream = vgmstream_found;
+            vgmstream_found = NULL;
+        }
+        else {
+            start_profiler_probe(profiler, fcns[i]);
+            vgmstream = init_vgmstream_fcns[fcns[i]].init(streamInit);
+        }
+        if (vgmstream) {
+            probe_outcome_t outcome = check_init_vgmstream(vgmstream);
+            if (outcome != PROBE_ACCEPTED) {
                 close_vgmstream(vgmstream);
+                end_profiler_probe(profiler, outcome);
                 continue;
             }
             
@@ -413,8 +952,14 @@ static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int do_dfs) {
                         || (vgmstream->loop_start_sample < 0) ) {
                     vgmstream->loop_flag = 0;
                     VGM_LOG("VGMSTREAM: wrong loops ignored (lss=%i, lse=%i, ns=%i)\n", vgmstream->loop_start_sample, vgmstream->loop_end_sample, vgmstream->num_samples);
+                    end_profiler_probe(profiler, PROBE_BAD_LOOPS);
+                    profiler = NULL;
                 }
             }
+            end_profiler_probe(profiler, PROBE_ACCEPTED);
+#ifdef VGM_DEBUG_OUTPUT
+            check_init_vgmstream_skipped(streamInit, fcns, fcns_size, fcns[i]);
+#endif
 
             /* dual file stereo */
             if (do_dfs && (
@@ -449,16 +994,47 @@ static VGMSTREAM * init_vgmstream_internal(STREAMFILE *streamFile, int do_dfs) {
             /* save info */
             vgmstream->stream_index = streamFile->stream_index;
 
+            /* remember the format for next time */
+            if (do_dfs) {
+                VGMSTREAM_CACHE_INFO info;
+
+                memset(&info,0,sizeof(VGMSTREAM_CACHE_INFO));
+                strncpy(info.meta, init_vgmstream_fcns[fcns[i]].name, sizeof(info.meta)-1);
+                info.stream_index = vgmstream->stream_index;
+                info.num_streams = vgmstream->num_streams;
+                info.channels = vgmstream->channels;
+                info.sample_rate = vgmstream->sample_rate;
+                info.num_samples = vgmstream->num_samples;
+                info.loop_flag = vgmstream->loop_flag;
+                info.loop_start_sample = vgmstream->loop_start_sample;
+                info.loop_end_sample = vgmstream->loop_end_sample;
+
+                if (fcns[i] != cache_fcn || memcmp(&info,&cache_info,sizeof(VGMSTREAM_CACHE_INFO)) != 0)
+                    put_vgmstream_cache_info(filename, &info);
+            }
+
+            /* blocked layouts get indexed while playing if blocks can be decoded on their own */
+            if (is_vgmstream_block_restart(vgmstream)) {
+                vgmstream->block_index = calloc(1, sizeof(vgmstream_block_index));
+            }
+
             /* save start things so we can restart for seeking */
             /* copy the channels */
             memcpy(vgmstream->start_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
             /* copy the whole VGMSTREAM */
             memcpy(vgmstream->start_vgmstream,vgmstream,sizeof(VGMSTREAM));
 
+            if (streamProbe) close_streamfile(streamProbe);
             return vgmstream;
         }
+
+        end_profiler_probe(profiler, PROBE_REJECTED);
     }
+#ifdef VGM_DEBUG_OUTPUT
+    check_init_vgmstream_skipped(streamInit, fcns, fcns_size, INIT_VGMSTREAM_FCNS_SIZE);
+#endif
 
+    if (streamProbe) close_streamfile(streamProbe);
     return NULL;
 }
 
@@ -474,7 +1050,11 @@ VGMSTREAM * init_vgmstream(const char * const filename) {
 }
 
 VGMSTREAM * init_vgmstream_from_STREAMFILE(STREAMFILE *streamFile) {
-    return init_vgmstream_internal(streamFile,1);
+    return init_vgmstream_internal(streamFile,1,NULL,NULL);
+}
+
+VGMSTREAM * init_vgmstream_profile(STREAMFILE *streamFile, vgmstream_probe_callback callback, void * data) {
+    return init_vgmstream_internal(streamFile,1,callback,data);
 }
 
 /* Reset a VGMSTREAM to its state at the start of playback.
@@ -664,6 +1244,93 @@ VGMSTREAM * allocate_vgmstream(int channel_count, int looped) {
     return vgmstream;
 }
 
+static int lazy_samples = 0;
+
+void vgmstream_set_lazy_samples(int enable) {
+    lazy_samples = enable;
+}
+
+/* loop channels for metas that only know if they loop after the update */
+static void allocate_vgmstream_loop_channels(VGMSTREAM * vgmstream) {
+    if (vgmstream->loop_flag && !vgmstream->loop_ch) {
+        vgmstream->loop_ch = calloc(vgmstream->channels,sizeof(VGMSTREAMCHANNEL));
+        if (!vgmstream->loop_ch)
+            vgmstream->loop_flag = 0;
+    }
+}
+
+void set_vgmstream_lazy_samples(VGMSTREAM * vgmstream, STREAMFILE * streamFile, void (*update)(VGMSTREAM *, STREAMFILE *, const void *), const void * config, size_t config_size) {
+    vgmstream_lazy_samples *lazy = NULL;
+    char filename[PATH_LIMIT];
+
+    if (!lazy_samples || vgmstream->lazy_samples)
+        goto update;
+
+    lazy = calloc(1, sizeof(vgmstream_lazy_samples));
+    if (!lazy) goto update;
+
+    /* own file, as the channels' may be closed or replaced by then */
+    streamFile->get_name(streamFile,filename,sizeof(filename));
+    lazy->streamFile = streamFile->open(streamFile,filename,STREAMFILE_DEFAULT_BUFFER_SIZE);
+    if (!lazy->streamFile) goto update;
+    lazy->streamFile->stream_index = streamFile->stream_index;
+
+    lazy->config = malloc(config_size);
+    if (!lazy->config) goto update;
+    memcpy(lazy->config, config, config_size);
+
+    lazy->update = update;
+    vgmstream->lazy_samples = lazy;
+    return;
+
+update:
+    /* not deferred */
+    if (lazy) {
+        if (lazy->streamFile) close_streamfile(lazy->streamFile);
+        free(lazy);
+    }
+    update(vgmstream, streamFile, config);
+    allocate_vgmstream_loop_channels(vgmstream);
+}
+
+static void free_vgmstream_lazy_samples(vgmstream_lazy_samples * lazy) {
+    close_streamfile(lazy->streamFile);
+    free(lazy->config);
+    free(lazy);
+}
+
+void update_vgmstream_samples(VGMSTREAM * vgmstream) {
+    vgmstream_lazy_samples *lazy = vgmstream->lazy_samples;
+    VGMSTREAM * start_vgmstream = vgmstream->start_vgmstream;
+
+    if (!lazy)
+        return;
+
+    lazy->update(vgmstream, lazy->streamFile, lazy->config);
+
+    /* same checks as when opening */
+    if (vgmstream->loop_flag) {
+        if ((vgmstream->loop_end_sample <= vgmstream->loop_start_sample)
+                || (vgmstream->loop_end_sample > vgmstream->num_samples)
+                || (vgmstream->loop_start_sample < 0) ) {
+            vgmstream->loop_flag = 0;
+            VGM_LOG("VGMSTREAM: wrong loops ignored (lss=%i, lse=%i, ns=%i)\n", vgmstream->loop_start_sample, vgmstream->loop_end_sample, vgmstream->num_samples);
+        }
+    }
+    allocate_vgmstream_loop_channels(vgmstream);
+
+    /* resets start from the exact values too */
+    start_vgmstream->num_samples = vgmstream->num_samples;
+    start_vgmstream->loop_flag = vgmstream->loop_flag;
+    start_vgmstream->loop_start_sample = vgmstream->loop_start_sample;
+    start_vgmstream->loop_end_sample = vgmstream->loop_end_sample;
+    start_vgmstream->loop_ch = vgmstream->loop_ch;
+
+    free_vgmstream_lazy_samples(lazy);
+    vgmstream->lazy_samples = NULL;
+    start_vgmstream->lazy_samples = NULL;
+}
+
 void close_vgmstream(VGMSTREAM * vgmstream) {
     if (!vgmstream)
         return;
@@ -860,6 +1527,24 @@ void close_vgmstream(VGMSTREAM * vgmstream) {
         }
     }
 
+    if (vgmstream->checkpoints) {
+        vgmstream_checkpoints *checkpoints = vgmstream->checkpoints;
+        free(checkpoints->samples);
+        free(checkpoints->states);
+        free(checkpoints->channels);
+        free(checkpoints);
+    }
+
+    if (vgmstream->block_index) {
+        vgmstream_block_index *index = vgmstream->block_index;
+        free(index->entries);
+        free(index);
+    }
+
+    if (vgmstream->lazy_samples) {
+        free_vgmstream_lazy_samples(vgmstream->lazy_samples);
+    }
+
     if (vgmstream->loop_ch) free(vgmstream->loop_ch);
     if (vgmstream->start_ch) free(vgmstream->start_ch);
     if (vgmstream->ch) free(vgmstream->ch);
@@ -895,6 +1580,9 @@ int32_t get_vgmstream_play_samples(double looptimes, double fadeseconds, double
 
 /* decode data into sample buffer */
 void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstream) {
+    if (vgmstream->lazy_samples)
+        update_vgmstream_samples(vgmstream);
+
     switch (vgmstream->layout_type) {
         case layout_interleave:
         case layout_interleave_shortblock:
@@ -961,6 +1649,9 @@ void render_vgmstream(sample * buffer, int32_t sample_count, VGMSTREAM * vgmstre
         default:
             break;
     }
+
+    if (vgmstream->checkpoints)
+        save_vgmstream_checkpoint(vgmstream);
 }
 
 /* get the size in samples of a single frame (1 or N channels), for interleaved/blocked layouts */
@@ -977,7 +1668,6 @@ int get_vgmstream_samples_per_frame(VGMSTREAM * vgmstream) {
         case coding_NGC_DSP:
             return 14;
         case coding_PCM16LE:
-        case coding_PCM16LE_XOR_int:
         case coding_PCM16BE:
         case coding_PCM16_int:
         case coding_PCM8:
@@ -1137,7 +1827,6 @@ int get_vgmstream_frame_size(VGMSTREAM * vgmstream) {
         case coding_NGC_DSP:
             return 8;
         case coding_PCM16LE:
-        case coding_PCM16LE_XOR_int:
         case coding_PCM16BE:
         case coding_PCM16_int:
             return 2;
@@ -1323,13 +2012,6 @@ void decode_vgmstream(VGMSTREAM * vgmstream, int samples_written, int samples_to
                         samples_to_do);
             }
             break;
-        case coding_PCM16LE_XOR_int:
-            for (chan=0;chan<vgmstream->channels;chan++) {
-                decode_pcm16LE_XOR_int(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
-                        vgmstream->channels,vgmstream->samples_into_block,
-                        samples_to_do);
-            }
-            break;
         case coding_PCM16BE:
             for (chan=0;chan<vgmstream->channels;chan++) {
                 decode_pcm16BE(&vgmstream->ch[chan],buffer+samples_written*vgmstream->channels+chan,
@@ -1867,6 +2549,94 @@ int vgmstream_samples_to_do(int samples_this_block, int samples_per_frame, VGMST
     return samples_to_do;
 }
 
+static int is_vgmstream_loop_history_kept(VGMSTREAM * vgmstream) {
+    return vgmstream->meta_type == meta_DSP_STD ||
+           vgmstream->meta_type == meta_DSP_RS03 ||
+           vgmstream->meta_type == meta_DSP_CSTR ||
+           vgmstream->coding_type == coding_PSX ||
+           vgmstream->coding_type == coding_PSX_bmdx ||
+           vgmstream->coding_type == coding_PSX_badflags;
+}
+
+/* restores the state saved at the loop start, preparing codecs with internal state too */
+static void restore_vgmstream_loop(VGMSTREAM * vgmstream) {
+
+    /* prepare certain codecs' internal state for looping */
+
+    if (vgmstream->coding_type==coding_CRI_HCA) {
+        loop_hca(vgmstream);
+    }
+
+#ifdef VGM_USE_VORBIS
+    if (vgmstream->coding_type==coding_ogg_vorbis) {
+        seek_ogg_vorbis(vgmstream, vgmstream->loop_sample);
+    }
+
+    if (vgmstream->coding_type==coding_VORBIS_custom) {
+        seek_vorbis_custom(vgmstream, vgmstream->loop_start_sample);
+    }
+#endif
+
+#ifdef VGM_USE_FFMPEG
+    if (vgmstream->coding_type==coding_FFmpeg) {
+        seek_ffmpeg(vgmstream, vgmstream->loop_start_sample);
+    }
+#endif
+
+#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
+    if (vgmstream->coding_type==coding_MP4_AAC) {
+        seek_mp4_aac(vgmstream, vgmstream->loop_sample);
+    }
+#endif
+
+#ifdef VGM_USE_MAIATRAC3PLUS
+    if (vgmstream->coding_type==coding_AT3plus) {
+        seek_at3plus(vgmstream, vgmstream->loop_sample);
+    }
+#endif
+
+#ifdef VGM_USE_MPEG
+    if (vgmstream->coding_type==coding_MPEG_custom ||
+        vgmstream->coding_type==coding_MPEG_ealayer3 ||
+        vgmstream->coding_type==coding_MPEG_layer1 ||
+        vgmstream->coding_type==coding_MPEG_layer2 ||
+        vgmstream->coding_type==coding_MPEG_layer3) {
+        seek_mpeg(vgmstream, vgmstream->loop_sample);
+    }
+#endif
+
+    if (vgmstream->coding_type == coding_NWA0 ||
+        vgmstream->coding_type == coding_NWA1 ||
+        vgmstream->coding_type == coding_NWA2 ||
+        vgmstream->coding_type == coding_NWA3 ||
+        vgmstream->coding_type == coding_NWA4 ||
+        vgmstream->coding_type == coding_NWA5)
+    {
+        nwa_codec_data *data = vgmstream->codec_data;
+        seek_nwa(data->nwa, vgmstream->loop_sample);
+    }
+
+    /* restore! */
+    memcpy(vgmstream->ch,vgmstream->loop_ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+    vgmstream->current_sample = vgmstream->loop_sample;
+    vgmstream->samples_into_block = vgmstream->loop_samples_into_block;
+    vgmstream->current_block_size = vgmstream->loop_block_size;
+    vgmstream->current_block_offset = vgmstream->loop_block_offset;
+    vgmstream->next_block_offset = vgmstream->loop_next_block_offset;
+}
+
+/* saves the state at the loop start */
+static void save_vgmstream_loop(VGMSTREAM * vgmstream) {
+    memcpy(vgmstream->loop_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+
+    vgmstream->loop_sample = vgmstream->current_sample;
+    vgmstream->loop_samples_into_block = vgmstream->samples_into_block;
+    vgmstream->loop_block_size = vgmstream->current_block_size;
+    vgmstream->loop_block_offset = vgmstream->current_block_offset;
+    vgmstream->loop_next_block_offset = vgmstream->next_block_offset;
+    vgmstream->hit_loop = 1;
+}
+
 /* loop if end sample is reached, and return 1 if we did loop */
 int vgmstream_do_loop(VGMSTREAM * vgmstream) {
     /*if (!vgmstream->loop_flag) return 0;*/
@@ -1884,12 +2654,7 @@ int vgmstream_do_loop(VGMSTREAM * vgmstream) {
 
         /* against everything I hold sacred, preserve adpcm
          * history through loop for certain types */
-        if (vgmstream->meta_type == meta_DSP_STD ||
-            vgmstream->meta_type == meta_DSP_RS03 ||
-            vgmstream->meta_type == meta_DSP_CSTR ||
-            vgmstream->coding_type == coding_PSX ||
-            vgmstream->coding_type == coding_PSX_bmdx ||
-            vgmstream->coding_type == coding_PSX_badflags) {
+        if (is_vgmstream_loop_history_kept(vgmstream)) {
             int i;
             for (i=0;i<vgmstream->channels;i++) {
                 vgmstream->loop_ch[i].adpcm_history1_16 = vgmstream->ch[i].adpcm_history1_16;
@@ -1899,88 +2664,560 @@ int vgmstream_do_loop(VGMSTREAM * vgmstream) {
             }
         }
 
+        restore_vgmstream_loop(vgmstream);
 
-        /* prepare certain codecs' internal state for looping */
-
-        if (vgmstream->coding_type==coding_CRI_HCA) {
-            loop_hca(vgmstream);
-        }
+        return 1; /* looped */
+    }
+
+
+    /* is this the loop start? */
+    if (!vgmstream->hit_loop && vgmstream->current_sample==vgmstream->loop_start_sample) {
+        save_vgmstream_loop(vgmstream);
+    }
+
+    return 0; /* not looped */
+}
+
+
+/* layouts where the state is fully in the VGMSTREAM's fields and channels, and loops are handled by vgmstream_do_loop */
+static int is_vgmstream_seek_layout(VGMSTREAM * vgmstream) {
+    switch (vgmstream->layout_type) {
+        case layout_acm:
+        case layout_mus_acm:
+        case layout_aix:
+        case layout_aax:
+        case layout_scd_int:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+/* codecs where a sample can be read knowing only the channel offsets (no decoder state) */
+static int is_vgmstream_stateless_coding(VGMSTREAM * vgmstream) {
+    switch (vgmstream->coding_type) {
+        case coding_PCM16LE:
+        case coding_PCM16BE:
+        case coding_PCM16_int:
+        case coding_PCM8:
+        case coding_PCM8_int:
+        case coding_PCM8_U:
+        case coding_PCM8_U_int:
+        case coding_PCM8_SB_int:
+        case coding_ULAW:
+        case coding_ALAW:
+        case coding_PCMFLOAT:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/* codecs that can seek on their own (through their codec_data) */
+static int is_vgmstream_seekable_coding(VGMSTREAM * vgmstream) {
+    switch (vgmstream->coding_type) {
+#ifdef VGM_USE_VORBIS
+        case coding_ogg_vorbis:
+        case coding_VORBIS_custom:
+#endif
+#ifdef VGM_USE_FFMPEG
+        case coding_FFmpeg:
+#endif
+#if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
+        case coding_MP4_AAC:
+#endif
+#ifdef VGM_USE_MAIATRAC3PLUS
+        case coding_AT3plus:
+#endif
+#ifdef VGM_USE_MPEG
+        case coding_MPEG_custom:
+        case coding_MPEG_ealayer3:
+        case coding_MPEG_layer1:
+        case coding_MPEG_layer2:
+        case coding_MPEG_layer3:
+#endif
+        case coding_NWA0:
+        case coding_NWA1:
+        case coding_NWA2:
+        case coding_NWA3:
+        case coding_NWA4:
+        case coding_NWA5:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int is_vgmstream_block_restart(VGMSTREAM * vgmstream) {
+    if (vgmstream->codec_data)
+        return 0;
+
+    switch (vgmstream->layout_type) {
+        case layout_thp_blocked: /* DSP hist in the block header */
+            return vgmstream->coding_type == coding_NGC_DSP;
+        case layout_hwas_blocked: /* IMA state reset every block */
+            return 1;
+        case layout_ea_blocked: /* IMA hist/step in the block header */
+        case layout_blocked_ea_1snh:
+            return vgmstream->coding_type == coding_DVI_IMA || is_vgmstream_stateless_coding(vgmstream);
+        case layout_ea_sns_blocked: /* self-contained frames */
+            return vgmstream->coding_type == coding_EA_XAS;
+        case layout_blocked_awc: /* IMA hist/step per frame */
+            return vgmstream->coding_type == coding_AWC_IMA;
+
+        case layout_mxch_blocked:
+        case layout_ast_blocked:
+        case layout_halpst_blocked:
+        case layout_xa_blocked:
+        case layout_caf_blocked:
+        case layout_wsi_blocked:
+        case layout_str_snds_blocked:
+        case layout_ws_aud_blocked:
+        case layout_matx_blocked:
+        case layout_de2_blocked:
+        case layout_vs_blocked:
+        case layout_emff_ps2_blocked:
+        case layout_emff_ngc_blocked:
+        case layout_gsb_blocked:
+        case layout_xvas_blocked:
+        case layout_filp_blocked:
+        case layout_ivaud_blocked:
+        case layout_psx_mgav_blocked:
+        case layout_ps2_adm_blocked:
+        case layout_dsp_bdsp_blocked:
+        case layout_tra_blocked:
+        case layout_ps2_iab_blocked:
+        case layout_ps2_strlr_blocked:
+        case layout_rws_blocked:
+        case layout_blocked_vgs:
+            return is_vgmstream_stateless_coding(vgmstream);
+
+        default:
+            return 0;
+    }
+}
+
+/* Returns the closest sample at or before seek_sample that can be reached directly from the stream start
+ * (without decoding what's before), or -1 if the layout/codec doesn't allow it. */
+static int32_t get_vgmstream_direct_seek_sample(VGMSTREAM * vgmstream, int32_t seek_sample) {
+
+    switch (vgmstream->layout_type) {
+        case layout_none:
+            if (is_vgmstream_stateless_coding(vgmstream))
+                return seek_sample;
+            if (is_vgmstream_seekable_coding(vgmstream))
+                return seek_sample;
+            return -1;
 
 #ifdef VGM_USE_VORBIS
-        if (vgmstream->coding_type==coding_ogg_vorbis) {
-            seek_ogg_vorbis(vgmstream, vgmstream->loop_sample);
+        case layout_ogg_vorbis:
+#endif
+#ifdef VGM_USE_MPEG
+        case layout_mpeg_custom:
+#endif
+            if (is_vgmstream_seekable_coding(vgmstream))
+                return seek_sample;
+            return -1;
+
+        case layout_interleave:
+        case layout_interleave_shortblock: {
+            int frame_size = get_vgmstream_frame_size(vgmstream);
+            int samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+            int32_t samples_per_block, block;
+
+            if (!is_vgmstream_stateless_coding(vgmstream) || !frame_size || !samples_per_frame)
+                return -1;
+            samples_per_block = vgmstream->interleave_block_size / frame_size * samples_per_frame;
+            if (samples_per_block <= 0)
+                return -1;
+
+            /* the short last block is reached from the start of the previous one */
+            block = seek_sample / samples_per_block;
+            if (vgmstream->layout_type == layout_interleave_shortblock) {
+                while (block > 0 && block * samples_per_block + samples_per_block > vgmstream->num_samples)
+                    block--;
+                if (block * samples_per_block + samples_per_block > vgmstream->num_samples)
+                    return 0;
+                if (seek_sample >= block * samples_per_block + samples_per_block)
+                    return block * samples_per_block;
+            }
+            return seek_sample;
         }
 
-        if (vgmstream->coding_type==coding_VORBIS_custom) {
-            seek_vorbis_custom(vgmstream, vgmstream->loop_start_sample);
+        default: /* blocked layouts: start of the block with the sample */
+            if (vgmstream->block_index) {
+                int entry = find_block_index(vgmstream, seek_sample);
+                if (entry < 0)
+                    return 0;
+                return ((vgmstream_block_index *)vgmstream->block_index)->entries[entry].sample;
+            }
+            return -1;
+    }
+}
+
+/* Moves a reset stream to a sample returned by get_vgmstream_direct_seek_sample. */
+static void seek_vgmstream_direct(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    int i;
+
+    switch (vgmstream->layout_type) {
+        case layout_interleave:
+        case layout_interleave_shortblock: {
+            int frame_size = get_vgmstream_frame_size(vgmstream);
+            int samples_per_frame = get_vgmstream_samples_per_frame(vgmstream);
+            int32_t samples_per_block = vgmstream->interleave_block_size / frame_size * samples_per_frame;
+            int32_t block = seek_sample / samples_per_block;
+
+            for (i = 0; i < vgmstream->channels; i++) {
+                vgmstream->ch[i].offset += vgmstream->interleave_block_size * vgmstream->channels * block;
+            }
+            vgmstream->current_sample = seek_sample;
+            vgmstream->samples_into_block = seek_sample - block * samples_per_block;
+            break;
         }
+
+        default:
+            if (vgmstream->block_index) {
+                int entry = find_block_index(vgmstream, seek_sample);
+                if (entry >= 0)
+                    seek_block_index(vgmstream, entry);
+                break;
+            }
+
+            /* no layout: offsets stay at the channel start */
+            vgmstream->current_sample = seek_sample;
+            vgmstream->samples_into_block = seek_sample;
+            break;
+    }
+
+#ifdef VGM_USE_VORBIS
+    if (vgmstream->coding_type==coding_ogg_vorbis) {
+        seek_ogg_vorbis(vgmstream, seek_sample);
+    }
+
+    if (vgmstream->coding_type==coding_VORBIS_custom) {
+        seek_vorbis_custom(vgmstream, seek_sample);
+    }
 #endif
 
 #ifdef VGM_USE_FFMPEG
-        if (vgmstream->coding_type==coding_FFmpeg) {
-            seek_ffmpeg(vgmstream, vgmstream->loop_start_sample);
-        }
+    if (vgmstream->coding_type==coding_FFmpeg) {
+        seek_ffmpeg(vgmstream, seek_sample);
+    }
 #endif
 
 #if defined(VGM_USE_MP4V2) && defined(VGM_USE_FDKAAC)
-        if (vgmstream->coding_type==coding_MP4_AAC) {
-            seek_mp4_aac(vgmstream, vgmstream->loop_sample);
-        }
+    if (vgmstream->coding_type==coding_MP4_AAC) {
+        seek_mp4_aac(vgmstream, seek_sample);
+    }
 #endif
 
 #ifdef VGM_USE_MAIATRAC3PLUS
-        if (vgmstream->coding_type==coding_AT3plus) {
-            seek_at3plus(vgmstream, vgmstream->loop_sample);
-        }
+    if (vgmstream->coding_type==coding_AT3plus) {
+        seek_at3plus(vgmstream, seek_sample);
+    }
 #endif
 
 #ifdef VGM_USE_MPEG
-        if (vgmstream->coding_type==coding_MPEG_custom ||
-            vgmstream->coding_type==coding_MPEG_ealayer3 ||
-            vgmstream->coding_type==coding_MPEG_layer1 ||
-            vgmstream->coding_type==coding_MPEG_layer2 ||
-            vgmstream->coding_type==coding_MPEG_layer3) {
-            seek_mpeg(vgmstream, vgmstream->loop_sample);
-        }
+    if (vgmstream->coding_type==coding_MPEG_custom ||
+        vgmstream->coding_type==coding_MPEG_ealayer3 ||
+        vgmstream->coding_type==coding_MPEG_layer1 ||
+        vgmstream->coding_type==coding_MPEG_layer2 ||
+        vgmstream->coding_type==coding_MPEG_layer3) {
+        seek_mpeg(vgmstream, seek_sample);
+    }
 #endif
 
-        if (vgmstream->coding_type == coding_NWA0 ||
-            vgmstream->coding_type == coding_NWA1 ||
-            vgmstream->coding_type == coding_NWA2 ||
-            vgmstream->coding_type == coding_NWA3 ||
-            vgmstream->coding_type == coding_NWA4 ||
-            vgmstream->coding_type == coding_NWA5)
-        {
-            nwa_codec_data *data = vgmstream->codec_data;
-            seek_nwa(data->nwa, vgmstream->loop_sample);
+    if (vgmstream->coding_type == coding_NWA0 ||
+        vgmstream->coding_type == coding_NWA1 ||
+        vgmstream->coding_type == coding_NWA2 ||
+        vgmstream->coding_type == coding_NWA3 ||
+        vgmstream->coding_type == coding_NWA4 ||
+        vgmstream->coding_type == coding_NWA5)
+    {
+        nwa_codec_data *data = vgmstream->codec_data;
+        seek_nwa(data->nwa, seek_sample);
+    }
+}
+
+/* copies the loop settings (callers may change them after opening) and the saved loop state of an older state */
+static void keep_vgmstream_loop(VGMSTREAM * vgmstream, const VGMSTREAM * loop_state) {
+    vgmstream->loop_flag = loop_state->loop_flag;
+    vgmstream->loop_start_sample = loop_state->loop_start_sample;
+    vgmstream->loop_end_sample = loop_state->loop_end_sample;
+    vgmstream->loop_target = loop_state->loop_target;
+    vgmstream->loop_ch = loop_state->loop_ch;
+
+    vgmstream->hit_loop = loop_state->hit_loop;
+    vgmstream->loop_sample = loop_state->loop_sample;
+    vgmstream->loop_samples_into_block = loop_state->loop_samples_into_block;
+    vgmstream->loop_block_size = loop_state->loop_block_size;
+    vgmstream->loop_block_offset = loop_state->loop_block_offset;
+    vgmstream->loop_next_block_offset = loop_state->loop_next_block_offset;
+}
+
+/* resets the stream but keeps the loop settings and state */
+static void reset_vgmstream_for_seek(VGMSTREAM * vgmstream) {
+    VGMSTREAM loop_state = *vgmstream;
+
+    reset_vgmstream(vgmstream);
+    keep_vgmstream_loop(vgmstream, &loop_state);
+}
+
+
+/* checkpoints only work if the whole decoder state is in the VGMSTREAM and its channels */
+static int is_vgmstream_checkpoint_coding(VGMSTREAM * vgmstream) {
+    return is_vgmstream_seek_layout(vgmstream) && !vgmstream->codec_data;
+}
+
+int set_vgmstream_checkpoints(VGMSTREAM * vgmstream, int32_t interval) {
+    vgmstream_checkpoints *checkpoints = NULL;
+    int i;
+
+    if (vgmstream->checkpoints || interval <= 0 || !is_vgmstream_checkpoint_coding(vgmstream))
+        return 0;
+
+    checkpoints = calloc(1, sizeof(vgmstream_checkpoints));
+    if (!checkpoints) goto fail;
+
+    /* the table is sized from the exact sample count, as lazy ones may be estimates */
+    if (vgmstream->lazy_samples)
+        update_vgmstream_samples(vgmstream);
+
+    checkpoints->interval = interval;
+    checkpoints->count = vgmstream->num_samples / interval + 1;
+    checkpoints->samples = malloc(checkpoints->count * sizeof(int32_t));
+    checkpoints->states = malloc(checkpoints->count * sizeof(VGMSTREAM));
+    checkpoints->channels = malloc(checkpoints->count * vgmstream->channels * sizeof(VGMSTREAMCHANNEL));
+    if (!checkpoints->samples || !checkpoints->states || !checkpoints->channels) goto fail;
+
+    for (i = 0; i < checkpoints->count; i++) {
+        checkpoints->samples[i] = -1;
+    }
+
+    /* reset copies the start_vgmstream over, so it needs them too */
+    vgmstream->checkpoints = checkpoints;
+    ((VGMSTREAM *)vgmstream->start_vgmstream)->checkpoints = checkpoints;
+    return 1;
+
+fail:
+    if (checkpoints) {
+        free(checkpoints->samples);
+        free(checkpoints->states);
+        free(checkpoints->channels);
+        free(checkpoints);
+    }
+    return 0;
+}
+
+static void save_vgmstream_checkpoint(VGMSTREAM * vgmstream) {
+    vgmstream_checkpoints *checkpoints = vgmstream->checkpoints;
+    int slot;
+
+    if (vgmstream->current_sample < 0 || vgmstream->current_sample > vgmstream->num_samples)
+        return;
+    /* the ADPCM history kept through loops makes states after a loop a bit different from the first time */
+    if (vgmstream->loop_count > 0 && is_vgmstream_loop_history_kept(vgmstream))
+        return;
+
+    slot = vgmstream->current_sample / checkpoints->interval;
+    if (slot >= checkpoints->count || checkpoints->samples[slot] >= 0)
+        return;
+
+    checkpoints->samples[slot] = vgmstream->current_sample;
+    memcpy(&checkpoints->states[slot], vgmstream, sizeof(VGMSTREAM));
+    memcpy(&checkpoints->channels[slot * vgmstream->channels], vgmstream->ch, sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+}
+
+/* Returns the slot of the closest checkpoint at or before seek_sample that is valid in loop pass loop_count,
+ * or -1 if there isn't any. */
+static int find_vgmstream_checkpoint(VGMSTREAM * vgmstream, int32_t seek_sample, int loop_count) {
+    vgmstream_checkpoints *checkpoints = vgmstream->checkpoints;
+    int history_kept = is_vgmstream_loop_history_kept(vgmstream);
+    int slot;
+
+    if (!checkpoints || seek_sample < 0)
+        return -1;
+
+    slot = seek_sample / checkpoints->interval;
+    if (slot >= checkpoints->count)
+        slot = checkpoints->count - 1;
+    for (; slot >= 0; slot--) {
+        if (checkpoints->samples[slot] < 0 || checkpoints->samples[slot] > seek_sample)
+            continue;
+        /* with the history kept through loops each pass decodes differently, so only its own states work */
+        if (history_kept && checkpoints->states[slot].loop_count != loop_count)
+            continue;
+        return slot;
+    }
+    return -1;
+}
+
+static void restore_vgmstream_checkpoint(VGMSTREAM * vgmstream, int slot) {
+    vgmstream_checkpoints *checkpoints = vgmstream->checkpoints;
+    VGMSTREAM loop_state = *vgmstream;
+
+    memcpy(vgmstream, &checkpoints->states[slot], sizeof(VGMSTREAM));
+    memcpy(vgmstream->ch, &checkpoints->channels[slot * vgmstream->channels], sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+    keep_vgmstream_loop(vgmstream, &loop_state);
+}
+
+/* Moves to the closest point before sample (in loop pass loop_count) that can be reached without decoding
+ * (checkpoint, direct or start). */
+static void seek_vgmstream_closest(VGMSTREAM * vgmstream, int32_t seek_sample, int loop_count) {
+    int32_t direct_sample = get_vgmstream_direct_seek_sample(vgmstream, seek_sample);
+    int checkpoint_slot = find_vgmstream_checkpoint(vgmstream, seek_sample, loop_count);
+
+    if (checkpoint_slot >= 0) {
+        vgmstream_checkpoints *checkpoints = vgmstream->checkpoints;
+        if (checkpoints->samples[checkpoint_slot] > direct_sample) {
+            restore_vgmstream_checkpoint(vgmstream, checkpoint_slot);
+            return;
         }
+    }
 
-        /* restore! */
-        memcpy(vgmstream->ch,vgmstream->loop_ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
-        vgmstream->current_sample = vgmstream->loop_sample;
-        vgmstream->samples_into_block = vgmstream->loop_samples_into_block;
-        vgmstream->current_block_size = vgmstream->loop_block_size;
-        vgmstream->current_block_offset = vgmstream->loop_block_offset;
-        vgmstream->next_block_offset = vgmstream->loop_next_block_offset;
+    reset_vgmstream_for_seek(vgmstream);
+    if (direct_sample > 0)
+        seek_vgmstream_direct(vgmstream, direct_sample);
+}
 
-        return 1; /* looped */
+/* decodes and throws away samples */
+static void seek_vgmstream_decode(VGMSTREAM * vgmstream, int32_t sample_count) {
+    sample buf[0x1000];
+    int32_t max_samples = sizeof(buf) / sizeof(sample) / vgmstream->channels;
+
+    while (sample_count > 0) {
+        int32_t samples_to_do = sample_count;
+        if (samples_to_do > max_samples)
+            samples_to_do = max_samples;
+
+        render_vgmstream(buf, samples_to_do, vgmstream);
+        sample_count -= samples_to_do;
+    }
+}
+
+void seek_vgmstream(VGMSTREAM * vgmstream, int32_t seek_sample) {
+    int32_t target_sample = seek_sample; /* in the stream */
+    int32_t start_sample = 0; /* where decoding starts from */
+    int32_t direct_sample = -1;
+    int checkpoint_slot = -1;
+    int32_t loop_length;
+    int loop_count = 0;
+    int loop_flag;
+    int can_seek = is_vgmstream_seek_layout(vgmstream);
+    enum { SEEK_RESET, SEEK_CURRENT, SEEK_LOOP, SEEK_CLOSEST } seek_from = SEEK_RESET;
+
+    if (seek_sample < 0)
+        seek_sample = 0;
+
+    /* the loop points must be the exact ones */
+    if (vgmstream->lazy_samples)
+        update_vgmstream_samples(vgmstream);
+    loop_length = vgmstream->loop_end_sample - vgmstream->loop_start_sample;
+    loop_flag = vgmstream->loop_flag;
+
+    /* layouts that play other VGMSTREAMs handle loops on their own, so just decode from the start */
+    if (!can_seek) {
+        reset_vgmstream_for_seek(vgmstream);
+        seek_vgmstream_decode(vgmstream, seek_sample);
+        return;
     }
 
+    /* loops are disabled once loop_target is reached, but still count before it */
+    if (!loop_flag && vgmstream->loop_target && vgmstream->loop_count >= vgmstream->loop_target)
+        loop_flag = 1;
 
-    /* is this the loop start? */
-    if (!vgmstream->hit_loop && vgmstream->current_sample==vgmstream->loop_start_sample) {
-        /* save! */
-        memcpy(vgmstream->loop_ch,vgmstream->ch,sizeof(VGMSTREAMCHANNEL)*vgmstream->channels);
+    /* find the position in the stream and loop of seek_sample */
+    if (loop_flag && loop_length > 0 && seek_sample > vgmstream->loop_end_sample) {
+        loop_count = (seek_sample - vgmstream->loop_start_sample - 1) / loop_length;
+        if (vgmstream->loop_target && loop_count >= vgmstream->loop_target) {
+            loop_count = vgmstream->loop_target;
+            target_sample = seek_sample - (vgmstream->loop_target - 1) * loop_length;
+            loop_flag = 0; /* past the last loop end, plays the stream end */
+        }
+        else {
+            target_sample = seek_sample - loop_count * loop_length;
+        }
+    }
+    if (target_sample > vgmstream->num_samples)
+        target_sample = vgmstream->num_samples;
+
+    /* the ADPCM history kept through loops makes every pass a bit different, so later passes are only exact
+     * when decoded from the end of the one before, as playing does (the first pass seeks like any other) */
+    if (loop_count > 0 && is_vgmstream_loop_history_kept(vgmstream)) {
+        int32_t position = vgmstream->current_sample + vgmstream->loop_count * loop_length; /* while looping */
 
-        vgmstream->loop_sample = vgmstream->current_sample;
-        vgmstream->loop_samples_into_block = vgmstream->samples_into_block;
-        vgmstream->loop_block_size = vgmstream->current_block_size;
-        vgmstream->loop_block_offset = vgmstream->current_block_offset;
-        vgmstream->loop_next_block_offset = vgmstream->next_block_offset;
-        vgmstream->hit_loop = 1;
+        if (vgmstream->loop_target && seek_sample > vgmstream->num_samples + (vgmstream->loop_target - 1) * loop_length)
+            seek_sample = vgmstream->num_samples + (vgmstream->loop_target - 1) * loop_length;
+
+        if (!vgmstream->loop_flag || vgmstream->loop_count == 0 || vgmstream->loop_count > loop_count || position > seek_sample) {
+            seek_vgmstream(vgmstream, vgmstream->loop_end_sample);
+            position = vgmstream->loop_end_sample;
+        }
+
+        seek_vgmstream_decode(vgmstream, seek_sample - position);
+        return;
     }
 
-    return 0; /* not looped */
+
+    /* pick the closest point to decode from: the current position if it's before the target in the same loop,
+     * the saved loop start, a checkpoint or a point that can be reached directly, or the stream start */
+    if (vgmstream->loop_count == loop_count && (vgmstream->loop_flag != 0) == (loop_flag != 0)
+            && vgmstream->current_sample <= target_sample) {
+        seek_from = SEEK_CURRENT;
+        start_sample = vgmstream->current_sample;
+    }
+
+    /* the saved loop state matches the first pass only if restoring it resets everything (after a loop it's
+     * what playback would do anyway, save for the history kept through loops) */
+    if (vgmstream->hit_loop && vgmstream->loop_ch && target_sample >= vgmstream->loop_sample
+            && vgmstream->loop_sample > start_sample
+            && (loop_count > 0 || ((!vgmstream->codec_data || is_vgmstream_seekable_coding(vgmstream)) && !is_vgmstream_loop_history_kept(vgmstream)))) {
+        seek_from = SEEK_LOOP;
+        start_sample = vgmstream->loop_sample;
+    }
+
+    direct_sample = get_vgmstream_direct_seek_sample(vgmstream, target_sample);
+    checkpoint_slot = find_vgmstream_checkpoint(vgmstream, target_sample, loop_count);
+    if (checkpoint_slot >= 0) {
+        vgmstream_checkpoints *checkpoints = vgmstream->checkpoints;
+        if (checkpoints->samples[checkpoint_slot] > direct_sample)
+            direct_sample = checkpoints->samples[checkpoint_slot];
+    }
+    if (direct_sample > start_sample) {
+        seek_from = SEEK_CLOSEST;
+        start_sample = direct_sample;
+    }
+
+    switch (seek_from) {
+        case SEEK_CURRENT:
+            break;
+
+        case SEEK_LOOP:
+            restore_vgmstream_loop(vgmstream);
+            break;
+
+        case SEEK_CLOSEST:
+            /* past the loop start: its state is needed to loop later, so get there first */
+            if (loop_flag && !vgmstream->hit_loop && vgmstream->loop_ch && direct_sample > vgmstream->loop_start_sample) {
+                seek_vgmstream_closest(vgmstream, vgmstream->loop_start_sample, 0);
+                seek_vgmstream_decode(vgmstream, vgmstream->loop_start_sample - vgmstream->current_sample);
+                save_vgmstream_loop(vgmstream);
+            }
+
+            seek_vgmstream_closest(vgmstream, target_sample, loop_count);
+            break;
+
+        case SEEK_RESET:
+        default:
+            reset_vgmstream_for_seek(vgmstream);
+            break;
+    }
+
+    /* the loop count and whether loops are still enabled depend on the target only */
+    vgmstream->loop_count = loop_count;
+    vgmstream->loop_flag = loop_flag;
+
+    seek_vgmstream_decode(vgmstream, target_sample - vgmstream->current_sample);
 }
 
 /* build a descriptive string */
@@ -2208,10 +3445,16 @@ static void try_dual_file_stereo(VGMSTREAM * opened_stream, STREAMFILE *streamFi
     if (!dual_stream) goto fail;
 
     new_stream = init_vgmstream_internal(dual_stream,
-            0   /* don't do dual file on this, to prevent recursion */
-            );
+            0,  /* don't do dual file on this, to prevent recursion */
+            NULL, NULL);
     close_streamfile(dual_stream);
 
+    /* both need the exact values to be compared */
+    if (new_stream) {
+        update_vgmstream_samples(opened_stream);
+        update_vgmstream_samples(new_stream);
+    }
+
     /* see if we were able to open the file, and if everything matched nicely */
     if (new_stream &&
             new_stream->channels == 1 &&
@@ -2284,6 +3527,12 @@ static void try_dual_file_stereo(VGMSTREAM * opened_stream, STREAMFILE *streamFi
         opened_stream->channels = 2;
 
         /* discard the second VGMSTREAM */
+        if (new_stream->block_index) {
+            vgmstream_block_index *index = new_stream->block_index;
+            free(index->entries);
+            free(index);
+        }
+        free(new_stream->start_vgmstream);
         free(new_stream);
     }
 fail:
@@ -2433,6 +3682,67 @@ int get_vgmstream_average_bitrate(VGMSTREAM * vgmstream)
 }
 
 
+void get_vgmstream_streamfile_stats(VGMSTREAM * vgmstream, STREAMFILE_STATS * stats)
+{
+    int i, j;
+
+    if (!vgmstream)
+        return;
+
+    /* layouts made of other VGMSTREAMs (their files read from this one's) */
+    if (vgmstream->layout_type==layout_aix) {
+        aix_codec_data *data = (aix_codec_data *) vgmstream->codec_data;
+        for (i = 0; data && i < data->segment_count*data->stream_count; i++) {
+            get_vgmstream_streamfile_stats(data->adxs[i], stats);
+        }
+    }
+    if (vgmstream->layout_type==layout_aax) {
+        aax_codec_data *data = (aax_codec_data *) vgmstream->codec_data;
+        for (i = 0; data && i < data->segment_count; i++) {
+            get_vgmstream_streamfile_stats(data->adxs[i], stats);
+        }
+    }
+    if (vgmstream->layout_type==layout_scd_int) {
+        scd_int_codec_data *data = (scd_int_codec_data *) vgmstream->codec_data;
+        for (i = 0; data && i < data->substream_count; i++) {
+            get_vgmstream_streamfile_stats(data->substreams[i], stats);
+            if (data->intfiles[i])
+                get_streamfile_stats(data->intfiles[i], stats);
+        }
+    }
+
+    /* codecs that keep their own files */
+    if (vgmstream->coding_type==coding_ACM) {
+        mus_acm_codec_data *data = (mus_acm_codec_data *) vgmstream->codec_data;
+        for (i = 0; data && data->files && i < data->file_count; i++) {
+            if (data->files[i])
+                get_streamfile_stats(data->files[i]->streamfile, stats);
+        }
+    }
+    if (vgmstream->layout_type!=layout_scd_int) {
+        STREAMFILE * codecFile = get_vgmstream_streamfile(vgmstream, 0);
+        for (i = 0; codecFile && i < vgmstream->channels; i++) {
+            if (vgmstream->ch[i].streamfile == codecFile)
+                codecFile = NULL; /* it's just a channel's */
+        }
+        if (codecFile)
+            get_streamfile_stats(codecFile, stats);
+    }
+
+    /* channel files (multiple channels might have the same one) */
+    for (i = 0; i < vgmstream->channels; i++) {
+        STREAMFILE * streamFile = vgmstream->ch[i].streamfile;
+        if (!streamFile)
+            continue;
+        for (j = 0; j < i; j++) {
+            if (vgmstream->ch[j].streamfile == streamFile)
+                break;
+        }
+        if (j == i)
+            get_streamfile_stats(streamFile, stats);
+    }
+}
+
 /**
  * Inits vgmstreams' channels doing two things:
  * - sets the starting offset per channel (depending on the layout)
@@ -75,7 +75,6 @@ enum { STREAM_NAME_SIZE = 255 }; /* reasonable max */
 typedef enum {
     /* PCM */
     coding_PCM16LE,         /* little endian 16-bit PCM */
-    coding_PCM16LE_XOR_int, /* little endian 16-bit PCM with sample-level xor (for blocks) */
     coding_PCM16BE,         /* big endian 16-bit PCM */
     coding_PCM16_int,       /* 16-bit PCM with sample-level interleave (for blocks) */
 
@@ -246,7 +245,7 @@ typedef enum {
     layout_mus_acm,         /* mus has multi-files to deal with */
     layout_aix,             /* CRI AIX's wheels within wheels */
     layout_aax,             /* CRI AAX's wheels within databases */
-	layout_scd_int,         /* deinterleave done by the SCDINTSTREAMFILE */
+	layout_scd_int,         /* deinterleave done by a window STREAMFILE */
 
 #ifdef VGM_USE_VORBIS
     layout_ogg_vorbis,      /* ogg vorbis file */
@@ -696,9 +695,6 @@ typedef struct {
     /* BMDX encryption */
     uint8_t bmdx_xor;
     uint8_t bmdx_add;
-    
-    /* generic encryption */
-    uint16_t key_xor;
 } VGMSTREAMCHANNEL;
 
 /* main vgmstream info */
@@ -756,6 +752,13 @@ typedef struct {
     int loop_count;                 /* number of complete loops (1=looped once) */
     int loop_target;                /* max loops before continuing with the stream end */
 
+    /* seek checkpoints */
+    void * checkpoints;             /* saved decoder states while playing (vgmstream_checkpoints), if enabled */
+    void * block_index;             /* blocks found so far (vgmstream_block_index), if decoding can restart at blocks */
+
+    /* lazy sample counting */
+    void * lazy_samples;            /* deferred num_samples/loops scan (vgmstream_lazy_samples), while the values are estimates */
+
     /* decoder specific */
     int codec_endian;               /* little/big endian marker; name is left vague but usually means big endian */
     int codec_version;              /* flag for codecs with minor variations */
@@ -779,6 +782,36 @@ typedef struct {
     void * codec_data;
 } VGMSTREAM;
 
+/* decoder states saved every interval samples while playing, to seek without decoding from the start */
+typedef struct {
+    int32_t interval;               /* samples between checkpoints */
+    int count;                      /* number of checkpoints (num_samples / interval + 1) */
+    int32_t * samples;              /* sample of each checkpoint, or -1 if not saved yet */
+    VGMSTREAM * states;             /* VGMSTREAM of each checkpoint */
+    VGMSTREAMCHANNEL * channels;    /* channels of each checkpoint */
+} vgmstream_checkpoints;
+
+/* where a block starts, to restart a blocked layout there */
+typedef struct {
+    off_t offset;                   /* block offset to update from */
+    off_t next_offset;              /* next block offset (some layouts get it from the previous block) */
+    int32_t sample;                 /* first sample of the block */
+} vgmstream_block_index_entry;
+
+/* a meta's scan for exact num_samples/loops, deferred until the values are needed */
+typedef struct {
+    void (*update)(VGMSTREAM * vgmstream, STREAMFILE * streamFile, const void * config); /* sets the exact values */
+    STREAMFILE * streamFile;        /* the file to scan (owned) */
+    void * config;                  /* copy of the meta's values the scan needs */
+} vgmstream_lazy_samples;
+
+/* blocks found while playing or walking block headers, for seeks in blocked layouts */
+typedef struct {
+    int count;
+    int max;
+    vgmstream_block_index_entry * entries;
+} vgmstream_block_index;
+
 #ifdef VGM_USE_VORBIS
 /* Ogg with Vorbis */
 typedef struct {
@@ -786,12 +819,6 @@ typedef struct {
     ogg_int64_t offset;
     ogg_int64_t size;
     ogg_int64_t other_header_bytes;
-
-    /* XOR setup (SCD) */
-    int decryption_enabled;
-    void (*decryption_callback)(void *ptr, size_t size, size_t nmemb, void *datasource, int bytes_read);
-    uint8_t scd_xor;
-    off_t scd_xor_length;
 } ogg_vorbis_streamfile;
 
 typedef struct {
@@ -836,6 +863,14 @@ typedef struct {
 
 } vorbis_custom_config;
 
+/* where to restart decoding custom Vorbis to get samples from some point */
+typedef struct {
+    off_t offset;               /* packet to restart from (the one before the first with samples) */
+    int32_t sample;             /* first sample output when restarting there */
+    int current_packet;         /* packet parser state at that offset */
+    uint8_t prev_blockflag;
+} vorbis_custom_index_entry;
+
 /* custom Vorbis without Ogg layer */
 typedef struct {
     vorbis_info vi;             /* stream settings */
@@ -860,6 +895,14 @@ typedef struct {
     /* Ogg-style Vorbis: packet within a page */
     int current_packet;
 
+    /* seek index of packets decoded so far, as custom Vorbis has no seek table */
+    vorbis_custom_index_entry * index;
+    int index_count;
+    int index_max;
+    int32_t pcm_sample;                 /* sample of the next PCM sample in the libvorbis buffers */
+    vorbis_custom_index_entry prev_packet; /* restart point of the last parsed packet */
+    int prev_packet_valid;              /* flag, prev_packet was parsed after the last restart */
+
 } vorbis_custom_codec_data;
 #endif
 
@@ -895,6 +938,15 @@ typedef struct {
     uint16_t cri_key3;
 } mpeg_custom_config;
 
+/* where to restart decoding a custom MPEG stream to get samples from some point */
+typedef struct {
+    off_t offset;               /* frame to restart from (decoder buffers were empty there) */
+    int32_t sample;             /* first stream sample output when restarting there */
+    size_t current_size_count;  /* frame parser state at that offset */
+    size_t current_size_target;
+    size_t decode_to_discard;
+} mpeg_custom_index_entry;
+
 /* represents a single MPEG stream */
 typedef struct {
     mpg123_handle *m; /* MPEG decoder */
@@ -908,6 +960,14 @@ typedef struct {
     size_t current_size_target; /* max data, until something happens */
     size_t decode_to_discard;  /* discard from this stream only (for EALayer3 or AWC) */
 
+    /* frame index, filled while decoding */
+    mpeg_custom_index_entry * index;
+    int index_count;
+    int index_max;
+    int32_t pcm_sample;         /* stream sample of the next sample put in the buffer */
+    int32_t seek_to_discard;    /* discard from this stream only after a seek */
+    int frames_pending;         /* frames fed to the decoder but not returned yet */
+
 } mpeg_custom_stream;
 
 typedef struct {
@@ -1132,6 +1192,41 @@ typedef struct {
 #endif
 
 
+/* result of trying one init function during detection */
+typedef enum {
+    PROBE_REJECTED,             /* init returned nothing */
+    PROBE_ACCEPTED,             /* init returned a VGMSTREAM that was used */
+    PROBE_BAD_LOOPS,            /* used, but its loops failed the sanity checks and were ignored */
+    PROBE_BAD_SAMPLES,          /* discarded, num_samples <= 0 */
+    PROBE_BAD_SAMPLE_RATE       /* discarded, sample rate out of range */
+} probe_outcome_t;
+
+/* cost of one init function during detection, as seen through the STREAMFILE it was given */
+typedef struct {
+    const char * name;          /* init function */
+    probe_outcome_t outcome;
+    double time;                /* seconds */
+    uint64_t reads;             /* read/borrow calls */
+    uint64_t bytes_read;        /* bytes returned to the init */
+    uint64_t bytes_fetched;     /* bytes read from the file (not already cached) */
+} VGMSTREAM_PROBE;
+
+typedef void (*vgmstream_probe_callback)(const VGMSTREAM_PROBE * probe, void * data);
+
+/* what the detection cache remembers of a file (or subsong) */
+typedef struct {
+    char meta[0x40];            /* init function that detected it */
+    int stream_index;
+    int num_streams;
+    int channels;
+    int sample_rate;
+    int32_t num_samples;
+    int loop_flag;
+    int32_t loop_start_sample;
+    int32_t loop_end_sample;
+} VGMSTREAM_CACHE_INFO;
+
+
 /* -------------------------------------------------------------------------*/
 /* vgmstream "public" API                                                   */
 /* -------------------------------------------------------------------------*/
@@ -1142,9 +1237,25 @@ VGMSTREAM * init_vgmstream(const char * const filename);
 /* init with custom IO via streamfile */
 VGMSTREAM * init_vgmstream_from_STREAMFILE(STREAMFILE *streamFile);
 
+/* same as init_vgmstream_from_STREAMFILE, but calls callback after each init function tried */
+VGMSTREAM * init_vgmstream_profile(STREAMFILE *streamFile, vgmstream_probe_callback callback, void * data);
+
 /* reset a VGMSTREAM to start of stream */
 void reset_vgmstream(VGMSTREAM * vgmstream);
 
+/* move a VGMSTREAM to a sample in the played stream (counting loops, as if rendered from the start);
+ * faster than resetting and rendering when the position can be found directly or is past the loop start */
+void seek_vgmstream(VGMSTREAM * vgmstream, int32_t seek_sample);
+
+/* Saves the decoder state about every interval samples while rendering, so later seeks decode from the closest one.
+ * Only for codecs that keep their state in the channels (most ADPCM and PCM). Returns 0 if not possible. */
+int set_vgmstream_checkpoints(VGMSTREAM * vgmstream, int32_t interval);
+
+/* Does a num_samples/loops scan deferred by lazy sample counting (see vgmstream_set_lazy_samples), if any,
+ * so the values are exact. Done on first render/seek too, but callers that change the loops or get the play
+ * length for playback should call this first. */
+void update_vgmstream_samples(VGMSTREAM * vgmstream);
+
 /* close an open vgmstream */
 void close_vgmstream(VGMSTREAM * vgmstream);
 
@@ -1162,6 +1273,43 @@ void describe_vgmstream(VGMSTREAM * vgmstream, char * desc, int length);
  * stream. Compares files by absolute paths. */
 int get_vgmstream_average_bitrate(VGMSTREAM * vgmstream);
 
+/* Add the I/O counters of all STREAMFILEs used by this VGMSTREAM (including its layers') to stats,
+ * which should be zeroed first. Reads of layers that see part of a file are counted twice. */
+void get_vgmstream_streamfile_stats(VGMSTREAM * vgmstream, STREAMFILE_STATS * stats);
+
+/* Enables the on-disk detection cache, storing entries in dir (which must exist), or disables it if NULL.
+ * Files found in the cache are opened with the format that detected them before, without probing.
+ * Entries are dropped when the file or its directory change (so adding or removing companion files makes
+ * formats be tried in order again), but not when only the contents of a companion file change.
+ * Not thread safe, should be called before opening files. */
+void vgmstream_set_cache_dir(const char * dir);
+
+/* Gets the cached info of a file (and subsong) without opening it, if it didn't change since.
+ * Returns 1 if found. Plugins can use this to get lengths quickly. */
+int vgmstream_get_cache_info(const char * filename, int stream_index, VGMSTREAM_CACHE_INFO * info);
+
+/* Sets how many threads format detection may use to try formats at once (0 or 1 = one by one, the default).
+ * The detected format is the same either way. Only works where STREAMFILE prefetching does (pthreads).
+ * Not thread safe, should be called before opening files. */
+void vgmstream_set_probe_threads(int threads);
+
+/* Keeps listings of up to max_dirs recently used directories (0 = disabled, the default), so STREAMFILEs from
+ * open_stdio_streamfile/open_mmap_streamfile know if companion files exist without trying to open them.
+ * Listings are refreshed when the directory's mtime changes (checked every second at most).
+ * Not thread safe, should be called before opening files. */
+void vgmstream_set_dir_cache(int max_dirs);
+
+/* Keeps the parsed lines of up to max_files recently used .txth (0 = disabled, the default), so raw files
+ * sharing one .txth don't parse it again each time. Lines are parsed again when the .txth's mtime changes.
+ * Not thread safe, should be called before opening files. */
+void vgmstream_set_txth_cache(int max_files);
+
+/* Lets formats that scan the whole stream for num_samples or loops (some VAG, EA SCHl, XMA1) open with
+ * estimates instead (0 = disabled, the default), so opening big files for their info is fast. The scan is done
+ * on first render/seek or by update_vgmstream_samples.
+ * Not thread safe, should be called before opening files. */
+void vgmstream_set_lazy_samples(int enable);
+
 /* List of supported formats and elements in the list, for plugins that need to know. */
 const char ** vgmstream_get_formats(size_t * size);
 
@@ -1169,9 +1317,17 @@ const char ** vgmstream_get_formats(size_t * size);
 /* vgmstream "private" API                                                  */
 /* -------------------------------------------------------------------------*/
 
+/* saves info of a detected file in the detection cache (if enabled) */
+void put_vgmstream_cache_info(const char * filename, const VGMSTREAM_CACHE_INFO * info);
+
 /* allocate a VGMSTREAM and channel stuff */
 VGMSTREAM * allocate_vgmstream(int channel_count, int looped);
 
+/* Sets a meta's exact num_samples/loops with update, called now or, if lazy sample counting is enabled, later with
+ * a new STREAMFILE of the file and a copy of config (config_size bytes); the meta's estimates are used until then.
+ * Loop channels are allocated if update sets loop_flag. */
+void set_vgmstream_lazy_samples(VGMSTREAM * vgmstream, STREAMFILE * streamFile, void (*update)(VGMSTREAM *, STREAMFILE *, const void *), const void * config, size_t config_size);
+
 /* smallest self-contained group of samples is a frame */
 int get_vgmstream_samples_per_frame(VGMSTREAM * vgmstream);
 /* number of bytes per frame */
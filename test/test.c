@@ -2,11 +2,15 @@
 #include <getopt.h>
 #include "../src/vgmstream.h"
 #include "../src/util.h"
+#include <sys/stat.h>
 #ifdef WIN32
 #include <io.h>
 #include <fcntl.h>
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
 #else
 #include <unistd.h>
+#include <dirent.h>
 #endif
 
 #ifndef STDOUT_FILENO
@@ -28,6 +32,9 @@ extern int optind, opterr, optopt;
 
 static void make_wav_header(uint8_t * buf, int32_t sample_count, int32_t sample_rate, int channels);
 static void make_smpl_chunk(uint8_t * buf, int32_t loop_start, int32_t loop_end);
+static void print_stats(VGMSTREAM * vgmstream);
+static uint8_t * read_whole_file(const char * filename, size_t * size);
+static int profile_detection(const char * path, int stream_index);
 
 static void usage(const char * name) {
     fprintf(stderr,"vgmstream test decoder " VERSION " " __DATE__ "\n"
@@ -52,6 +59,20 @@ static void usage(const char * name) {
           "    -2 N: only output the Nth (first is 0) set of stereo channels\n"
           "    -F: don't fade after N loops and play the rest of the stream\n"
           "    -s N: select subtream N, if the format supports multiple streams\n"
+          "    -S: print file I/O stats to stderr when done\n"
+          "    -C dir: cache detected formats in dir, to open the same files faster next time\n"
+          "    -T N: try formats in N threads at once when detecting\n"
+          "    -n N: keep listings of N directories, to skip opening companion files that don't exist\n"
+          "    -t N: keep parsed .txth of N files, to skip parsing them again for each file\n"
+          "    -k N: seek to sample N and output from there\n"
+          "    -M: read the file through a memory map instead of stdio buffers\n"
+          "    -R: read the whole file into memory first and decode it from there\n"
+          "    -B: read ahead in a background thread while decoding\n"
+          "        (not on Windows, where it reads as usual)\n"
+          "    -z: open with estimated samples/loops if finding them reads the whole file\n"
+          "        (exact ones are found before decoding or printing)\n"
+          "    -D: profile format detection only and print the cost of each format tried\n"
+          "        (infile may be a directory to add up all files in it)\n"
             ,name);
 }
 
@@ -83,8 +104,20 @@ int main(int argc, char ** argv) {
     double fade_seconds = 10.0;
     double fade_delay_seconds = 0.0;
     int ignore_fade = 0;
-
-    while ((opt = getopt(argc, argv, "o:l:f:d:ipPcmxeLEFr:gb2:s:")) != -1) {
+    int print_iostats = 0;
+    int profile_only = 0;
+    char * cache_dir = NULL;
+    int probe_threads = 0;
+    int dir_cache = 0;
+    int txth_cache = 0;
+    int lazy_samples = 0;
+    int use_mmap = 0;
+    int use_prefetch = 0;
+    int use_memory = 0;
+    uint8_t * filebuf = NULL;
+    int32_t seek_samples = 0;
+
+    while ((opt = getopt(argc, argv, "o:l:f:d:ipPcmxeLEFr:gb2:s:SDC:T:n:t:k:zMBR")) != -1) {
         switch (opt) {
             case 'o':
                 outfilename = optarg;
@@ -144,6 +177,39 @@ int main(int argc, char ** argv) {
             case 's':
                 stream_index = atoi(optarg);
                 break;
+            case 'S':
+                print_iostats = 1;
+                break;
+            case 'D':
+                profile_only = 1;
+                break;
+            case 'C':
+                cache_dir = optarg;
+                break;
+            case 'T':
+                probe_threads = atoi(optarg);
+                break;
+            case 'n':
+                dir_cache = atoi(optarg);
+                break;
+            case 't':
+                txth_cache = atoi(optarg);
+                break;
+            case 'k':
+                seek_samples = atoi(optarg);
+                break;
+            case 'z':
+                lazy_samples = 1;
+                break;
+            case 'M':
+                use_mmap = 1;
+                break;
+            case 'B':
+                use_prefetch = 1;
+                break;
+            case 'R':
+                use_memory = 1;
+                break;
             default:
                 usage(argv[0]);
                 return 1;
@@ -156,6 +222,18 @@ int main(int argc, char ** argv) {
         return 1;
     }
 
+    if (cache_dir) {
+        vgmstream_set_cache_dir(cache_dir);
+    }
+    vgmstream_set_probe_threads(probe_threads);
+    vgmstream_set_dir_cache(dir_cache);
+    vgmstream_set_txth_cache(txth_cache);
+    vgmstream_set_lazy_samples(lazy_samples);
+
+    if (profile_only) {
+        return profile_detection(argv[optind], stream_index);
+    }
+
     if (play_forever && !play_sdtout) {
         fprintf(stderr,"A file of infinite size? Not likely.\n");
         return 1;
@@ -189,7 +267,26 @@ int main(int argc, char ** argv) {
     /* manually init streamfile to pass the stream index */
     {
         //s = init_vgmstream(argv[optind]);
-        STREAMFILE *streamFile = open_stdio_streamfile(argv[optind]);
+        STREAMFILE *streamFile = NULL;
+        if (use_memory) {
+            size_t filebuf_size;
+            filebuf = read_whole_file(argv[optind], &filebuf_size);
+            if (filebuf) /* must stay valid until the VGMSTREAM is closed */
+                streamFile = open_memory_streamfile(filebuf, filebuf_size, argv[optind]);
+        }
+        else if (use_mmap) {
+            streamFile = open_mmap_streamfile(argv[optind]);
+        }
+        else {
+            streamFile = open_stdio_streamfile(argv[optind]);
+        }
+        if (streamFile && use_prefetch) {
+            /* channels opened from it are prefetched too */
+            STREAMFILE *prefetchFile = open_prefetch_streamfile(streamFile);
+            if (!prefetchFile)
+                close_streamfile(streamFile);
+            streamFile = prefetchFile;
+        }
         if (streamFile) {
             streamFile->stream_index = stream_index;
             vgmstream = init_vgmstream_from_STREAMFILE(streamFile);
@@ -203,6 +300,9 @@ int main(int argc, char ** argv) {
         return 1;
     }
 
+    /* loops and length below (and the printed ones) must be the exact ones */
+    update_vgmstream_samples(vgmstream);
+
     /* force only if there aren't already loop points */
     if (force_loop && !vgmstream->loop_flag) {
         /* this requires a bit more messing with the VGMSTREAM than I'm comfortable with... */
@@ -288,7 +388,10 @@ int main(int argc, char ** argv) {
     }
 
     if (print_metaonly) {
+        if (print_iostats)
+            print_stats(vgmstream);
         close_vgmstream(vgmstream);
+        free(filebuf);
         return 0;
     }
 
@@ -314,12 +417,18 @@ int main(int argc, char ** argv) {
         vgmstream->loop_target = (int)loop_count;
     }
 
+    if (seek_samples < 0 || seek_samples > len_samples) {
+        seek_samples = len_samples;
+    }
+    if (seek_samples > 0) {
+        seek_vgmstream(vgmstream, seek_samples);
+    }
 
     /* slap on a .wav header */
     if (only_stereo != -1) {
-        make_wav_header((uint8_t*)buf, len_samples, vgmstream->sample_rate, 2);
+        make_wav_header((uint8_t*)buf, len_samples - seek_samples, vgmstream->sample_rate, 2);
     } else {
-        make_wav_header((uint8_t*)buf, len_samples, vgmstream->sample_rate, vgmstream->channels);
+        make_wav_header((uint8_t*)buf, len_samples - seek_samples, vgmstream->sample_rate, vgmstream->channels);
     }
     if (write_lwav && vgmstream->loop_flag) { // Adding space for smpl chunk at end
         int32_t bytecount = get_32bitLE((uint8_t*)buf + 4);
@@ -343,7 +452,7 @@ int main(int argc, char ** argv) {
     }
 
     /* decode */
-    for (i = 0; i < len_samples; i += BUFSIZE) {
+    for (i = seek_samples; i < len_samples; i += BUFSIZE) {
         int toget = BUFSIZE;
         if (i + BUFSIZE > len_samples)
             toget = len_samples-i;
@@ -381,31 +490,6 @@ int main(int argc, char ** argv) {
     fclose(outfile);
     outfile = NULL;
 
-#ifdef PROFILE_STREAMFILE
-    {
-        size_t total_bytes_read = 0;
-        for (i=0;i<vgmstream->channels;i++) {
-            size_t bytes_read = get_streamfile_bytes_read(vgmstream->ch[i].streamfile);
-            size_t file_size = get_streamfile_size(vgmstream->ch[i].streamfile);
-            int error_count = get_streamfile_error_count(vgmstream->ch[i].streamfile);
-            int already_reported = 0;
-
-            /* see if we've reported this STREAMFILE already */
-            for (j=i-1;!already_reported && j>=0;j--) {
-                if (vgmstream->ch[j].streamfile == vgmstream->ch[i].streamfile) {
-                    already_reported=1;
-                }
-            }
-
-            if (already_reported) continue;
-
-            total_bytes_read += bytes_read;
-            fprintf(stderr,"ch%d: %lf%% (%d bytes read, file is %d bytes) %d errors\n",i,
-                    bytes_read*100.0/file_size,bytes_read,file_size,error_count);
-        }
-        fprintf(stderr,"total bytes read: %d\n",total_bytes_read);
-    }
-#endif
 
     if (outfilename_reset) {
         outfile = fopen(outfilename_reset,"wb");
@@ -478,12 +562,220 @@ int main(int argc, char ** argv) {
         outfile = NULL;
     }
 
+    if (print_iostats)
+        print_stats(vgmstream);
+
     close_vgmstream(vgmstream);
     free(buf);
+    free(filebuf);
 
     return 0;
 }
 
+static uint8_t * read_whole_file(const char * filename, size_t * size) {
+    uint8_t * filebuf = NULL;
+    FILE * infile;
+    long filesize;
+
+    infile = fopen(filename,"rb");
+    if (!infile) return NULL;
+
+    if (fseek(infile,0,SEEK_END) != 0) goto fail;
+    filesize = ftell(infile);
+    if (filesize < 0 || fseek(infile,0,SEEK_SET) != 0) goto fail;
+
+    filebuf = malloc(filesize ? filesize : 1);
+    if (!filebuf) goto fail;
+    if (fread(filebuf,1,filesize,infile) != (size_t)filesize) goto fail;
+
+    fclose(infile);
+    *size = filesize;
+    return filebuf;
+
+fail:
+    fclose(infile);
+    free(filebuf);
+    return NULL;
+}
+
+static void print_stats(VGMSTREAM * vgmstream) {
+    STREAMFILE_STATS stats;
+
+    memset(&stats,0,sizeof(STREAMFILE_STATS));
+    get_vgmstream_streamfile_stats(vgmstream,&stats);
+
+    fprintf(stderr,"I/O stats: %llu handles, %llu errors\n"
+            "  reads: %llu (%llu hits), refills: %llu (%llu seeks)\n"
+            "  bytes: %llu fetched, %llu consumed",
+            (unsigned long long)stats.handles, (unsigned long long)stats.errors,
+            (unsigned long long)stats.reads, (unsigned long long)stats.hits,
+            (unsigned long long)stats.misses, (unsigned long long)stats.seeks,
+            (unsigned long long)stats.bytes_fetched, (unsigned long long)stats.bytes_consumed);
+    if (stats.bytes_consumed)
+        fprintf(stderr," (%.2fx read amplification)",(double)stats.bytes_fetched / stats.bytes_consumed);
+    fprintf(stderr,"\n");
+}
+
+
+/* detection costs of one init function, added up over all files */
+typedef struct {
+    const char * name;
+    double time;
+    double time_max;
+    int tries;
+    int accepts;
+    int sanity_fails;
+    uint64_t reads;
+    uint64_t bytes_read;
+    uint64_t bytes_fetched;
+} profile_entry;
+
+typedef struct {
+    profile_entry * entries;
+    int entries_count;
+    int entries_max;
+    double time;
+    int files;
+    int detected;
+} profile_data;
+
+static void profile_callback(const VGMSTREAM_PROBE * probe, void * data) {
+    profile_data * profile = data;
+    profile_entry * entry = NULL;
+    int i;
+
+    for (i = 0; i < profile->entries_count; i++) {
+        if (strcmp(profile->entries[i].name, probe->name) == 0) {
+            entry = &profile->entries[i];
+            break;
+        }
+    }
+
+    if (!entry) {
+        if (profile->entries_count == profile->entries_max) {
+            profile_entry * entries = realloc(profile->entries, (profile->entries_max + 64) * sizeof(profile_entry));
+            if (!entries) return;
+            profile->entries = entries;
+            profile->entries_max += 64;
+        }
+        entry = &profile->entries[profile->entries_count++];
+        memset(entry,0,sizeof(profile_entry));
+        entry->name = probe->name;
+    }
+
+    entry->time += probe->time;
+    if (probe->time > entry->time_max)
+        entry->time_max = probe->time;
+    entry->tries++;
+    if (probe->outcome == PROBE_ACCEPTED || probe->outcome == PROBE_BAD_LOOPS)
+        entry->accepts++;
+    if (probe->outcome != PROBE_REJECTED && probe->outcome != PROBE_ACCEPTED)
+        entry->sanity_fails++;
+    entry->reads += probe->reads;
+    entry->bytes_read += probe->bytes_read;
+    entry->bytes_fetched += probe->bytes_fetched;
+    profile->time += probe->time;
+}
+
+static int profile_compare(const void * a, const void * b) {
+    const profile_entry * entry_a = a;
+    const profile_entry * entry_b = b;
+
+    if (entry_a->time < entry_b->time) return 1;
+    if (entry_a->time > entry_b->time) return -1;
+    return strcmp(entry_a->name, entry_b->name);
+}
+
+static void profile_file(profile_data * profile, const char * filename, int stream_index) {
+    VGMSTREAM * vgmstream;
+    STREAMFILE *streamFile = open_stdio_streamfile(filename);
+    if (!streamFile) {
+        fprintf(stderr,"failed opening %s\n",filename);
+        return;
+    }
+
+    streamFile->stream_index = stream_index;
+    vgmstream = init_vgmstream_profile(streamFile, profile_callback, profile);
+    close_streamfile(streamFile);
+
+    profile->files++;
+    if (vgmstream) {
+        profile->detected++;
+        close_vgmstream(vgmstream);
+    }
+}
+
+/* tries to detect path (or every file in it if it's a directory) and prints the cost of each format,
+ * most expensive first */
+static int profile_detection(const char * path, int stream_index) {
+    profile_data profile;
+    struct stat path_stat;
+    char filename[PATH_LIMIT];
+    int i;
+
+    memset(&profile,0,sizeof(profile_data));
+
+    if (stat(path,&path_stat) == 0 && S_ISDIR(path_stat.st_mode)) {
+#ifdef WIN32
+        WIN32_FIND_DATAA find_data;
+        HANDLE find;
+
+        snprintf(filename,PATH_LIMIT,"%s\\*",path);
+        find = FindFirstFileA(filename,&find_data);
+        if (find == INVALID_HANDLE_VALUE) {
+            fprintf(stderr,"failed opening %s\n",path);
+            return 1;
+        }
+        do {
+            if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+                continue;
+            snprintf(filename,PATH_LIMIT,"%s\\%s",path,find_data.cFileName);
+            profile_file(&profile,filename,stream_index);
+        } while (FindNextFileA(find,&find_data));
+        FindClose(find);
+#else
+        DIR * dir;
+        struct dirent * dir_entry;
+
+        dir = opendir(path);
+        if (!dir) {
+            fprintf(stderr,"failed opening %s\n",path);
+            return 1;
+        }
+        while ((dir_entry = readdir(dir)) != NULL) {
+            struct stat file_stat;
+
+            snprintf(filename,PATH_LIMIT,"%s/%s",path,dir_entry->d_name);
+            if (stat(filename,&file_stat) != 0 || !S_ISREG(file_stat.st_mode))
+                continue;
+            profile_file(&profile,filename,stream_index);
+        }
+        closedir(dir);
+#endif
+    }
+    else {
+        profile_file(&profile,path,stream_index);
+    }
+
+    qsort(profile.entries,profile.entries_count,sizeof(profile_entry),profile_compare);
+
+    printf("%10s %10s %7s %7s %7s %9s %12s %12s  %s\n",
+            "total ms","max ms","tries","accepts","fails","reads","bytes read","bytes fetch","format");
+    for (i = 0; i < profile.entries_count; i++) {
+        profile_entry * entry = &profile.entries[i];
+        printf("%10.3f %10.3f %7i %7i %7i %9llu %12llu %12llu  %s\n",
+                entry->time * 1000.0, entry->time_max * 1000.0,
+                entry->tries, entry->accepts, entry->sanity_fails,
+                (unsigned long long)entry->reads, (unsigned long long)entry->bytes_read,
+                (unsigned long long)entry->bytes_fetched, entry->name);
+    }
+    printf("%i files, %i detected, %.3f ms in %i formats\n",
+            profile.files, profile.detected, profile.time * 1000.0, profile.entries_count);
+
+    free(profile.entries);
+    return profile.detected ? 0 : 1;
+}
+
 
 
 /**
@@ -622,6 +622,9 @@ int winamp_Play(const in_char *fn) {
     if (ignore_loop)
         vgmstream->loop_flag = 0;
 
+    /* save the decoder state every second, so seeking back doesn't decode from the start (if the codec allows) */
+    set_vgmstream_checkpoints(vgmstream, vgmstream->sample_rate);
+
     /* save original name */
     wa_strncpy(lastfn,fn,PATH_LIMIT);
 
@@ -825,44 +828,46 @@ DWORD WINAPI __stdcall decode(void *arg) {
         int samples_to_do;
         int l;
 
-        if (decode_pos_samples + max_buffer_samples > stream_length_samples
-                && (!loop_forever || !vgmstream->loop_flag))
-            samples_to_do = stream_length_samples - decode_pos_samples;
-        else
-            samples_to_do = max_buffer_samples;
-
-        /* play 'till the end of this seek, or note if we're done seeking */
+        /* move to the seek position before decoding, a second at a time so stopping or seeking again
+         * isn't blocked by a long seek (each step decodes from the closest point vgmstream can find) */
         if (seek_needed_samples != -1) {
-            /* reset if we need to seek backwards */
-            if (seek_needed_samples < decode_pos_samples) {
-                reset_vgmstream(vgmstream);
-
-                if (ignore_loop)
-                    vgmstream->loop_flag = 0;
-
-                decode_pos_samples = 0;
-                decode_pos_ms = 0;
-            }
+            int seek_target = seek_needed_samples;
+            int seek_step;
 
             /* adjust seeking past file, can happen using the right (->) key
              * (should be done here and not in SetOutputTime due to threads/race condicions) */
-            if (seek_needed_samples > max_samples) {
-                seek_needed_samples = max_samples;
+            if (seek_target > max_samples) {
+                seek_target = max_samples;
             }
 
-            /* adjust max samples to seek */
-            if (decode_pos_samples < seek_needed_samples) {
-                samples_to_do = seek_needed_samples - decode_pos_samples;
-                if (samples_to_do > max_buffer_samples)
-                    samples_to_do = max_buffer_samples;
-            }
-            else {
-                seek_needed_samples = -1;
+            /* going back starts over, as steps only move forward */
+            if (seek_target < decode_pos_samples) {
+                seek_vgmstream(vgmstream, 0);
+                decode_pos_samples = 0;
             }
 
-            input_module.outMod->Flush((int)decode_pos_ms);
+            seek_step = decode_pos_samples + vgmstream->sample_rate;
+            if (seek_step > seek_target)
+                seek_step = seek_target;
+            seek_vgmstream(vgmstream, seek_step);
+            decode_pos_samples = seek_step;
+
+            if (seek_step == seek_target) {
+                decode_pos_ms = decode_pos_samples * 1000LL / vgmstream->sample_rate;
+                if (seek_needed_samples == seek_target || seek_needed_samples > max_samples)
+                    seek_needed_samples = -1; /* or a new seek came meanwhile */
+
+                input_module.outMod->Flush((int)decode_pos_ms);
+            }
+            continue;
         }
 
+        if (decode_pos_samples + max_buffer_samples > stream_length_samples
+                && (!loop_forever || !vgmstream->loop_flag))
+            samples_to_do = stream_length_samples - decode_pos_samples;
+        else
+            samples_to_do = max_buffer_samples;
+
         l = (samples_to_do*vgmstream->channels*2) << (input_module.dsp_isactive()?1:0);
 
         if (samples_to_do == 0) {
@@ -873,12 +878,6 @@ DWORD WINAPI __stdcall decode(void *arg) {
             }
             Sleep(10);
         }
-        else if (seek_needed_samples != -1) {
-            render_vgmstream(sample_buffer,samples_to_do,vgmstream);
-
-            decode_pos_samples += samples_to_do;
-            decode_pos_ms = decode_pos_samples * 1000LL / vgmstream->sample_rate;
-        }
         else if (input_module.outMod->CanWrite() >= l) {
             /* let vgmstream do its thing */
             render_vgmstream(sample_buffer,samples_to_do,vgmstream);
@@ -292,6 +292,9 @@ DWORD WINAPI xmplay_Open(const char *filename, XMPFILE file) {
     if (!vgmstream)
         return 0;
 
+    /* save the decoder state every second for faster seeking back, if the codec allows it */
+    set_vgmstream_checkpoints(vgmstream, vgmstream->sample_rate);
+
     framesDone = 0;
     stream_length_samples = get_vgmstream_play_samples(loop_count, fade_seconds, fade_delay_seconds, vgmstream);
     fade_samples = (int)(fade_seconds * vgmstream->sample_rate);
@@ -405,24 +408,9 @@ double WINAPI xmplay_SetPosition(DWORD pos) {
     }
 #endif
 
-    if (time < cpos) {
-        reset_vgmstream(vgmstream);
-        cpos = 0.0;
-    }
-
-    while (cpos < time) {
-        INT16 buffer[1024];
-        long max_sample_count = 1024 / vgmstream->channels;
-        long samples_to_skip = (long)((time - cpos) * vgmstream->sample_rate);
-        if (samples_to_skip > max_sample_count)
-            samples_to_skip = max_sample_count;
-        if (!samples_to_skip)
-            break;
-        render_vgmstream(buffer, (int)samples_to_skip, vgmstream);
-        cpos += (double)samples_to_skip / (double)vgmstream->sample_rate;
-    }
-
-    framesDone = (int32_t)(cpos * vgmstream->sample_rate);
+    framesDone = (int32_t)(time * vgmstream->sample_rate);
+    seek_vgmstream(vgmstream, framesDone);
+    cpos = (double)framesDone / (double)vgmstream->sample_rate;
 
     return cpos;
 }